@@ -0,0 +1,146 @@
+#include "SongGenerator.h"
+#include "../src/read/Gp5Reader.h"
+#include "../src/write/Gp5Writer.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <string>
+#include <vector>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <sys/resource.h>
+#endif
+
+using namespace libgp;
+
+namespace
+{
+	std::atomic<size_t> allocationCount{ 0 };
+
+	struct Scenario
+	{
+		const char* name;
+		ScoreShape shape;
+	};
+
+	// From a single short track up to a large, busy score; the peak resident
+	// size only ever grows, so the scenarios run in order of size
+	const Scenario Scenarios[] = {
+		{ "small", { 1, 32, 4, 1, 0.1, 1 } },
+		{ "medium", { 4, 128, 4, 2, 0.2, 2 } },
+		{ "wide", { 32, 64, 4, 1, 0.1, 3 } },
+		{ "dense", { 4, 128, 16, 6, 1.0, 4 } },
+		{ "large", { 8, 512, 8, 3, 0.3, 5 } },
+		{ "huge", { 16, 2048, 8, 3, 0.3, 6 } }
+	};
+
+	size_t peakResidentSize()
+	{
+#ifdef _WIN32
+		PROCESS_MEMORY_COUNTERS counters;
+		if (!GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) {
+			return 0;
+		}
+
+		return counters.PeakWorkingSetSize;
+#else
+		rusage usage;
+		if (getrusage(RUSAGE_SELF, &usage) != 0) {
+			return 0;
+		}
+
+		// Reported in bytes on macOS and in kilobytes elsewhere
+#ifdef __APPLE__
+		return static_cast<size_t>(usage.ru_maxrss);
+#else
+		return static_cast<size_t>(usage.ru_maxrss) * 1024;
+#endif
+#endif
+	}
+}
+
+// Every allocation of the process goes through here so that the reads can
+// be charged for theirs
+void* operator new(size_t size)
+{
+	allocationCount.fetch_add(1, std::memory_order_relaxed);
+	if (auto pointer = std::malloc(size > 0 ? size : 1)) {
+		return pointer;
+	}
+
+	throw std::bad_alloc();
+}
+
+void* operator new[](size_t size)
+{
+	return operator new(size);
+}
+
+void operator delete(void* pointer) noexcept
+{
+	std::free(pointer);
+}
+
+void operator delete[](void* pointer) noexcept
+{
+	std::free(pointer);
+}
+
+void operator delete(void* pointer, size_t) noexcept
+{
+	std::free(pointer);
+}
+
+void operator delete[](void* pointer, size_t) noexcept
+{
+	std::free(pointer);
+}
+
+// Reads each scenario's score over and over until about as many bytes as
+// asked for have been parsed, given in megabytes as the only argument
+int main(int argc, char* argv[])
+{
+	auto targetBytes = (argc > 1 ? std::strtod(argv[1], nullptr) : 256.0) * 1000.0 * 1000.0;
+	const size_t MinReads = 3;
+
+	std::printf("%-8s %6s %8s %6s %6s %8s %10s %10s %10s %12s %12s\n",
+		"score", "tracks", "measures", "beats", "notes", "density", "size KB", "MB/s", "songs/s", "allocs", "peak RSS MB");
+
+	for (auto& scenario : Scenarios) {
+		auto& shape = scenario.shape;
+		auto data = Gp5Writer().write(*generateSong(shape));
+
+		// Warms the caches and checks that the score can be read at all
+		Gp5Reader().readSong(data.data(), data.size());
+
+		auto reads = std::max(MinReads, static_cast<size_t>(targetBytes / data.size()));
+		auto allocations = allocationCount.load();
+		auto start = std::chrono::steady_clock::now();
+
+		for (size_t i = 0; i < reads; ++i) {
+			Gp5Reader reader;
+			auto song = reader.readSong(data.data(), data.size());
+		}
+
+		auto seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+		allocations = allocationCount.load() - allocations;
+
+		std::printf("%-8s %6u %8u %6u %6u %8.2f %10.1f %10.1f %10.1f %12.1f %12.1f\n",
+			scenario.name, shape.tracks, shape.measures, shape.beats, shape.notes, shape.effectDensity,
+			data.size() / 1000.0,
+			reads * data.size() / seconds / 1000.0 / 1000.0,
+			reads / seconds,
+			static_cast<double>(allocations) / reads,
+			peakResidentSize() / 1000.0 / 1000.0);
+	}
+
+	return 0;
+}
@@ -0,0 +1,169 @@
+#include "SongGenerator.h"
+#include <algorithm>
+#include <random>
+#include <string>
+
+namespace libgp
+{
+	namespace
+	{
+		// Standard tuning, from the highest string down
+		const uint8_t Tuning[] = { 64, 59, 55, 50, 45, 40 };
+		const uint32_t NumStrings = 6;
+		const uint32_t NumEffects = 9;
+		const uint32_t SectionLength = 8;
+
+		void addNoteEffect(Note& note, uint32_t kind)
+		{
+			auto& effect = note.effect;
+			switch (kind) {
+			case 0:
+				effect.bend.type = BendType::Bend;
+				effect.bend.value = 100;
+				effect.bend.points.push_back({ 0, 0, false });
+				effect.bend.points.push_back({ 6, 4, false });
+				effect.bend.points.push_back({ 12, 4, false });
+				break;
+			case 1:
+				effect.isHammer = true;
+				break;
+			case 2:
+				effect.slides.push_back(SlideType::ShiftSlideTo);
+				break;
+			case 3:
+				effect.harmonic = Harmonic{ HarmonicType::Natural, 0, 0, 0, 0 };
+				break;
+			case 4:
+				effect.palmMute = true;
+				effect.isStaccato = true;
+				break;
+			case 5:
+				effect.hasVibrato = true;
+				effect.letRing = true;
+				break;
+			case 6:
+				effect.grace = Grace{ Duration::ThirtySecond, static_cast<uint8_t>(note.value + 2), false, false, GraceTransition::Hammer, Note::DefaultVelocity };
+				break;
+			case 7:
+				effect.tremoloPicking = TremoloPicking{ Duration::Sixteenth };
+				break;
+			default:
+				effect.trill = Trill{ static_cast<uint8_t>(note.value + 2), Duration::Sixteenth };
+				break;
+			}
+		}
+
+		void addBeatEffect(Beat& beat, uint32_t kind, uint32_t tempo)
+		{
+			switch (kind % 3) {
+			case 0:
+				beat.effect.stroke.direction = BeatStrokeDirection::Down;
+				beat.effect.stroke.value = Duration::Sixteenth;
+				break;
+			case 1:
+				beat.text = "text";
+				break;
+			default:
+				auto& change = beat.effect.mixTableChange.emplace();
+				change.tempo = static_cast<int32_t>(tempo);
+				change.volume.value = 100;
+				break;
+			}
+		}
+	}
+
+	std::unique_ptr<Song> generateSong(const ScoreShape& shape)
+	{
+		std::mt19937 random(shape.seed);
+		std::uniform_real_distribution<double> chance(0.0, 1.0);
+		std::uniform_int_distribution<uint32_t> frets(0, 20);
+		std::uniform_int_distribution<uint32_t> effects(0, NumEffects - 1);
+		std::uniform_int_distribution<uint32_t> tempos(90, 150);
+
+		auto hasSections = shape.effectDensity > 0.0;
+		auto numBeats = std::clamp<uint32_t>(shape.beats, 1, 127);
+		auto numNotes = std::min(shape.notes, NumStrings);
+
+		auto song = std::make_unique<Song>();
+		song->title = "Generated score";
+		song->tempo.value = 120;
+		song->lyrics.trackNumber = 1;
+
+		song->measureHeaders.reserve(shape.measures);
+		for (uint32_t i = 0; i < shape.measures; ++i) {
+			MeasureHeader header;
+			header.number = i + 1;
+			header.timeSignature.numerator = static_cast<int8_t>(numBeats);
+			header.start = song->measureHeaders.empty()
+				? static_cast<uint32_t>(Duration::QuarterTime)
+				: song->measureHeaders[i - 1].start + song->measureHeaders[i - 1].calcLength();
+			header.tempo = song->tempo.value;
+
+			if (hasSections && i % SectionLength == 0) {
+				header.marker.title = "Section";
+				header.isRepeatOpen = true;
+			}
+
+			if (hasSections && i % SectionLength == SectionLength - 1) {
+				header.repeatClose = 1;
+			}
+
+			song->measureHeaders.push_back(header);
+		}
+
+		// Measures refer back to their track, which must not move
+		song->tracks.reserve(shape.tracks);
+		for (uint32_t i = 0; i < shape.tracks; ++i) {
+			auto& track = song->tracks.emplace_back();
+			track.number = i + 1;
+			track.numFrets = 24;
+			track.isVisible = true;
+			track.name = song->storage->store("Track " + std::to_string(i + 1));
+			track.port = 1;
+
+			for (uint8_t j = 0; j < NumStrings; ++j) {
+				track.strings.push_back({ static_cast<uint8_t>(j + 1), Tuning[j] });
+			}
+
+			// Every other channel, which keeps clear of the percussion channel
+			MidiChannel channel{};
+			channel.channel = static_cast<uint8_t>(i * 2 % 64);
+			channel.effectChannel = static_cast<uint8_t>(channel.channel + 1);
+			channel.instrument = 25;
+			channel.volume = 104;
+			channel.balance = 64;
+			track.channel = channel;
+
+			track.measures.reserve(shape.measures);
+			for (auto& header : song->measureHeaders) {
+				auto& measure = track.measures.emplace_back(track, header);
+				auto& beats = measure.voices[0].beats;
+				beats.reserve(numBeats);
+
+				for (uint32_t j = 0; j < numBeats; ++j) {
+					auto& beat = beats.emplace_back();
+					beat.start = header.start + j * static_cast<uint32_t>(Duration::QuarterTime);
+					beat.index = static_cast<uint8_t>(j);
+
+					if (chance(random) < shape.effectDensity) {
+						addBeatEffect(beat, effects(random), tempos(random));
+					}
+
+					beat.notes.reserve(numNotes);
+					for (uint32_t k = 0; k < numNotes; ++k) {
+						auto& note = beat.notes.emplace_back();
+						note.type = NoteType::Normal;
+						note.string = static_cast<uint8_t>(k + 1);
+						note.value = static_cast<uint8_t>(frets(random));
+
+						if (chance(random) < shape.effectDensity) {
+							addNoteEffect(note, effects(random));
+						}
+					}
+				}
+			}
+		}
+
+		return song;
+	}
+}
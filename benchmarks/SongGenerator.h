@@ -0,0 +1,28 @@
+#pragma once
+
+#include "../src/Model.h"
+#include <cstdint>
+#include <memory>
+
+namespace libgp
+{
+	// The size and content of a generated score
+	struct ScoreShape
+	{
+		uint32_t tracks = 1;
+		uint32_t measures = 16;
+		// Quarter note beats in each measure, which sets its time signature
+		uint32_t beats = 4;
+		// Notes in each beat, one for each string up to the six of a guitar
+		uint32_t notes = 1;
+		// The share of notes and beats carrying an effect, from 0 to 1
+		double effectDensity = 0.0;
+		uint32_t seed = 1;
+	};
+
+	// Builds a song of the given shape, the same song for the same shape. Every
+	// track is a six string guitar with one voice filled, and the effects are
+	// those a Guitar Pro 5 file can hold, so the song can be written and read
+	// back.
+	std::unique_ptr<Song> generateSong(const ScoreShape& shape);
+}
@@ -0,0 +1,27 @@
+#include "Arena.h"
+
+namespace libgp
+{
+	namespace
+	{
+		thread_local Arena* currentArena = nullptr;
+	}
+
+	Arena::Arena() :
+		resource_(InitialSize)
+	{
+
+	}
+
+	void* Arena::allocate(size_t size, size_t alignment) { return resource_.allocate(size, alignment); }
+
+	Arena* Arena::current() noexcept { return currentArena; }
+
+	ArenaScope::ArenaScope(Arena& arena) noexcept :
+		previous_(currentArena)
+	{
+		currentArena = &arena;
+	}
+
+	ArenaScope::~ArenaScope() { currentArena = previous_; }
+}
@@ -0,0 +1,112 @@
+#pragma once
+
+#include <cstddef>
+#include <memory_resource>
+#include <new>
+#include <type_traits>
+#include <vector>
+
+namespace libgp
+{
+	// Monotonic memory arena. Allocations are never freed individually; all of the
+	// memory is released at once when the arena is destroyed.
+	class Arena
+	{
+	public:
+		Arena();
+
+		Arena(const Arena&) = delete;
+		Arena& operator=(const Arena&) = delete;
+
+		void* allocate(size_t size, size_t alignment);
+
+		// The arena that model containers created on this thread allocate from, or
+		// null when they allocate from the heap
+		static Arena* current() noexcept;
+
+	private:
+		static const size_t InitialSize = 16 * 1024;
+
+		std::pmr::monotonic_buffer_resource resource_;
+
+		friend class ArenaScope;
+	};
+
+	// Routes the allocations of model containers created on this thread to an
+	// arena for as long as the scope is alive
+	class ArenaScope
+	{
+	public:
+		explicit ArenaScope(Arena& arena) noexcept;
+		~ArenaScope();
+
+		ArenaScope(const ArenaScope&) = delete;
+		ArenaScope& operator=(const ArenaScope&) = delete;
+
+	private:
+		Arena* previous_;
+	};
+
+	// Allocator used by the model's containers. It binds to the current arena when
+	// the container is created and travels with the container's memory on moves,
+	// swaps and assignments. Freeing arena memory is a no-op.
+	//
+	// The allocator does not keep its arena alive. A container moved out of a
+	// song points into the song's storage, and the elements it destroys live
+	// there too, so it has to be gone before the last copy of the song is;
+	// copy it instead to keep it longer, as a copy made outside an ArenaScope
+	// allocates from the heap.
+	template<typename T>
+	class ArenaAllocator
+	{
+	public:
+		using value_type = T;
+		using propagate_on_container_copy_assignment = std::true_type;
+		using propagate_on_container_move_assignment = std::true_type;
+		using propagate_on_container_swap = std::true_type;
+
+		ArenaAllocator() noexcept :
+			arena_(Arena::current())
+		{
+		}
+
+		template<typename U>
+		ArenaAllocator(const ArenaAllocator<U>& other) noexcept :
+			arena_(other.arena())
+		{
+		}
+
+		T* allocate(size_t n)
+		{
+			if (arena_ != nullptr) {
+				return static_cast<T*>(arena_->allocate(n * sizeof(T), alignof(T)));
+			}
+
+			return static_cast<T*>(::operator new(n * sizeof(T)));
+		}
+
+		void deallocate(T* p, size_t) noexcept
+		{
+			if (arena_ == nullptr) {
+				::operator delete(p);
+			}
+		}
+
+		// Copies belong to whatever arena is current where they are made
+		ArenaAllocator select_on_container_copy_construction() const noexcept { return ArenaAllocator(); }
+
+		Arena* arena() const noexcept { return arena_; }
+
+	private:
+		Arena* arena_;
+	};
+
+	template<typename T, typename U>
+	bool operator==(const ArenaAllocator<T>& lhs, const ArenaAllocator<U>& rhs) noexcept { return lhs.arena() == rhs.arena(); }
+
+	template<typename T, typename U>
+	bool operator!=(const ArenaAllocator<T>& lhs, const ArenaAllocator<U>& rhs) noexcept { return lhs.arena() != rhs.arena(); }
+
+	template<typename T>
+	using ArenaVector = std::vector<T, ArenaAllocator<T>>;
+}
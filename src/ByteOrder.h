@@ -0,0 +1,32 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <type_traits>
+
+namespace libgp
+{
+	// Guitar Pro files and the song cache store numbers little-endian, and the
+	// readers and writers copy them in and out as they are laid out in memory.
+	// On a big-endian host the bytes of a number are reversed on the way; on any
+	// other host, or for anything but a number, this does nothing.
+	template<typename T>
+	T toLittleEndian(T value) noexcept
+	{
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+		if constexpr (std::is_arithmetic<T>::value && sizeof(T) > 1) {
+			std::byte bytes[sizeof(T)];
+			std::memcpy(bytes, &value, sizeof(T));
+			std::reverse(bytes, bytes + sizeof(T));
+			std::memcpy(&value, bytes, sizeof(T));
+		}
+#endif
+
+		return value;
+	}
+
+	// The same reversal, which undoes itself
+	template<typename T>
+	T fromLittleEndian(T value) noexcept { return toLittleEndian(value); }
+}
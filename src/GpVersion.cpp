@@ -1,35 +1,67 @@
 #include "GpVersion.h"
+#include <charconv>
 #include <exception>
+#include <stdexcept>
+#include <string_view>
+#include <utility>
 
 namespace libgp
 {
-	std::string GpVersion::full() const noexcept { return full_; }
+	const std::string& GpVersion::full() const noexcept { return full_; }
 
 	uint8_t GpVersion::major() const noexcept { return major_; }
 
 	uint8_t GpVersion::minor() const noexcept { return minor_; }
 
+	namespace
+	{
+		// Reads the number at the start of the text, after any spaces, as stoi does
+		std::optional<int> parseNumber(std::string_view text)
+		{
+			auto first = text.find_first_not_of(" \t\n\v\f\r");
+			if (first == std::string_view::npos) {
+				return std::nullopt;
+			}
+
+			int value = 0;
+			auto result = std::from_chars(text.data() + first, text.data() + text.size(), value);
+			if (result.ec != std::errc()) {
+				return std::nullopt;
+			}
+
+			return value;
+		}
+	}
+
 	GpVersion GpVersion::parse(std::string version)
+	{
+		auto gpVersion = tryParse(std::move(version));
+		if (!gpVersion) {
+			throw std::runtime_error("Invalid version string format");
+		}
+
+		return *gpVersion;
+	}
+
+	std::optional<GpVersion> GpVersion::tryParse(std::string version)
 	{
 		auto pos = version.find_last_of('v');
 		if (pos == std::string::npos) {
-			throw std::runtime_error("Invalid version string format");
+			return std::nullopt;
 		}
 
-		auto versionStr = version.substr(pos + 1);
+		auto versionStr = std::string_view(version).substr(pos + 1);
 		pos = versionStr.find('.');
-		auto majorStr = versionStr.substr(0, pos);
-		auto minorStr = versionStr.substr(pos + 1);
+		auto major = parseNumber(versionStr.substr(0, pos));
+		auto minor = parseNumber(versionStr.substr(pos + 1));
+		if (!major || !minor) {
+			return std::nullopt;
+		}
 
 		GpVersion gpVersion;
-		gpVersion.full_ = version;
-
-		try {
-			gpVersion.major_ = std::stoi(majorStr);
-			gpVersion.minor_ = std::stoi(minorStr);
-		} catch (const std::invalid_argument& e) {
-			throw std::runtime_error("Invalid version string format");
-		}
+		gpVersion.full_ = std::move(version);
+		gpVersion.major_ = static_cast<uint8_t>(*major);
+		gpVersion.minor_ = static_cast<uint8_t>(*minor);
 
 		return gpVersion;
 	}
@@ -38,8 +70,13 @@ namespace libgp
 
 	bool operator<(const GpVersion& lhs, const GpVersion& rhs)
 	{
-		return lhs.major() != rhs.major() 
-			? (lhs.major() < rhs.major()) 
-			: (lhs.minor() < rhs.minor());
+		if (lhs.major() != rhs.major()) {
+			return lhs.major() < rhs.major();
+		}
+
+		// Different formats can share a version number
+		return lhs.minor() != rhs.minor()
+			? lhs.minor() < rhs.minor()
+			: lhs.full() < rhs.full();
 	}
 }
\ No newline at end of file
@@ -2,17 +2,20 @@
 
 #include <string>
 #include <cstdint>
+#include <optional>
 
 namespace libgp
 {
 	class GpVersion
 	{
 	public:
-		std::string full() const noexcept;
+		const std::string& full() const noexcept;
 		uint8_t major() const noexcept;
 		uint8_t minor() const noexcept;
 
 		static GpVersion parse(std::string version);
+		// Returns nothing instead of throwing for a malformed version string
+		static std::optional<GpVersion> tryParse(std::string version);
 
 	private:
 		std::string full_;
@@ -1,4 +1,6 @@
 #include "Model.h"
+#include "Timeline.h"
+#include <atomic>
 #include <cmath>
 
 namespace libgp
@@ -48,7 +50,9 @@ namespace libgp
 	uint32_t Tuplet::convertTime(uint32_t time) const { return time * times / enters; }
 
 	Duration::Duration() :
-		value(Quarter)
+		value(Quarter),
+		isDotted(false),
+		isDoubleDotted(false)
 	{
 
 	}
@@ -99,7 +103,8 @@ namespace libgp
 	uint32_t MeasureHeader::calcLength() const { return timeSignature.numerator * timeSignature.denominator.calcTime(); }
 
 	Voice::Voice(Measure& measure) :
-		measure(measure)
+		measure(measure),
+		direction(VoiceDirection::None)
 	{
 
 	}
@@ -113,6 +118,23 @@ namespace libgp
 		}
 	}
 
+	// Threads that ask at the same time may each build the timeline; the first
+	// one stored is kept and handed to all of them
+	const Timeline& Song::timeline() const
+	{
+		auto timeline = std::atomic_load(&timeline_);
+		if (timeline == nullptr) {
+			auto built = std::make_shared<const Timeline>(Timeline::fromSong(*this));
+			if (std::atomic_compare_exchange_strong(&timeline_, &timeline, built)) {
+				timeline = std::move(built);
+			}
+		}
+
+		return *timeline;
+	}
+
+	void Song::resetTimeline() noexcept { std::atomic_store(&timeline_, std::shared_ptr<const Timeline>()); }
+
 	bool operator==(const LyricLine& lhs, const LyricLine& rhs) 
 	{
 		return lhs.startingMeasure == rhs.startingMeasure
@@ -159,10 +181,11 @@ namespace libgp
 			&& lhs.instrument == rhs.instrument
 			&& lhs.volume == rhs.volume
 			&& lhs.balance == rhs.balance
-			&& lhs.chorus == rhs.channel
+			&& lhs.chorus == rhs.chorus
 			&& lhs.reverb == rhs.reverb
 			&& lhs.phaser == rhs.phaser
-			&& lhs.tremolo == rhs.tremolo;
+			&& lhs.tremolo == rhs.tremolo
+			&& lhs.bank == rhs.bank;
 	}
 
 	bool operator==(const RSEEqualizer& lhs, const RSEEqualizer& rhs)
@@ -1,7 +1,12 @@
 #pragma once
 
+#include "Arena.h"
+#include "SongStorage.h"
+#include <array>
 #include <cstdint>
+#include <memory>
 #include <string>
+#include <string_view>
 #include <vector>
 #include <optional>
 
@@ -19,7 +24,7 @@ namespace libgp
 	struct Lyrics
 	{
 		uint32_t trackNumber;
-		std::vector<LyricLine> lines;
+		ArenaVector<LyricLine> lines;
 	};
 
 	enum class HeaderFooterElements : uint16_t
@@ -107,8 +112,8 @@ namespace libgp
 
 	struct Tuplet
 	{
-		uint8_t enters;
-		uint8_t times;
+		uint8_t enters = 1;
+		uint8_t times = 1;
 
 		uint32_t convertTime(uint32_t time) const;
 	};
@@ -140,7 +145,7 @@ namespace libgp
 	{
 		int8_t numerator;
 		Duration denominator;
-		std::vector<uint8_t> beams;
+		std::array<uint8_t, 4> beams;
 
 		TimeSignature();
 	};
@@ -220,7 +225,7 @@ namespace libgp
 	struct BendPoint
 	{
 		uint8_t position;
-		uint8_t value;
+		int8_t value;
 		bool hasVibrato;
 	};
 
@@ -230,9 +235,9 @@ namespace libgp
 		static const uint8_t MaxPosition = 12;
 		static const uint8_t MaxValue = SemitoneLength * MaxPosition;
 
-		BendType type;
-		uint8_t value;
-		std::vector<BendPoint> points;
+		BendType type = BendType::None;
+		int32_t value = 0;
+		ArenaVector<BendPoint> points;
 	};
 
 	enum class GraceTransition : uint8_t
@@ -266,6 +271,7 @@ namespace libgp
 	{
 		HarmonicType type;
 		uint8_t pitch;
+		int8_t accidental;
 		uint8_t octave;
 		uint8_t fret;
 	};
@@ -305,22 +311,22 @@ namespace libgp
 
 	struct NoteEffect
 	{
-		bool isAccentuated;
+		bool isAccentuated = false;
 		Bend bend;
-		bool isGhostNote;
-		Grace grace;
-		bool isHammer;
-		Harmonic harmonic;
-		bool isHeavyAccentuatedNote;
-		Fingering leftHandFingering;
-		bool letRing;
-		bool palmMute;
-		Fingering rightHandFingering;
-		std::vector<SlideType> slides;
-		bool isStaccato;
-		TremoloPicking tremoloPicking;
-		Trill trill;
-		bool hasVibrato;
+		bool isGhostNote = false;
+		std::optional<Grace> grace;
+		bool isHammer = false;
+		std::optional<Harmonic> harmonic;
+		bool isHeavyAccentuatedNote = false;
+		Fingering leftHandFingering = Fingering::Open;
+		bool letRing = false;
+		bool palmMute = false;
+		Fingering rightHandFingering = Fingering::Open;
+		ArenaVector<SlideType> slides;
+		bool isStaccato = false;
+		std::optional<TremoloPicking> tremoloPicking;
+		std::optional<Trill> trill;
+		bool hasVibrato = false;
 	};
 
 	enum class NoteType : uint8_t
@@ -333,13 +339,15 @@ namespace libgp
 
 	struct Note
 	{
-		uint8_t value;
-		uint8_t velocity;
-		uint8_t string;
+		static const uint8_t DefaultVelocity = 95;
+
+		uint8_t value = 0;
+		uint8_t velocity = DefaultVelocity;
+		uint8_t string = 0;
 		NoteEffect effect;
-		float durationPercent;
-		bool swapAccidentals;
-		NoteType type;
+		double durationPercent = 1.0;
+		bool swapAccidentals = false;
+		NoteType type = NoteType::Rest;
 	};
 
 	enum class BeatStrokeDirection : uint8_t
@@ -351,8 +359,8 @@ namespace libgp
 
 	struct BeatStroke
 	{
-		BeatStrokeDirection direction;
-		uint8_t value;
+		BeatStrokeDirection direction = BeatStrokeDirection::None;
+		uint8_t value = 0;
 	};
 
 	enum class SlapEffect : uint8_t
@@ -405,25 +413,25 @@ namespace libgp
 
 	struct Chord
 	{
-		uint8_t length;
-		bool isSharp;
-		uint8_t root;
-		ChordType type;
-		ChordExtension extension;
-		uint8_t bass;
-		uint8_t tonality;
-		uint8_t add;
+		uint8_t length = 0;
+		bool isSharp = false;
+		uint8_t root = 0;
+		ChordType type = ChordType::Major;
+		ChordExtension extension = ChordExtension::None;
+		int32_t bass = 0;
+		int32_t tonality = 0;
+		uint8_t add = 0;
 		std::string name;
-		uint8_t fifth;
-		uint8_t ninth;
-		uint8_t eleventh;
-		uint32_t firstFret;
-		std::vector<int32_t> strings;
-		std::vector<Barre> barres;
-		std::vector<bool> omissions;
-		std::vector<Fingering> fingerings;
-		uint8_t show;
-		uint8_t isNewFormat;
+		uint8_t fifth = 0;
+		uint8_t ninth = 0;
+		uint8_t eleventh = 0;
+		uint32_t firstFret = 0;
+		ArenaVector<int32_t> strings;
+		ArenaVector<Barre> barres;
+		ArenaVector<bool> omissions;
+		ArenaVector<Fingering> fingerings;
+		uint8_t show = 0;
+		uint8_t isNewFormat = 0;
 	};
 
 	struct WahEffect
@@ -442,32 +450,43 @@ namespace libgp
 		std::string effect;
 	};
 
+	// A value of -1 means the item is left unchanged
+	struct MixTableItem
+	{
+		int8_t value = -1;
+		uint8_t duration = 0;
+		bool allTracks = false;
+	};
+
 	struct MixTableChange
 	{
-		uint8_t instrument;
+		int8_t instrument = -1;
 		RSEInstrument rse;
-		uint8_t volume;
-		uint8_t balance;
-		uint8_t chorus;
-		uint8_t reverb;
-		uint8_t phaser;
-		uint8_t tremolo;
-		Tempo tempo;
+		MixTableItem volume;
+		MixTableItem balance;
+		MixTableItem chorus;
+		MixTableItem reverb;
+		MixTableItem phaser;
+		MixTableItem tremolo;
+		std::string tempoName;
+		int32_t tempo = -1;
+		uint8_t tempoDuration = 0;
+		bool hideTempo = false;
 		WahEffect wah;
-		bool useRSE;
+		bool useRSE = false;
 	};
 
 	struct BeatEffect
 	{
 		BeatStroke stroke;
-		bool hasRasgueado;
-		BeatStrokeDirection pickStroke;
-		Chord chord;
-		bool hasFadeIn;
+		bool hasRasgueado = false;
+		BeatStrokeDirection pickStroke = BeatStrokeDirection::None;
+		std::optional<Chord> chord;
+		bool hasFadeIn = false;
 		Bend tremoloBar;
-		MixTableChange mixTableChange;
-		SlapEffect slapEffect;
-		uint8_t vibrato;
+		std::optional<MixTableChange> mixTableChange;
+		SlapEffect slapEffect = SlapEffect::None;
+		uint8_t vibrato = 0;
 	};
 
 	enum class Octave : uint8_t
@@ -488,13 +507,13 @@ namespace libgp
 
 	struct BeatDisplay
 	{
-		bool breakBeam;
-		bool forceBeam;
-		VoiceDirection beamDirection;
-		TupletBracket tupletBracket;
-		uint8_t breakSecondary;
-		bool breakSecondaryTuplet;
-		bool forceBracket;
+		bool breakBeam = false;
+		bool forceBeam = false;
+		VoiceDirection beamDirection = VoiceDirection::None;
+		TupletBracket tupletBracket = TupletBracket::None;
+		uint8_t breakSecondary = 0;
+		bool breakSecondaryTuplet = false;
+		bool forceBracket = false;
 	};
 
 	enum class BeatStatus : uint8_t
@@ -506,22 +525,22 @@ namespace libgp
 
 	struct Beat
 	{
-		std::vector<Note> notes;
-		uint8_t duration;
+		ArenaVector<Note> notes;
+		Duration duration;
 		std::string text;
-		uint8_t start;
+		uint32_t start = 0;
 		BeatEffect effect;
-		uint8_t index;
-		Octave octave;
+		uint8_t index = 0;
+		Octave octave = Octave::None;
 		BeatDisplay display;
-		BeatStatus status;
+		BeatStatus status = BeatStatus::Normal;
 	};
 
 	struct Measure;
 	struct Voice
 	{
 		Measure& measure;
-		std::vector<Beat> beats;
+		ArenaVector<Beat> beats;
 		VoiceDirection direction;
 
 		explicit Voice(Measure& measure);
@@ -541,9 +560,9 @@ namespace libgp
 
 		Track& track;
 		MeasureHeader& header;
-		Clef clef;
-		std::vector<Voice> voices;
-		LineBreak lineBreak;
+		Clef clef = Clef::Treble;
+		ArenaVector<Voice> voices;
+		LineBreak lineBreak = LineBreak::None;
 
 		Measure(Track& track, MeasureHeader& header);
 	};
@@ -565,7 +584,7 @@ namespace libgp
 
 	struct RSEEqualizer
 	{
-		std::vector<float> knobs;
+		ArenaVector<float> knobs;
 		float gain;
 	};
 
@@ -600,8 +619,8 @@ namespace libgp
 		bool isMute;
 		bool indicateTuning;
 		std::string name;
-		std::vector<Measure> measures;
-		std::vector<GuitarString> strings;
+		ArenaVector<Measure> measures;
+		ArenaVector<GuitarString> strings;
 		uint8_t port;
 		std::optional<MidiChannel> channel;
 		Color color;
@@ -617,8 +636,18 @@ namespace libgp
 		RSEEqualizer equalizer;
 	};
 
-	struct Song
+	// Song metadata stored ahead of the channel table, tracks and measures
+	struct SongInfo
 	{
+		// Backs the containers of parsed songs and is shared between copies;
+		// null for songs built by hand, whose containers use the heap. Declared
+		// first so that it outlives the elements the containers destroy.
+		//
+		// Containers moved out of the song keep pointing into the storage
+		// without keeping it alive, so they must not outlive the song. See
+		// ArenaAllocator.
+		std::shared_ptr<SongStorage> storage;
+
 		std::string title;
 		std::string subtitle;
 		std::string artist;
@@ -628,16 +657,49 @@ namespace libgp
 		std::string copyright;
 		std::string tabAuthor;
 		std::string instructions;
-		std::vector<std::string> comments;
+		ArenaVector<std::string> comments;
 
-		RSEMasterEffect masterEffect;
 		Lyrics lyrics;
 		PageSetup pageSetup;
 		Tempo tempo;
 		KeySignature keySignature;
 		uint32_t octave;
-		std::vector<MeasureHeader> measureHeaders;
-		std::vector<Track> tracks;
+	};
+
+	// The text of SongInfo as views into the source it was read from, which the
+	// view keeps alive. For callers, such as indexers, that look at the text of
+	// many files and have no use for a copy of it.
+	struct SongInfoView
+	{
+		std::string_view title;
+		std::string_view subtitle;
+		std::string_view artist;
+		std::string_view album;
+		std::string_view lyricsWriter;
+		std::string_view musicWriter;
+		std::string_view copyright;
+		std::string_view tabAuthor;
+		std::string_view instructions;
+		std::vector<std::string_view> comments;
+
+		std::shared_ptr<const void> source;
+	};
+
+	struct Timeline;
+	struct Song : SongInfo
+	{
+		RSEMasterEffect masterEffect;
+		ArenaVector<MeasureHeader> measureHeaders;
+		ArenaVector<Track> tracks;
+
+		// The order the measures are played in, built from the measure headers
+		// the first time it is asked for and kept from then on. A song whose
+		// headers change afterwards has to reset it.
+		const Timeline& timeline() const;
+		void resetTimeline() noexcept;
+
+	private:
+		mutable std::shared_ptr<const Timeline> timeline_;
 	};
 
 	bool operator==(const Lyrics& lhs, const Lyrics& rhs);
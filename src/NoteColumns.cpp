@@ -0,0 +1,115 @@
+#include "NoteColumns.h"
+
+namespace libgp
+{
+	namespace
+	{
+		uint16_t packFlags(const Note& note)
+		{
+			auto& effect = note.effect;
+			uint16_t flags = 0;
+
+			if (effect.isAccentuated) flags |= NoteColumns::Accentuated;
+			if (effect.isHeavyAccentuatedNote) flags |= NoteColumns::HeavyAccentuated;
+			if (effect.isGhostNote) flags |= NoteColumns::Ghost;
+			if (effect.isHammer) flags |= NoteColumns::Hammer;
+			if (effect.letRing) flags |= NoteColumns::LetRing;
+			if (effect.palmMute) flags |= NoteColumns::PalmMute;
+			if (effect.isStaccato) flags |= NoteColumns::Staccato;
+			if (effect.hasVibrato) flags |= NoteColumns::Vibrato;
+			if (note.swapAccidentals) flags |= NoteColumns::SwapAccidentals;
+			if (effect.bend.type != BendType::None) flags |= NoteColumns::HasBend;
+			if (effect.grace) flags |= NoteColumns::HasGrace;
+			if (effect.harmonic) flags |= NoteColumns::HasHarmonic;
+			if (!effect.slides.empty()) flags |= NoteColumns::HasSlides;
+			if (effect.tremoloPicking) flags |= NoteColumns::HasTremoloPicking;
+			if (effect.trill) flags |= NoteColumns::HasTrill;
+
+			return flags;
+		}
+	}
+
+	size_t NoteColumns::size() const noexcept { return start.size(); }
+
+	void NoteColumns::reserve(size_t numNotes)
+	{
+		start.reserve(numNotes);
+		duration.reserve(numNotes);
+		measure.reserve(numNotes);
+		voice.reserve(numNotes);
+		string.reserve(numNotes);
+		value.reserve(numNotes);
+		velocity.reserve(numNotes);
+		type.reserve(numNotes);
+		flags.reserve(numNotes);
+	}
+
+	NoteColumns NoteColumns::fromTrack(const Track& track)
+	{
+		size_t numNotes = 0;
+		for (auto& measure : track.measures) {
+			for (auto& voice : measure.voices) {
+				for (auto& beat : voice.beats) {
+					numNotes += beat.notes.size();
+				}
+			}
+		}
+
+		NoteColumns columns;
+		columns.reserve(numNotes);
+
+		for (size_t m = 0; m < track.measures.size(); ++m) {
+			auto& voices = track.measures[m].voices;
+			for (size_t v = 0; v < voices.size(); ++v) {
+				for (auto& beat : voices[v].beats) {
+					for (auto& note : beat.notes) {
+						columns.add(static_cast<uint32_t>(m), static_cast<uint8_t>(v), beat, note);
+					}
+				}
+			}
+		}
+
+		return columns;
+	}
+
+	void NoteColumns::add(uint32_t measureIndex, uint8_t voiceIndex, const Beat& beat, const Note& note)
+	{
+		auto row = static_cast<uint32_t>(size());
+		auto noteFlags = packFlags(note);
+		auto& effect = note.effect;
+
+		start.push_back(beat.start);
+		duration.push_back(beat.duration.calcTime());
+		measure.push_back(measureIndex);
+		voice.push_back(voiceIndex);
+		string.push_back(note.string);
+		value.push_back(note.value);
+		velocity.push_back(note.velocity);
+		type.push_back(note.type);
+		flags.push_back(noteFlags);
+
+		if (noteFlags & HasBend) {
+			bends.add(row, effect.bend);
+		}
+
+		if (noteFlags & HasGrace) {
+			graces.add(row, *effect.grace);
+		}
+
+		if (noteFlags & HasHarmonic) {
+			harmonics.add(row, *effect.harmonic);
+		}
+
+		if (noteFlags & HasSlides) {
+			slides.add(row, effect.slides);
+		}
+
+		if (noteFlags & HasTremoloPicking) {
+			tremoloPickings.add(row, *effect.tremoloPicking);
+		}
+
+		if (noteFlags & HasTrill) {
+			trills.add(row, *effect.trill);
+		}
+	}
+}
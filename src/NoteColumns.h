@@ -0,0 +1,85 @@
+#pragma once
+
+#include "Arena.h"
+#include "Model.h"
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+
+namespace libgp
+{
+	// Effect values for the few rows that have them, keyed by row in ascending order
+	template<typename T>
+	struct SideTable
+	{
+		ArenaVector<uint32_t> rows;
+		ArenaVector<T> values;
+
+		const T* find(uint32_t row) const
+		{
+			auto it = std::lower_bound(rows.begin(), rows.end(), row);
+			return it != rows.end() && *it == row
+				? &values[it - rows.begin()]
+				: nullptr;
+		}
+
+		void add(uint32_t row, const T& value)
+		{
+			rows.push_back(row);
+			values.push_back(value);
+		}
+	};
+
+	// Columnar copy of a track's notes for scans over large numbers of songs. Row i
+	// of every column describes the same note, in measure, voice, beat and string
+	// order. Common note properties are packed into flags; the rarer effects are
+	// stored out of line in side tables.
+	struct NoteColumns
+	{
+		enum Flag : uint16_t
+		{
+			Accentuated = 0x0001,
+			HeavyAccentuated = 0x0002,
+			Ghost = 0x0004,
+			Hammer = 0x0008,
+			LetRing = 0x0010,
+			PalmMute = 0x0020,
+			Staccato = 0x0040,
+			Vibrato = 0x0080,
+			SwapAccidentals = 0x0100,
+			HasBend = 0x0200,
+			HasGrace = 0x0400,
+			HasHarmonic = 0x0800,
+			HasSlides = 0x1000,
+			HasTremoloPicking = 0x2000,
+			HasTrill = 0x4000
+		};
+
+		// Beat timing, in ticks
+		ArenaVector<uint32_t> start;
+		ArenaVector<uint32_t> duration;
+
+		ArenaVector<uint32_t> measure;
+		ArenaVector<uint8_t> voice;
+		ArenaVector<uint8_t> string;
+		ArenaVector<uint8_t> value;
+		ArenaVector<uint8_t> velocity;
+		ArenaVector<NoteType> type;
+		ArenaVector<uint16_t> flags;
+
+		SideTable<Bend> bends;
+		SideTable<Grace> graces;
+		SideTable<Harmonic> harmonics;
+		SideTable<ArenaVector<SlideType>> slides;
+		SideTable<TremoloPicking> tremoloPickings;
+		SideTable<Trill> trills;
+
+		size_t size() const noexcept;
+		void reserve(size_t numNotes);
+
+		static NoteColumns fromTrack(const Track& track);
+
+	private:
+		void add(uint32_t measureIndex, uint8_t voiceIndex, const Beat& beat, const Note& note);
+	};
+}
@@ -0,0 +1,126 @@
+#include "NoteIndex.h"
+#include "Model.h"
+#include <algorithm>
+
+namespace libgp
+{
+	NoteIndex NoteIndex::fromSong(const Song& song)
+	{
+		NoteIndex index;
+		index.tracks_.reserve(song.tracks.size());
+
+		for (size_t i = 0; i < song.tracks.size(); ++i) {
+			index.addTrack(static_cast<uint32_t>(i), song.tracks[i]);
+		}
+
+		return index;
+	}
+
+	void NoteIndex::addTrack(uint32_t trackIndex, const Track& track)
+	{
+		if (trackIndex >= tracks_.size()) {
+			tracks_.resize(trackIndex + 1);
+		}
+
+		auto& tree = tracks_[trackIndex];
+		tree.intervals.clear();
+
+		size_t numNotes = 0;
+		for (auto& measure : track.measures) {
+			for (auto& voice : measure.voices) {
+				for (auto& beat : voice.beats) {
+					numNotes += beat.notes.size();
+				}
+			}
+		}
+
+		tree.intervals.reserve(numNotes);
+		for (auto& measure : track.measures) {
+			for (auto& voice : measure.voices) {
+				for (auto& beat : voice.beats) {
+					auto end = beat.start + std::max<uint32_t>(beat.duration.calcTime(), 1);
+					for (auto& note : beat.notes) {
+						tree.intervals.push_back({ beat.start, end, trackIndex, &beat, &note });
+					}
+				}
+			}
+		}
+
+		// The voices of a measure are listed one after the other, so the notes
+		// are only mostly in order
+		std::stable_sort(tree.intervals.begin(), tree.intervals.end(), [](auto& lhs, auto& rhs) {
+			return lhs.start < rhs.start;
+		});
+
+		buildTree(tree);
+		tree.isIndexed = true;
+	}
+
+	bool NoteIndex::hasTrack(uint32_t trackIndex) const noexcept
+	{
+		return trackIndex < tracks_.size() && tracks_[trackIndex].isIndexed;
+	}
+
+	size_t NoteIndex::size() const noexcept
+	{
+		size_t numNotes = 0;
+		for (auto& tree : tracks_) {
+			numNotes += tree.intervals.size();
+		}
+
+		return numNotes;
+	}
+
+	std::vector<NoteInterval> NoteIndex::findNotes(uint32_t start, uint32_t end) const
+	{
+		std::vector<NoteInterval> notes;
+		forEachNote(start, end, [&](const NoteInterval& interval) { notes.push_back(interval); });
+		return notes;
+	}
+
+	// Node i sits at the level of the number of trailing ones in i, and spans
+	// the 2^level - 1 nodes on either side of it. Levels are filled in from the
+	// leaves up; the nodes past the end of the array that the last real nodes
+	// hang from take the latest end of what is below them.
+	void NoteIndex::buildTree(TrackTree& tree)
+	{
+		auto& intervals = tree.intervals;
+		auto& maxEnds = tree.maxEnds;
+		auto size = intervals.size();
+
+		maxEnds.assign(size, 0);
+		tree.maxLevel = -1;
+		if (size == 0) {
+			return;
+		}
+
+		size_t lastIndex = 0;
+		for (size_t i = 0; i < size; i += 2) {
+			lastIndex = i;
+			maxEnds[i] = intervals[i].end;
+		}
+
+		auto lastMax = maxEnds[lastIndex];
+
+		int level = 1;
+		for (; (size_t(1) << level) <= size; ++level) {
+			auto half = size_t(1) << (level - 1);
+			auto first = (half << 1) - 1;
+			auto step = half << 2;
+
+			for (auto i = first; i < size; i += step) {
+				auto leftMax = maxEnds[i - half];
+				auto rightMax = i + half < size ? maxEnds[i + half] : lastMax;
+				maxEnds[i] = std::max({ intervals[i].end, leftMax, rightMax });
+			}
+
+			// Up to the parent of the last node
+			lastIndex = (lastIndex >> level) & 1 ? lastIndex - half : lastIndex + half;
+			if (lastIndex < size && maxEnds[lastIndex] > lastMax) {
+				lastMax = maxEnds[lastIndex];
+			}
+		}
+
+		tree.maxLevel = level - 1;
+	}
+}
@@ -0,0 +1,136 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace libgp
+{
+	struct Beat;
+	struct Note;
+	struct Song;
+	struct Track;
+
+	// A note and the ticks it sounds over, from its start up to but not
+	// including its end
+	struct NoteInterval
+	{
+		uint32_t start;
+		uint32_t end;
+		uint32_t track;
+		const Beat* beat;
+		const Note* note;
+	};
+
+	// Finds the notes that sound within a range of ticks without walking the
+	// measures. Each track is an implicit interval tree: its notes sorted by
+	// start, read as the in-order layout of a binary tree in which every node
+	// also holds the latest end below it. A query visits only the subtrees that
+	// can overlap the range, so it takes logarithmic time plus the notes found.
+	//
+	// Ticks are those of the beats, each note lasting as long as its beat.
+	// Tracks are indexed one at a time and independently of each other, so a
+	// song can be indexed as its tracks are loaded, and a track that changed
+	// indexed again on its own. The index points into the song, which must
+	// outlive it.
+	class NoteIndex
+	{
+	public:
+		static NoteIndex fromSong(const Song& song);
+
+		// Indexes the notes of a track, replacing those indexed for it before
+		void addTrack(uint32_t trackIndex, const Track& track);
+		bool hasTrack(uint32_t trackIndex) const noexcept;
+
+		// The number of notes indexed over all tracks
+		size_t size() const noexcept;
+
+		// Calls the function with each note of the track that sounds at some
+		// tick from start up to end, in order of their start
+		template<typename Function>
+		void forEachNote(uint32_t trackIndex, uint32_t start, uint32_t end, Function&& function) const;
+
+		// The same over every track indexed, one track after another
+		template<typename Function>
+		void forEachNote(uint32_t start, uint32_t end, Function&& function) const;
+
+		std::vector<NoteInterval> findNotes(uint32_t start, uint32_t end) const;
+
+	private:
+		struct TrackTree
+		{
+			std::vector<NoteInterval> intervals;
+			std::vector<uint32_t> maxEnds;
+			int maxLevel = -1;
+			bool isIndexed = false;
+		};
+
+		std::vector<TrackTree> tracks_;
+
+		static void buildTree(TrackTree& tree);
+	};
+
+	template<typename Function>
+	void NoteIndex::forEachNote(uint32_t trackIndex, uint32_t start, uint32_t end, Function&& function) const
+	{
+		if (trackIndex >= tracks_.size() || tracks_[trackIndex].maxLevel < 0 || start >= end) {
+			return;
+		}
+
+		// Subtrees this small are scanned rather than descended into
+		const int ScanLevel = 3;
+
+		struct Node
+		{
+			int level;
+			size_t index;
+			bool isLeftDone;
+		};
+
+		auto& tree = tracks_[trackIndex];
+		auto& intervals = tree.intervals;
+		auto& maxEnds = tree.maxEnds;
+		auto size = intervals.size();
+
+		// Nodes past the end of the array stand for subtrees that are only
+		// partly filled
+		Node stack[64];
+		int top = 0;
+		stack[top++] = { tree.maxLevel, (size_t(1) << tree.maxLevel) - 1, false };
+
+		while (top > 0) {
+			auto node = stack[--top];
+
+			if (node.level <= ScanLevel) {
+				auto first = node.index >> node.level << node.level;
+				auto last = std::min(first + (size_t(1) << (node.level + 1)) - 1, size);
+				for (auto i = first; i < last && intervals[i].start < end; ++i) {
+					if (start < intervals[i].end) {
+						function(intervals[i]);
+					}
+				}
+			} else if (!node.isLeftDone) {
+				auto left = node.index - (size_t(1) << (node.level - 1));
+				stack[top++] = { node.level, node.index, true };
+				if (left >= size || maxEnds[left] > start) {
+					stack[top++] = { node.level - 1, left, false };
+				}
+			} else if (node.index < size && intervals[node.index].start < end) {
+				if (start < intervals[node.index].end) {
+					function(intervals[node.index]);
+				}
+
+				stack[top++] = { node.level - 1, node.index + (size_t(1) << (node.level - 1)), false };
+			}
+		}
+	}
+
+	template<typename Function>
+	void NoteIndex::forEachNote(uint32_t start, uint32_t end, Function&& function) const
+	{
+		for (size_t i = 0; i < tracks_.size(); ++i) {
+			forEachNote(static_cast<uint32_t>(i), start, end, function);
+		}
+	}
+}
@@ -0,0 +1,13 @@
+#include "SongStorage.h"
+
+namespace libgp
+{
+	Arena& SongStorage::arena() noexcept { return arena_; }
+
+	Arena& SongStorage::addArena()
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		arenas_.push_back(std::make_unique<Arena>());
+		return *arenas_.back();
+	}
+}
@@ -0,0 +1,28 @@
+#pragma once
+
+#include "Arena.h"
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace libgp
+{
+	// Owns the memory behind a song's containers: the arena they allocate from,
+	// and one more for each thread of a parallel parse.
+	//
+	// Adding arenas is safe to do from several threads at once; allocating from
+	// any one arena is not.
+	class SongStorage
+	{
+	public:
+		Arena& arena() noexcept;
+
+		// Adds an arena for one thread of a parallel parse to allocate from
+		Arena& addArena();
+
+	private:
+		std::mutex mutex_;
+		Arena arena_;
+		std::vector<std::unique_ptr<Arena>> arenas_;
+	};
+}
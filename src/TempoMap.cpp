@@ -0,0 +1,198 @@
+#include "TempoMap.h"
+#include "Model.h"
+#include "Timeline.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <utility>
+
+namespace libgp
+{
+	namespace
+	{
+		// The run of values from first on that fall into the segment from start
+		// to end, where the first segment also takes everything before it
+		template<typename T, typename U>
+		size_t findRunEnd(const T* values, size_t first, size_t count, U start, U end, bool isFirstSegment)
+		{
+			auto last = first;
+			while (last < count && (isFirstSegment || values[last] >= start) && values[last] < end) {
+				++last;
+			}
+
+			return last;
+		}
+	}
+
+	TempoMap TempoMap::fromSong(const Song& song)
+	{
+		auto& timeline = song.timeline();
+
+		TempoMap map;
+		map.ticks_.reserve(timeline.size() + 1);
+		map.seconds_.reserve(timeline.size() + 1);
+		map.secondsPerTick_.reserve(timeline.size() + 1);
+
+		// Mix table changes of a measure, as ticks into the measure and tempos
+		std::vector<std::pair<uint32_t, uint32_t>> changes;
+
+		auto tempo = song.tempo.value;
+		for (auto& entry : timeline.entries) {
+			auto& header = song.measureHeaders[entry.measure];
+
+			changes.clear();
+			for (auto& track : song.tracks) {
+				if (entry.measure >= track.measures.size()) {
+					continue;
+				}
+
+				for (auto& voice : track.measures[entry.measure].voices) {
+					for (auto& beat : voice.beats) {
+						auto& change = beat.effect.mixTableChange;
+						if (change && change->tempo >= 0 && beat.start >= header.start) {
+							changes.emplace_back(beat.start - header.start, static_cast<uint32_t>(change->tempo));
+						}
+					}
+				}
+			}
+
+			// Without the beats, as for tracks not loaded yet, the tempo of the
+			// measure holds from its start
+			if (changes.empty()) {
+				tempo = entry.tempo;
+				map.addSegment(entry.start, tempo);
+				continue;
+			}
+
+			std::stable_sort(changes.begin(), changes.end(), [](auto& lhs, auto& rhs) { return lhs.first < rhs.first; });
+
+			map.addSegment(entry.start, tempo);
+			for (auto& [offset, changeTempo] : changes) {
+				tempo = changeTempo;
+				map.addSegment(entry.start + offset, tempo);
+			}
+		}
+
+		if (map.ticks_.empty()) {
+			auto start = !song.measureHeaders.empty() ? song.measureHeaders[0].start : static_cast<uint32_t>(Duration::QuarterTime);
+			map.addSegment(start, tempo);
+		}
+
+		return map;
+	}
+
+	size_t TempoMap::size() const noexcept { return ticks_.size(); }
+
+	uint32_t TempoMap::segmentStart(size_t segment) const noexcept { return ticks_[segment]; }
+
+	uint32_t TempoMap::microsecondsPerQuarter(size_t segment) const noexcept
+	{
+		return static_cast<uint32_t>(std::lround(secondsPerTick_[segment] * Duration::QuarterTime * 1000000));
+	}
+
+	double TempoMap::toSeconds(uint32_t tick) const
+	{
+		auto i = findSegment(tick);
+		return seconds_[i] + (static_cast<double>(tick) - ticks_[i]) * secondsPerTick_[i];
+	}
+
+	double TempoMap::toTick(double seconds) const
+	{
+		auto i = findSegment(seconds);
+		return ticks_[i] + (seconds - seconds_[i]) / secondsPerTick_[i];
+	}
+
+	void TempoMap::toSeconds(const uint32_t* ticks, size_t count, double* seconds) const
+	{
+		size_t segment = 0;
+		size_t first = 0;
+		while (first < count) {
+			auto tick = ticks[first];
+			auto isNextSegment = segment + 1 < ticks_.size()
+				&& tick >= ticks_[segment + 1]
+				&& (segment + 2 >= ticks_.size() || tick < ticks_[segment + 2]);
+			segment = isNextSegment ? segment + 1 : findSegment(tick);
+
+			auto end = segment + 1 < ticks_.size() ? ticks_[segment + 1] : std::numeric_limits<uint32_t>::max();
+			auto last = findRunEnd(ticks, first, count, ticks_[segment], end, segment == 0);
+			if (last == first) {
+				last = first + 1;
+			}
+
+			auto secondsPerTick = secondsPerTick_[segment];
+			auto offset = seconds_[segment] - ticks_[segment] * secondsPerTick;
+			for (auto i = first; i < last; ++i) {
+				seconds[i] = offset + ticks[i] * secondsPerTick;
+			}
+
+			first = last;
+		}
+	}
+
+	void TempoMap::toTicks(const double* seconds, size_t count, double* ticks) const
+	{
+		size_t segment = 0;
+		size_t first = 0;
+		while (first < count) {
+			auto time = seconds[first];
+			auto isNextSegment = segment + 1 < seconds_.size()
+				&& time >= seconds_[segment + 1]
+				&& (segment + 2 >= seconds_.size() || time < seconds_[segment + 2]);
+			segment = isNextSegment ? segment + 1 : findSegment(time);
+
+			auto end = segment + 1 < seconds_.size() ? seconds_[segment + 1] : std::numeric_limits<double>::infinity();
+			auto last = findRunEnd(seconds, first, count, seconds_[segment], end, segment == 0);
+			if (last == first) {
+				last = first + 1;
+			}
+
+			auto ticksPerSecond = 1.0 / secondsPerTick_[segment];
+			auto offset = ticks_[segment] - seconds_[segment] * ticksPerSecond;
+			for (auto i = first; i < last; ++i) {
+				ticks[i] = offset + seconds[i] * ticksPerSecond;
+			}
+
+			first = last;
+		}
+	}
+
+	// Segments of the same tempo are merged, and a change at the tick the last
+	// segment starts at replaces its tempo
+	void TempoMap::addSegment(uint32_t tick, uint32_t tempo)
+	{
+		auto secondsPerTick = 60.0 / (std::max<uint32_t>(tempo, 1) * static_cast<double>(Duration::QuarterTime));
+
+		if (ticks_.empty()) {
+			ticks_.push_back(tick);
+			seconds_.push_back(0.0);
+			secondsPerTick_.push_back(secondsPerTick);
+			return;
+		}
+
+		if (secondsPerTick == secondsPerTick_.back()) {
+			return;
+		}
+
+		tick = std::max(tick, ticks_.back());
+		if (tick == ticks_.back()) {
+			secondsPerTick_.back() = secondsPerTick;
+			return;
+		}
+
+		seconds_.push_back(seconds_.back() + (tick - ticks_.back()) * secondsPerTick_.back());
+		ticks_.push_back(tick);
+		secondsPerTick_.push_back(secondsPerTick);
+	}
+
+	size_t TempoMap::findSegment(uint32_t tick) const noexcept
+	{
+		auto it = std::upper_bound(ticks_.begin(), ticks_.end(), tick);
+		return it != ticks_.begin() ? (it - ticks_.begin()) - 1 : 0;
+	}
+
+	size_t TempoMap::findSegment(double seconds) const noexcept
+	{
+		auto it = std::upper_bound(seconds_.begin(), seconds_.end(), seconds);
+		return it != seconds_.begin() ? (it - seconds_.begin()) - 1 : 0;
+	}
+}
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace libgp
+{
+	struct Song;
+
+	// Converts between ticks and seconds along a song's timeline. The tempo is
+	// kept as segments of constant tempo, one for each change, with the time
+	// each segment starts at added up in advance; a conversion is a binary
+	// search for its segment.
+	//
+	// Tempo changes come from the tempo of each measure played and from the mix
+	// table changes of the beats within it, which take effect at their beat.
+	// Ticks are those of the song's timeline, which for the first pass through
+	// a measure are the ticks of its beats; tick Duration::QuarterTime, the
+	// start of the first measure, is at 0 seconds.
+	class TempoMap
+	{
+	public:
+		static TempoMap fromSong(const Song& song);
+
+		size_t size() const noexcept;
+
+		// The tick a segment starts at, and how long a quarter note lasts in it
+		// in microseconds, as MIDI sets the tempo
+		uint32_t segmentStart(size_t segment) const noexcept;
+		uint32_t microsecondsPerQuarter(size_t segment) const noexcept;
+
+		double toSeconds(uint32_t tick) const;
+		double toTick(double seconds) const;
+
+		// Converts many values at once. Runs of values in ascending order walk
+		// the segments instead of searching them, and the values in each segment
+		// are converted in one tight loop.
+		void toSeconds(const uint32_t* ticks, size_t count, double* seconds) const;
+		void toTicks(const double* seconds, size_t count, double* ticks) const;
+
+	private:
+		// One entry for each segment, in order
+		std::vector<uint32_t> ticks_;
+		std::vector<double> seconds_;
+		std::vector<double> secondsPerTick_;
+
+		TempoMap() = default;
+
+		void addSegment(uint32_t tick, uint32_t tempo);
+		size_t findSegment(uint32_t tick) const noexcept;
+		size_t findSegment(double seconds) const noexcept;
+	};
+}
@@ -0,0 +1,159 @@
+#include "ThreadPool.h"
+#include <algorithm>
+
+namespace libgp
+{
+	namespace
+	{
+		// The pool whose task the current thread is running, if any
+		thread_local const ThreadPool* currentPool = nullptr;
+	}
+
+	ThreadPool::ThreadPool(size_t numThreads) :
+		task_(nullptr),
+		generation_(0),
+		active_(0),
+		stop_(false)
+	{
+		if (numThreads == 0) {
+			numThreads = std::max<size_t>(std::thread::hardware_concurrency(), 1);
+		}
+
+		// The calling thread takes the last range, so only numThreads - 1 are spawned
+		ranges_ = std::make_unique<Range[]>(numThreads);
+		threads_.reserve(numThreads - 1);
+		for (size_t i = 0; i + 1 < numThreads; ++i) {
+			threads_.emplace_back(&ThreadPool::workerLoop, this, i);
+		}
+	}
+
+	ThreadPool::~ThreadPool()
+	{
+		{
+			std::lock_guard<std::mutex> lock(mutex_);
+			stop_ = true;
+		}
+
+		wake_.notify_all();
+		for (auto& thread : threads_) {
+			thread.join();
+		}
+	}
+
+	size_t ThreadPool::size() const noexcept { return threads_.size() + 1; }
+
+	void ThreadPool::parallelFor(size_t count, const std::function<void(size_t)>& task)
+	{
+		if (count == 0) {
+			return;
+		}
+
+		if (threads_.empty() || count == 1 || currentPool == this) {
+			for (size_t i = 0; i < count; ++i) {
+				task(i);
+			}
+
+			return;
+		}
+
+		std::lock_guard<std::mutex> call(callMutex_);
+
+		auto numWorkers = size();
+		for (size_t i = 0; i < numWorkers; ++i) {
+			std::lock_guard<std::mutex> lock(ranges_[i].mutex);
+			ranges_[i].begin = count * i / numWorkers;
+			ranges_[i].end = count * (i + 1) / numWorkers;
+		}
+
+		{
+			std::lock_guard<std::mutex> lock(mutex_);
+			task_ = &task;
+			active_ = threads_.size();
+			error_ = nullptr;
+			++generation_;
+		}
+
+		wake_.notify_all();
+
+		auto previous = currentPool;
+		currentPool = this;
+		work(threads_.size());
+		currentPool = previous;
+
+		std::exception_ptr error;
+		{
+			std::unique_lock<std::mutex> lock(mutex_);
+			done_.wait(lock, [this] { return active_ == 0; });
+			task_ = nullptr;
+			std::swap(error, error_);
+		}
+
+		if (error) {
+			std::rethrow_exception(error);
+		}
+	}
+
+	void ThreadPool::workerLoop(size_t worker)
+	{
+		currentPool = this;
+
+		uint64_t generation = 0;
+		for (;;) {
+			{
+				std::unique_lock<std::mutex> lock(mutex_);
+				wake_.wait(lock, [this, generation] { return stop_ || generation_ != generation; });
+				if (stop_) {
+					return;
+				}
+
+				generation = generation_;
+			}
+
+			work(worker);
+
+			std::lock_guard<std::mutex> lock(mutex_);
+			if (--active_ == 0) {
+				done_.notify_one();
+			}
+		}
+	}
+
+	void ThreadPool::work(size_t worker)
+	{
+		size_t index;
+		while (next(worker, index)) {
+			try {
+				(*task_)(index);
+			} catch (...) {
+				std::lock_guard<std::mutex> lock(mutex_);
+				if (!error_) {
+					error_ = std::current_exception();
+				}
+			}
+		}
+	}
+
+	bool ThreadPool::next(size_t worker, size_t& index)
+	{
+		{
+			auto& own = ranges_[worker];
+			std::lock_guard<std::mutex> lock(own.mutex);
+			if (own.begin < own.end) {
+				index = own.begin++;
+				return true;
+			}
+		}
+
+		auto numWorkers = size();
+		for (size_t i = 1; i < numWorkers; ++i) {
+			auto& victim = ranges_[(worker + i) % numWorkers];
+			std::lock_guard<std::mutex> lock(victim.mutex);
+			if (victim.begin < victim.end) {
+				index = --victim.end;
+				return true;
+			}
+		}
+
+		return false;
+	}
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace libgp
+{
+	// Fixed set of worker threads for running indexed tasks in parallel. Each call
+	// to parallelFor splits the indices into one contiguous range per worker;
+	// workers take from the front of their own range and, once it is empty, steal
+	// from the back of the others, so uneven task sizes still keep every core busy.
+	class ThreadPool
+	{
+	public:
+		// A thread count of 0 uses one thread per hardware core
+		explicit ThreadPool(size_t numThreads = 0);
+		~ThreadPool();
+
+		ThreadPool(const ThreadPool&) = delete;
+		ThreadPool& operator=(const ThreadPool&) = delete;
+
+		// Number of threads working on a parallelFor, including the calling thread
+		size_t size() const noexcept;
+
+		// Runs task(i) for every i in [0, count) and returns once all are done. The
+		// calling thread works too. Nested calls from inside a task run inline. The
+		// first exception thrown by a task is rethrown once the rest have finished.
+		void parallelFor(size_t count, const std::function<void(size_t)>& task);
+
+	private:
+		struct Range
+		{
+			std::mutex mutex;
+			size_t begin = 0;
+			size_t end = 0;
+		};
+
+		std::vector<std::thread> threads_;
+		std::unique_ptr<Range[]> ranges_;
+
+		std::mutex callMutex_;
+		std::mutex mutex_;
+		std::condition_variable wake_;
+		std::condition_variable done_;
+		const std::function<void(size_t)>* task_;
+		uint64_t generation_;
+		size_t active_;
+		bool stop_;
+		std::exception_ptr error_;
+
+		void workerLoop(size_t worker);
+		void work(size_t worker);
+		bool next(size_t worker, size_t& index);
+	};
+}
@@ -0,0 +1,201 @@
+#include "Timeline.h"
+#include "Model.h"
+#include <algorithm>
+#include <iterator>
+#include <string_view>
+
+namespace libgp
+{
+	namespace
+	{
+		// Where a jump ends: at the Coda or Double Coda its "Da Coda" sign leads
+		// to, or at the Fine
+		enum class JumpEnd : uint8_t
+		{
+			None,
+			Coda,
+			DoubleCoda,
+			Fine
+		};
+
+		struct JumpSign
+		{
+			std::string_view name;
+			// The sign the jump goes to, or none for the start of the song
+			std::string_view target;
+			JumpEnd end;
+		};
+
+		const JumpSign JumpSigns[] = {
+			{ "Da Capo", "", JumpEnd::None },
+			{ "Da Capo al Coda", "", JumpEnd::Coda },
+			{ "Da Capo al Double Coda", "", JumpEnd::DoubleCoda },
+			{ "Da Capo al Fine", "", JumpEnd::Fine },
+			{ "Da Segno", "Segno", JumpEnd::None },
+			{ "Da Segno al Coda", "Segno", JumpEnd::Coda },
+			{ "Da Segno al Double Coda", "Segno", JumpEnd::DoubleCoda },
+			{ "Da Segno al Fine", "Segno", JumpEnd::Fine },
+			{ "Da Segno Segno", "Segno Segno", JumpEnd::None },
+			{ "Da Segno Segno al Coda", "Segno Segno", JumpEnd::Coda },
+			{ "Da Segno Segno al Double Coda", "Segno Segno", JumpEnd::DoubleCoda },
+			{ "Da Segno Segno al Fine", "Segno Segno", JumpEnd::Fine }
+		};
+
+		const size_t NotFound = static_cast<size_t>(-1);
+
+		size_t findDirection(const ArenaVector<MeasureHeader>& headers, std::string_view direction)
+		{
+			if (direction.empty()) {
+				return 0;
+			}
+
+			for (size_t i = 0; i < headers.size(); ++i) {
+				if (headers[i].direction == direction) {
+					return i;
+				}
+			}
+
+			return NotFound;
+		}
+
+		// Marks the endings that no later ending of the same repeat comes after,
+		// which are the ones taken once a jump has been made
+		std::vector<bool> findLastEndings(const ArenaVector<MeasureHeader>& headers)
+		{
+			std::vector<bool> lastEndings(headers.size());
+			uint8_t laterEndings = 0;
+
+			for (size_t i = headers.size(); i > 0; --i) {
+				auto& header = headers[i - 1];
+				if (header.repeatAlternative != 0) {
+					lastEndings[i - 1] = header.repeatAlternative >= laterEndings;
+					laterEndings |= header.repeatAlternative;
+				}
+
+				if (header.isRepeatOpen) {
+					laterEndings = 0;
+				}
+			}
+
+			return lastEndings;
+		}
+	}
+
+	size_t Timeline::size() const noexcept { return entries.size(); }
+
+	Timeline Timeline::fromSong(const Song& song)
+	{
+		auto& headers = song.measureHeaders;
+
+		Timeline timeline;
+		timeline.entries.reserve(headers.size());
+		if (headers.empty()) {
+			return timeline;
+		}
+
+		timeline.end = headers[0].start;
+		auto lastEndings = findLastEndings(headers);
+
+		size_t index = 0;
+		size_t furthest = 0;
+
+		// The repeat being played: where it starts and which pass through it
+		// this is. Once its closing measure is passed for good, the pass is kept
+		// for the endings after it until a measure of no ending is played.
+		size_t repeatStart = 0;
+		int32_t pass = 0;
+		bool isRepeatDone = false;
+		bool isSkippingEnding = false;
+
+		uint32_t takenJumps = 0;
+		bool hasJumped = false;
+		auto jumpEnd = JumpEnd::None;
+
+		while (index < headers.size()) {
+			auto& header = headers[index];
+
+			// Coming back to the start of a repeat is another pass through it
+			if (header.isRepeatOpen && index >= furthest) {
+				repeatStart = index;
+				pass = 0;
+				isRepeatDone = false;
+				isSkippingEnding = false;
+			}
+
+			furthest = std::max(furthest, index + 1);
+
+			if (header.repeatAlternative != 0) {
+				isSkippingEnding = hasJumped
+					? !lastEndings[index]
+					: pass >= 8 || !(header.repeatAlternative & (1 << pass));
+			} else if (!isSkippingEnding && isRepeatDone) {
+				pass = 0;
+				isRepeatDone = false;
+			}
+
+			// An ending runs up to the closing measure of its repeat, or to the
+			// next ending
+			if (isSkippingEnding) {
+				if (header.repeatClose > -1) {
+					isSkippingEnding = false;
+					repeatStart = index + 1;
+					isRepeatDone = true;
+				}
+
+				++index;
+				continue;
+			}
+
+			timeline.entries.push_back({ static_cast<uint32_t>(index), timeline.end, header.tempo });
+			timeline.end += header.calcLength();
+
+			if (header.repeatClose > -1 && !hasJumped) {
+				if (pass < header.repeatClose) {
+					++pass;
+					index = repeatStart;
+					continue;
+				}
+
+				repeatStart = index + 1;
+				isRepeatDone = true;
+			}
+
+			if (jumpEnd == JumpEnd::Fine && header.direction == "Fine") {
+				break;
+			}
+
+			auto target = NotFound;
+			if (jumpEnd == JumpEnd::Coda && header.fromDirection == "Da Coda") {
+				target = findDirection(headers, "Coda");
+			} else if (jumpEnd == JumpEnd::DoubleCoda && header.fromDirection == "Da Double Coda") {
+				target = findDirection(headers, "Double Coda");
+			}
+
+			if (target != NotFound) {
+				jumpEnd = JumpEnd::None;
+				index = target;
+				continue;
+			}
+
+			for (size_t i = 0; i < std::size(JumpSigns); ++i) {
+				auto& sign = JumpSigns[i];
+				if (header.fromDirection != sign.name || (takenJumps & (1 << i))) {
+					continue;
+				}
+
+				target = findDirection(headers, sign.target);
+				if (target != NotFound) {
+					takenJumps |= 1 << i;
+					hasJumped = true;
+					jumpEnd = sign.end;
+				}
+
+				break;
+			}
+
+			index = target != NotFound ? target : index + 1;
+		}
+
+		return timeline;
+	}
+}
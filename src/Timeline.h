@@ -0,0 +1,40 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace libgp
+{
+	struct Song;
+
+	// A measure as it is played: the index of its header, the tick it starts at
+	// and its tempo
+	struct TimelineEntry
+	{
+		uint32_t measure;
+		uint32_t start;
+		uint32_t tempo;
+	};
+
+	// The measures of a song in the order they are played, with repeats,
+	// alternate endings and direction signs unrolled. Ticks count on from the
+	// start of the first measure header, so a beat of the first pass through
+	// a measure starts at the same tick on the timeline as in the measure.
+	//
+	// Repeats are played as many times as their closing measure says, taking
+	// the ending of each pass. A jump sign (Da Capo, Da Segno and their "al"
+	// forms) is taken once; after it repeats are not played again and only the
+	// last ending of each repeat is taken, and the Coda, Double Coda or Fine it
+	// leads to ends the jump.
+	struct Timeline
+	{
+		std::vector<TimelineEntry> entries;
+		// The tick the last measure played ends at
+		uint32_t end = 0;
+
+		size_t size() const noexcept;
+
+		static Timeline fromSong(const Song& song);
+	};
+}
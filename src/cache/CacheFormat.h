@@ -0,0 +1,160 @@
+#pragma once
+
+#include "../Model.h"
+#include <type_traits>
+
+// Layout of libgp's song cache, a binary snapshot of a parsed song that loads
+// much faster than the file it came from. All values are little-endian.
+//
+//   version        byte length + 30 bytes, e.g. "LIBGP SONG CACHE v1.00"
+//   outline        song info, master effect, measure headers and tracks
+//                  (everything but the measures)
+//   track table    u64 offset of each track's measure block, then the end of
+//                  the last block
+//   measure blocks per track: u32 measure count, u64 offset of each measure
+//                  followed by the end of the last one, then the measures
+//
+// Text is stored as u32 length + bytes, so a mapped cache can point the song's
+// text straight into the file. Containers are stored as u32 count + elements
+// and optionals as a presence byte + value.
+namespace libgp
+{
+	namespace cache
+	{
+		const char* const Version = "LIBGP SONG CACHE v1.00";
+	}
+
+	// Picks the field list of a model struct for the writer, which passes it
+	// const, and for the reader alike
+	template<typename S, typename T>
+	using Described = std::enable_if_t<std::is_same<std::remove_const_t<S>, T>::value>;
+
+	// The fields of each model struct in cache order, shared by the writer and
+	// the reader. Measures and voices are handled by both sides directly, as they
+	// are built in place with references to their owners.
+	template<typename Archive, typename S> Described<S, LyricLine> describe(Archive& a, S& v) { a(v.startingMeasure, v.lyrics); }
+	template<typename Archive, typename S> Described<S, Lyrics> describe(Archive& a, S& v) { a(v.trackNumber, v.lines); }
+	template<typename Archive, typename S> Described<S, Tempo> describe(Archive& a, S& v) { a(v.name, v.value, v.isHidden); }
+	template<typename Archive, typename S> Described<S, Tuplet> describe(Archive& a, S& v) { a(v.enters, v.times); }
+	template<typename Archive, typename S> Described<S, Duration> describe(Archive& a, S& v) { a(v.value, v.isDotted, v.isDoubleDotted, v.tuplet); }
+	template<typename Archive, typename S> Described<S, TimeSignature> describe(Archive& a, S& v) { a(v.numerator, v.denominator, v.beams); }
+	template<typename Archive, typename S> Described<S, Color> describe(Archive& a, S& v) { a(v.red, v.green, v.blue, v.alpha); }
+	template<typename Archive, typename S> Described<S, Marker> describe(Archive& a, S& v) { a(v.title, v.color); }
+	template<typename Archive, typename S> Described<S, BendPoint> describe(Archive& a, S& v) { a(v.position, v.value, v.hasVibrato); }
+	template<typename Archive, typename S> Described<S, Bend> describe(Archive& a, S& v) { a(v.type, v.value, v.points); }
+	template<typename Archive, typename S> Described<S, TremoloPicking> describe(Archive& a, S& v) { a(v.duration); }
+	template<typename Archive, typename S> Described<S, Trill> describe(Archive& a, S& v) { a(v.fret, v.duration); }
+	template<typename Archive, typename S> Described<S, BeatStroke> describe(Archive& a, S& v) { a(v.direction, v.value); }
+	template<typename Archive, typename S> Described<S, GuitarString> describe(Archive& a, S& v) { a(v.number, v.value); }
+	template<typename Archive, typename S> Described<S, Barre> describe(Archive& a, S& v) { a(v.fret, v.start, v.end); }
+	template<typename Archive, typename S> Described<S, WahEffect> describe(Archive& a, S& v) { a(v.value, v.display); }
+	template<typename Archive, typename S> Described<S, MixTableItem> describe(Archive& a, S& v) { a(v.value, v.duration, v.allTracks); }
+	template<typename Archive, typename S> Described<S, RSEEqualizer> describe(Archive& a, S& v) { a(v.knobs, v.gain); }
+	template<typename Archive, typename S> Described<S, RSEMasterEffect> describe(Archive& a, S& v) { a(v.volume, v.reverb, v.equalizer); }
+	template<typename Archive, typename S> Described<S, TrackRSE> describe(Archive& a, S& v) { a(v.instrument, v.equalizer, v.humanize, v.autoAccentuation); }
+
+	template<typename Archive, typename S>
+	Described<S, PageSetup> describe(Archive& a, S& v)
+	{
+		a(v.sizeX, v.sizeY, v.marginLeft, v.marginRight, v.marginTop, v.marginBottom, v.scoreSizeProportion, v.headerAndFooter);
+		a(v.title, v.subtitle, v.artist, v.album, v.wordsBy, v.musicBy, v.wordsAndMusicBy, v.copyright, v.pageNumber);
+	}
+
+	template<typename Archive, typename S>
+	Described<S, MidiChannel> describe(Archive& a, S& v)
+	{
+		a(v.channel, v.effectChannel, v.instrument, v.volume, v.balance, v.chorus, v.reverb, v.phaser, v.tremolo, v.bank);
+	}
+
+	template<typename Archive, typename S>
+	Described<S, MeasureHeader> describe(Archive& a, S& v)
+	{
+		a(v.number, v.start, v.hasDoubleBar, v.keySignature, v.timeSignature, v.tempo, v.marker);
+		a(v.isRepeatOpen, v.repeatAlternative, v.repeatClose, v.tripletFeel, v.direction, v.fromDirection);
+	}
+
+	template<typename Archive, typename S>
+	Described<S, Grace> describe(Archive& a, S& v)
+	{
+		a(v.duration, v.fret, v.isDead, v.isOnBeat, v.transition, v.velocity);
+	}
+
+	template<typename Archive, typename S>
+	Described<S, Harmonic> describe(Archive& a, S& v)
+	{
+		a(v.type, v.pitch, v.accidental, v.octave, v.fret);
+	}
+
+	template<typename Archive, typename S>
+	Described<S, NoteEffect> describe(Archive& a, S& v)
+	{
+		a(v.isAccentuated, v.bend, v.isGhostNote, v.grace, v.isHammer, v.harmonic, v.isHeavyAccentuatedNote, v.leftHandFingering);
+		a(v.letRing, v.palmMute, v.rightHandFingering, v.slides, v.isStaccato, v.tremoloPicking, v.trill, v.hasVibrato);
+	}
+
+	template<typename Archive, typename S>
+	Described<S, Note> describe(Archive& a, S& v)
+	{
+		a(v.value, v.velocity, v.string, v.effect, v.durationPercent, v.swapAccidentals, v.type);
+	}
+
+	template<typename Archive, typename S>
+	Described<S, Chord> describe(Archive& a, S& v)
+	{
+		a(v.length, v.isSharp, v.root, v.type, v.extension, v.bass, v.tonality, v.add, v.name, v.fifth, v.ninth, v.eleventh);
+		a(v.firstFret, v.strings, v.barres, v.omissions, v.fingerings, v.show, v.isNewFormat);
+	}
+
+	template<typename Archive, typename S>
+	Described<S, RSEInstrument> describe(Archive& a, S& v)
+	{
+		a(v.instrument, v.unknown, v.soundBank, v.effectNumber, v.effectCategory, v.effect);
+	}
+
+	template<typename Archive, typename S>
+	Described<S, MixTableChange> describe(Archive& a, S& v)
+	{
+		a(v.instrument, v.rse, v.volume, v.balance, v.chorus, v.reverb, v.phaser, v.tremolo);
+		a(v.tempoName, v.tempo, v.tempoDuration, v.hideTempo, v.wah, v.useRSE);
+	}
+
+	template<typename Archive, typename S>
+	Described<S, BeatEffect> describe(Archive& a, S& v)
+	{
+		a(v.stroke, v.hasRasgueado, v.pickStroke, v.chord, v.hasFadeIn, v.tremoloBar, v.mixTableChange, v.slapEffect, v.vibrato);
+	}
+
+	template<typename Archive, typename S>
+	Described<S, BeatDisplay> describe(Archive& a, S& v)
+	{
+		a(v.breakBeam, v.forceBeam, v.beamDirection, v.tupletBracket, v.breakSecondary, v.breakSecondaryTuplet, v.forceBracket);
+	}
+
+	template<typename Archive, typename S>
+	Described<S, Beat> describe(Archive& a, S& v)
+	{
+		a(v.notes, v.duration, v.text, v.start, v.effect, v.index, v.octave, v.display, v.status);
+	}
+
+	template<typename Archive, typename S>
+	Described<S, TrackSettings> describe(Archive& a, S& v)
+	{
+		a(v.showTablature, v.showNotation, v.diagramsAreBelow, v.showRhythm, v.forceHorizontal, v.forceChannels);
+		a(v.showDiagramList, v.showDiagramsInScore, v.autoLetRing, v.autoBrush, v.extendRhythmic);
+	}
+
+	// Measures are stored separately, in the track's measure block
+	template<typename Archive, typename S>
+	Described<S, Track> describe(Archive& a, S& v)
+	{
+		a(v.number, v.numFrets, v.offset, v.isPercussionTrack, v.is12StringGuitarTrack, v.isBanjoTrack, v.isVisible, v.isSolo, v.isMute);
+		a(v.indicateTuning, v.name, v.strings, v.port, v.channel, v.color, v.settings, v.useRSE, v.rse);
+	}
+
+	template<typename Archive, typename S>
+	Described<S, SongInfo> describe(Archive& a, S& v)
+	{
+		a(v.title, v.subtitle, v.artist, v.album, v.lyricsWriter, v.musicWriter, v.copyright, v.tabAuthor, v.instructions);
+		a(v.comments, v.lyrics, v.pageSetup, v.tempo, v.keySignature, v.octave);
+	}
+}
@@ -0,0 +1,66 @@
+#include "BatchReader.h"
+#include "ReaderRegistry.h"
+#include "Model.h"
+#include <exception>
+#include <utility>
+
+namespace libgp
+{
+	namespace
+	{
+		template<typename Read>
+		BatchResult readOne(Read read)
+		{
+			BatchResult result;
+			try {
+				ReaderRegistry reader;
+				result.song = read(reader);
+			} catch (const GpReaderError& e) {
+				result.error = e;
+			} catch (const std::exception& e) {
+				result.error = GpReaderError(e.what());
+			}
+
+			return result;
+		}
+
+		template<typename Read>
+		std::vector<BatchResult> collect(size_t count, Read read)
+		{
+			std::vector<BatchResult> results(count);
+			read([&results](size_t index, BatchResult result) { results[index] = std::move(result); });
+			return results;
+		}
+	}
+
+	BatchReader::BatchReader(size_t numThreads) :
+		pool_(numThreads)
+	{
+	}
+
+	std::vector<BatchResult> BatchReader::readFiles(const std::vector<std::string>& paths)
+	{
+		return collect(paths.size(), [this, &paths](const Callback& callback) { readFiles(paths, callback); });
+	}
+
+	void BatchReader::readFiles(const std::vector<std::string>& paths, const Callback& callback)
+	{
+		pool_.parallelFor(paths.size(), [this, &paths, &callback](size_t index) {
+			auto& path = paths[index];
+			callback(index, readOne([&path](ReaderRegistry& reader) { return reader.readSongFromFile(path); }));
+		});
+	}
+
+	std::vector<BatchResult> BatchReader::readBuffers(const std::vector<SongBuffer>& buffers)
+	{
+		return collect(buffers.size(), [this, &buffers](const Callback& callback) { readBuffers(buffers, callback); });
+	}
+
+	void BatchReader::readBuffers(const std::vector<SongBuffer>& buffers, const Callback& callback)
+	{
+		pool_.parallelFor(buffers.size(), [this, &buffers, &callback](size_t index) {
+			auto& buffer = buffers[index];
+			callback(index, readOne([&buffer](ReaderRegistry& reader) { return reader.readSong(buffer.data, buffer.size); }));
+		});
+	}
+}
@@ -0,0 +1,52 @@
+#pragma once
+
+#include "GpReaderBase.h"
+#include "GpReaderError.h"
+#include "../ThreadPool.h"
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace libgp
+{
+	struct Song;
+
+	// Caller-owned bytes of one song
+	struct SongBuffer
+	{
+		const std::byte* data;
+		size_t size;
+	};
+
+	struct BatchResult
+	{
+		std::unique_ptr<Song> song;
+		// Set instead of the song when it could not be read
+		std::optional<GpReaderError> error;
+	};
+
+	// Reads many songs in parallel, each in whatever format it turns out to be.
+	// Every song gets its own reader, so songs never share parse state, and a
+	// failure only affects the song it came from.
+	class BatchReader
+	{
+	public:
+		// Called once per song, concurrently from the pool's threads
+		using Callback = std::function<void(size_t index, BatchResult result)>;
+
+		// A thread count of 0 uses one thread per hardware core
+		explicit BatchReader(size_t numThreads = 0);
+
+		std::vector<BatchResult> readFiles(const std::vector<std::string>& paths);
+		void readFiles(const std::vector<std::string>& paths, const Callback& callback);
+
+		std::vector<BatchResult> readBuffers(const std::vector<SongBuffer>& buffers);
+		void readBuffers(const std::vector<SongBuffer>& buffers, const Callback& callback);
+
+	private:
+		ThreadPool pool_;
+	};
+}
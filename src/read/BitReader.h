@@ -0,0 +1,90 @@
+#pragma once
+
+#include "GpReaderError.h"
+#include <cstddef>
+#include <cstdint>
+
+namespace libgp
+{
+	// Reads bit fields, most significant bit first, from a contiguous block of
+	// memory. Bits are served from a 64-bit cache that is refilled a byte at a
+	// time, so a read is a shift and a mask rather than a loop over single bits.
+	class BitReader
+	{
+	public:
+		static constexpr uint8_t MaxBits = 32;
+
+		BitReader(const std::byte* data, size_t size) noexcept :
+			data_(data),
+			end_(data + size),
+			cache_(0),
+			numCached_(0)
+		{
+		}
+
+		// True once every bit of the block has been read
+		bool atEnd() const noexcept { return numCached_ == 0 && data_ == end_; }
+
+		bool readBit() { return readBits(1) != 0; }
+
+		// Reads count bits with the first bit read as the most significant
+		uint32_t readBits(uint8_t count)
+		{
+			if (count == 0) {
+				return 0;
+			}
+
+			if (count > numCached_) {
+				refill(count);
+			}
+
+			auto value = static_cast<uint32_t>(cache_ >> (64 - count));
+			cache_ <<= count;
+			numCached_ -= count;
+
+			return value;
+		}
+
+		// Reads count bits with the first bit read as the least significant
+		uint32_t readBitsReversed(uint8_t count)
+		{
+			return count != 0
+				? reverse(readBits(count)) >> (MaxBits - count)
+				: 0;
+		}
+
+		uint8_t readByte() { return static_cast<uint8_t>(readBits(8)); }
+
+	private:
+		const std::byte* data_;
+		const std::byte* end_;
+		// Unread bits, aligned to the most significant end
+		uint64_t cache_;
+		uint8_t numCached_;
+
+		void refill(uint8_t count)
+		{
+			if (count > MaxBits) {
+				throw GpReaderError("Bit fields are limited to 32 bits");
+			}
+
+			while (numCached_ <= 56 && data_ != end_) {
+				cache_ |= static_cast<uint64_t>(*data_++) << (56 - numCached_);
+				numCached_ += 8;
+			}
+
+			if (count > numCached_) {
+				throw GpReaderError("An error occurred while reading the bit stream");
+			}
+		}
+
+		static uint32_t reverse(uint32_t value) noexcept
+		{
+			value = ((value >> 1) & 0x55555555u) | ((value & 0x55555555u) << 1);
+			value = ((value >> 2) & 0x33333333u) | ((value & 0x33333333u) << 2);
+			value = ((value >> 4) & 0x0F0F0F0Fu) | ((value & 0x0F0F0F0Fu) << 4);
+			value = ((value >> 8) & 0x00FF00FFu) | ((value & 0x00FF00FFu) << 8);
+			return (value >> 16) | (value << 16);
+		}
+	};
+}
@@ -0,0 +1,248 @@
+#include "CacheReader.h"
+#include "GpReaderError.h"
+#include "LazySong.h"
+#include "StreamReader.h"
+#include "../cache/CacheFormat.h"
+#include <algorithm>
+#include <array>
+#include <optional>
+#include <string>
+#include <type_traits>
+#include <utility>
+
+namespace libgp
+{
+	namespace
+	{
+		class CacheInput
+		{
+		public:
+			explicit CacheInput(StreamReader& reader) :
+				reader_(reader)
+			{
+			}
+
+			template<typename... T>
+			void operator()(T&... values) { (read(values), ...); }
+
+			void read(std::string& text) { text = reader_.readIntSizedString(); }
+
+			template<typename T>
+			void read(ArenaVector<T>& values)
+			{
+				auto count = reader_.readUnsignedInt();
+
+				values.clear();
+				values.reserve(std::min<size_t>(count, reader_.remaining()));
+				for (uint32_t i = 0; i < count && !reader_.failed(); ++i) {
+					T value{};
+					read(value);
+					values.push_back(std::move(value));
+				}
+			}
+
+			template<typename T, size_t Size>
+			void read(std::array<T, Size>& values)
+			{
+				for (auto& value : values) {
+					read(value);
+				}
+			}
+
+			template<typename T>
+			void read(std::optional<T>& value)
+			{
+				if (reader_.readBoolean()) {
+					read(value.emplace());
+				} else {
+					value.reset();
+				}
+			}
+
+			template<typename T>
+			void read(T& value)
+			{
+				if constexpr (std::is_same<T, bool>::value) {
+					value = reader_.readBoolean();
+				} else if constexpr (std::is_enum<T>::value) {
+					value = static_cast<T>(reader_.readRaw<std::underlying_type_t<T>>());
+				} else if constexpr (std::is_arithmetic<T>::value) {
+					value = reader_.readRaw<T>();
+				} else {
+					describe(*this, value);
+				}
+			}
+
+		private:
+			StreamReader& reader_;
+		};
+
+		std::vector<uint64_t> readOffsetTable(size_t numEntries, StreamReader& reader)
+		{
+			std::vector<uint64_t> offsets;
+			offsets.reserve(std::min(numEntries, reader.remaining() / sizeof(uint64_t)));
+			for (size_t i = 0; i < numEntries && !reader.failed(); ++i) {
+				offsets.push_back(reader.readRaw<uint64_t>());
+			}
+
+			return offsets;
+		}
+	}
+
+	CacheReader::CacheReader() :
+		GpReaderBase({ GpVersion::parse(cache::Version) })
+	{
+	}
+
+	std::unique_ptr<Song> CacheReader::readSong(StreamReader& reader)
+	{
+		std::vector<uint64_t> trackOffsets;
+		auto song = readOutline(reader, trackOffsets);
+		ArenaScope scope(song->storage->arena());
+
+		// The measure blocks follow one another, so they can be read in one pass
+		for (size_t i = 0; i < song->tracks.size(); ++i) {
+			if (reader.position() != trackOffsets[i]) {
+				throw GpReaderError("Corrupt song cache");
+			}
+
+			readMeasures(*song, i, reader);
+			if (reader.failed()) {
+				throw GpReaderError(readError(reader));
+			}
+		}
+
+		return song;
+	}
+
+	SongInfo CacheReader::readHeader(StreamReader& reader)
+	{
+		readAndValidateVersion(reader);
+		if (reader.failed()) {
+			throw GpReaderError(readError(reader));
+		}
+
+		auto storage = std::make_shared<SongStorage>();
+		ArenaScope scope(storage->arena());
+
+		SongInfo info;
+		info.storage = std::move(storage);
+
+		CacheInput input(reader);
+		input(info);
+		if (reader.failed()) {
+			throw GpReaderError(readError(reader));
+		}
+
+		return info;
+	}
+
+	std::unique_ptr<LazySong> CacheReader::readLazySong(StreamReader& reader)
+	{
+		auto trackOffsets = std::make_shared<std::vector<uint64_t>>();
+		auto song = readOutline(reader, *trackOffsets);
+
+		auto source = reader.shareSource();
+		auto data = reader.data();
+		auto size = reader.size();
+
+		// Validates the table and makes room for every track's measures up front,
+		// so that decoding tracks on separate threads never grows a shared vector
+		for (size_t i = 0; i < song->tracks.size(); ++i) {
+			auto begin = (*trackOffsets)[i];
+			auto end = (*trackOffsets)[i + 1];
+			if (begin > end || end > size) {
+				throw GpReaderError("Corrupt song cache");
+			}
+
+			StreamReader blockReader(data + begin, end - begin);
+			auto numMeasures = blockReader.readUnsignedInt();
+
+			ArenaScope scope(song->storage->arena());
+			song->tracks[i].measures.reserve(std::min<size_t>(numMeasures, blockReader.remaining()));
+		}
+
+		auto decoder = [self = *this, trackOffsets, source, data](Song& song, size_t track) {
+			auto begin = (*trackOffsets)[track];
+			StreamReader blockReader(data + begin, (*trackOffsets)[track + 1] - begin);
+
+			ArenaScope scope(song.storage->addArena());
+			self.readMeasures(song, track, blockReader);
+			if (blockReader.failed()) {
+				// The offset is from the start of the block
+				auto error = blockReader.error();
+				error.offset += begin;
+				error.phase = ParsePhase::Measures;
+				throw GpReaderError(error);
+			}
+		};
+
+		return std::make_unique<LazySong>(std::move(song), std::move(decoder));
+	}
+
+	// Reads everything but the measures, leaving the reader at the first measure block
+	std::unique_ptr<Song> CacheReader::readOutline(StreamReader& reader, std::vector<uint64_t>& trackOffsets)
+	{
+		readAndValidateVersion(reader);
+		if (reader.failed()) {
+			throw GpReaderError(readError(reader));
+		}
+
+		auto storage = std::make_shared<SongStorage>();
+		ArenaScope scope(storage->arena());
+
+		auto song = std::make_unique<Song>();
+		song->storage = std::move(storage);
+
+		CacheInput input(reader);
+		input(static_cast<SongInfo&>(*song), song->masterEffect, song->measureHeaders, song->tracks);
+
+		trackOffsets = readOffsetTable(song->tracks.size() + 1, reader);
+		if (reader.failed()) {
+			throw GpReaderError(readError(reader));
+		}
+
+		return song;
+	}
+
+	void CacheReader::readMeasures(Song& song, size_t trackIndex, StreamReader& reader) const
+	{
+		CacheInput input(reader);
+
+		// Drops whatever an earlier attempt that failed part way through left behind
+		auto& track = song.tracks[trackIndex];
+		track.measures.clear();
+
+		// Measures are read in order, so their own offsets are not needed here
+		auto numMeasures = reader.readUnsignedInt();
+		reader.skip((static_cast<size_t>(numMeasures) + 1) * sizeof(uint64_t));
+
+		// Every measure takes up more than a byte, so this never reserves too little
+		// for a valid cache; measures must never move once created
+		track.measures.reserve(std::min<size_t>(numMeasures, reader.remaining()));
+
+		for (uint32_t i = 0; i < numMeasures && !reader.failed(); ++i) {
+			auto headerIndex = reader.readUnsignedInt();
+			if (headerIndex >= song.measureHeaders.size()) {
+				throw GpReaderError("Corrupt song cache");
+			}
+
+			auto& measure = track.measures.emplace_back(track, song.measureHeaders[headerIndex]);
+			input(measure.clef, measure.lineBreak);
+
+			auto numVoices = reader.readUnsignedInt();
+			measure.voices.reserve(std::min<size_t>(numVoices, reader.remaining()));
+			for (uint32_t v = 0; v < numVoices && !reader.failed(); ++v) {
+				auto& voice = v < measure.voices.size()
+					? measure.voices[v]
+					: measure.voices.emplace_back(measure);
+
+				input(voice.direction, voice.beats);
+			}
+
+			while (measure.voices.size() > numVoices) {
+				measure.voices.pop_back();
+			}
+		}
+	}
+}
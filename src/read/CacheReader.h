@@ -0,0 +1,46 @@
+#pragma once
+
+#include "GpReaderBase.h"
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace libgp
+{
+	struct Track;
+
+	// Loads songs saved by CacheWriter. Text is read in place by default, so a
+	// cache file opened with readSongFromFile stays mapped and the song's text
+	// points straight into it; lazily read songs decode each track's measures
+	// from the mapping on first access.
+	class CacheReader : private GpReaderBase
+	{
+	public:
+		CacheReader();
+
+		using GpReaderBase::readSong;
+		using GpReaderBase::readSongFromFile;
+		using GpReaderBase::tryReadSong;
+		using GpReaderBase::tryReadSongFromFile;
+		using GpReaderBase::salvageSong;
+		using GpReaderBase::salvageSongFromFile;
+		using GpReaderBase::readHeader;
+		using GpReaderBase::readHeaderFromFile;
+		using GpReaderBase::readHeaderView;
+		using GpReaderBase::readHeaderViewFromFile;
+		using GpReaderBase::readLazySong;
+		using GpReaderBase::readLazySongFromFile;
+		using GpReaderBase::version;
+
+	protected:
+		std::unique_ptr<Song> readSong(StreamReader& reader) override;
+		SongInfo readHeader(StreamReader& reader) override;
+		std::unique_ptr<LazySong> readLazySong(StreamReader& reader) override;
+
+	private:
+		friend class ReaderRegistry;
+
+		std::unique_ptr<Song> readOutline(StreamReader& reader, std::vector<uint64_t>& trackOffsets);
+		void readMeasures(Song& song, size_t trackIndex, StreamReader& reader) const;
+	};
+}
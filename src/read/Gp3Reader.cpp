@@ -0,0 +1,12 @@
+#include "Gp3Reader.h"
+
+namespace libgp
+{
+	Gp3Reader::Gp3Reader() :
+		Gp5Reader({
+			GpVersion::parse("FICHIER GUITAR PRO v3.00")
+		})
+	{
+
+	}
+}
@@ -0,0 +1,14 @@
+#pragma once
+
+#include "Gp5Reader.h"
+
+namespace libgp
+{
+	// Reads Guitar Pro 3 (.gp3) files with the Gp5Reader decoder, which knows
+	// the fields GP3 does not have from the version
+	class Gp3Reader : public Gp5Reader
+	{
+	public:
+		Gp3Reader();
+	};
+}
@@ -0,0 +1,13 @@
+#include "Gp4Reader.h"
+
+namespace libgp
+{
+	Gp4Reader::Gp4Reader() :
+		Gp5Reader({
+			GpVersion::parse("FICHIER GUITAR PRO v4.00"),
+			GpVersion::parse("FICHIER GUITAR PRO v4.06")
+		})
+	{
+
+	}
+}
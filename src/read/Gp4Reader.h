@@ -0,0 +1,14 @@
+#pragma once
+
+#include "Gp5Reader.h"
+
+namespace libgp
+{
+	// Reads Guitar Pro 4 (.gp4) files with the Gp5Reader decoder, which knows
+	// the fields GP4 does not have from the version
+	class Gp4Reader : public Gp5Reader
+	{
+	public:
+		Gp4Reader();
+	};
+}
@@ -0,0 +1,303 @@
+#include "Gp5PushReader.h"
+#include "StreamReader.h"
+#include "GpReaderError.h"
+#include "Model.h"
+#include <algorithm>
+#include <cstdint>
+#include <optional>
+#include <utility>
+
+namespace libgp
+{
+	Gp5PushReader::Gp5PushReader(Callback callback) :
+		callback_(std::move(callback)),
+		offset_(0),
+		isInputEnded_(false),
+		phase_(ParsePhase::Version),
+		isFinished_(false),
+		hasCounts_(false),
+		numMeasures_(0),
+		numTracks_(0),
+		next_(0)
+	{
+	}
+
+	Gp5PushReader::~Gp5PushReader() = default;
+
+	void Gp5PushReader::feed(const std::byte* data, size_t size)
+	{
+		if (isFinished_ || size == 0) {
+			return;
+		}
+
+		buffer_.insert(buffer_.end(), data, data + size);
+		decode();
+	}
+
+	void Gp5PushReader::finish()
+	{
+		isInputEnded_ = true;
+		decode();
+
+		if (!isFinished_) {
+			throw GpReaderError(ParseError{ ParseErrorCode::UnexpectedEnd, offset_ + buffer_.size(), phase_ });
+		}
+	}
+
+	bool Gp5PushReader::isFinished() const noexcept { return isFinished_; }
+
+	ParsePhase Gp5PushReader::phase() const noexcept { return phase_; }
+
+	GpVersion Gp5PushReader::version() const noexcept { return reader_.version(); }
+
+	size_t Gp5PushReader::bufferedSize() const noexcept { return buffer_.size(); }
+
+	size_t Gp5PushReader::position() const noexcept { return offset_; }
+
+	const Song* Gp5PushReader::song() const noexcept { return song_.get(); }
+
+	std::unique_ptr<Song> Gp5PushReader::takeSong()
+	{
+		if (!isFinished_) {
+			return nullptr;
+		}
+
+		return std::move(song_);
+	}
+
+	// Decodes parts until one runs out of bytes. The bytes of each part decoded
+	// are dropped from the buffer once, after the loop or before an error is
+	// thrown, so the buffer always starts at the part in progress.
+	void Gp5PushReader::decode()
+	{
+		size_t position = 0;
+		std::optional<ParseError> error;
+
+		while (!isFinished_) {
+			StreamReader reader(buffer_.data() + position, buffer_.size() - position);
+			auto decoded = decodeNext(reader);
+
+			if (reader.failed()) {
+				if (reader.error().code == ParseErrorCode::UnexpectedEnd && !isInputEnded_) {
+					break;
+				}
+
+				// The offset is from the start of the part
+				error = reader.error();
+				error->offset += offset_ + position;
+				error->phase = phase_;
+				break;
+			}
+
+			if (!decoded) {
+				break;
+			}
+
+			position += reader.position();
+		}
+
+		buffer_.erase(buffer_.begin(), buffer_.begin() + position);
+		offset_ += position;
+
+		if (error) {
+			throw GpReaderError(*error);
+		}
+
+		// Anything past the last measure is not part of the song
+		if (isFinished_) {
+			buffer_.clear();
+		}
+	}
+
+	// Decodes the next part, returning false when it stopped short of the end
+	// of the part, either to wait for more bytes or because the reader failed.
+	// Nothing is committed to the song or the state of the decode until the
+	// whole part has been read.
+	bool Gp5PushReader::decodeNext(StreamReader& reader)
+	{
+		// The reader only accepts version 5, so the format is one of its two
+		if (phase_ != ParsePhase::Version) {
+			return reader_.format_ == Gp5Reader::Format::Gp500
+				? decodeNext<Gp5Reader::Format::Gp500>(reader)
+				: decodeNext<Gp5Reader::Format::Gp510>(reader);
+		}
+
+		reader_.readFormat(reader);
+		if (reader.failed()) {
+			return false;
+		}
+
+		phase_ = ParsePhase::SongInfo;
+		return true;
+	}
+
+	template<Gp5Reader::Format F>
+	bool Gp5PushReader::decodeNext(StreamReader& reader)
+	{
+		if (phase_ == ParsePhase::SongInfo) {
+			// Each attempt reads into a song of its own, so what an attempt that
+			// runs out of bytes allocated goes with its arena
+			auto song = reader_.createSong();
+			ArenaScope scope(song->storage->arena());
+			reader_.readSongHeader<F>(*song, reader);
+			if (reader.failed()) {
+				return false;
+			}
+
+			song_ = std::move(song);
+			phase_ = ParsePhase::MidiChannels;
+			notify(PushEventType::SongInfo);
+			return true;
+		}
+
+		auto& song = *song_;
+		ArenaScope scope(song.storage->arena());
+
+		switch (phase_) {
+		case ParsePhase::MidiChannels:
+			midiChannels_ = reader_.readMidiChannels(reader);
+			if (reader.failed()) {
+				return false;
+			}
+
+			phase_ = ParsePhase::MeasureHeaders;
+			return true;
+
+		case ParsePhase::MeasureHeaders:
+			if (!hasCounts_) {
+				directionSigns_ = reader_.readDirectionSigns(reader);
+				song.masterEffect.reverb = reader.readUnsignedInt();
+
+				// Counts are stored as signed ints, so one past their range is corrupt
+				numMeasures_ = reader.readUnsignedInt();
+				numTracks_ = reader.readUnsignedInt();
+				if (reader.failed()) {
+					return false;
+				}
+
+				if (numMeasures_ > INT32_MAX || numTracks_ > INT32_MAX) {
+					reader.fail(ParseErrorCode::InvalidData, reader.position() - 8);
+					return false;
+				}
+
+				hasCounts_ = true;
+				return true;
+			}
+
+			if (next_ < numMeasures_) {
+				auto header = reader_.readMeasureHeader<F>(static_cast<uint32_t>(next_ + 1), song, previousHeader_, reader);
+				if (reader.failed()) {
+					return false;
+				}
+
+				song.measureHeaders.push_back(header);
+				previousHeader_ = header;
+				++next_;
+				return true;
+			}
+
+			reader_.applyDirectionSigns(song, directionSigns_, reader);
+			if (reader.failed()) {
+				return false;
+			}
+
+			phase_ = ParsePhase::Tracks;
+			next_ = 0;
+			// The count is only trusted as far as the bytes at hand could hold it
+			song.tracks.reserve(std::min<size_t>(numTracks_, reader.remaining() / Gp5Reader::MinTrackSize));
+			notify(PushEventType::MeasureHeaders);
+			return true;
+
+		case ParsePhase::Tracks:
+			if (next_ < numTracks_) {
+				// A track is read into a scratch arena that an attempt which runs
+				// out of bytes drops, and copied into the song once it is whole
+				Arena scratch;
+				std::optional<Track> track;
+				{
+					ArenaScope scratchScope(scratch);
+					track = reader_.readTrack<F>(static_cast<uint32_t>(next_ + 1), midiChannels_, reader);
+				}
+
+				if (reader.failed()) {
+					return false;
+				}
+
+				song.tracks.push_back(*track);
+				notify(PushEventType::Track, next_++);
+				return true;
+			}
+
+			reader_.skipTrackPadding<F>(reader);
+			if (reader.failed()) {
+				return false;
+			}
+
+			reader_.layoutMeasures(song);
+			phase_ = ParsePhase::Measures;
+			next_ = 0;
+			return true;
+
+		default:
+			return decodeMeasure<F>(reader);
+		}
+	}
+
+	// Measures come header by header, each for every track in turn
+	template<Gp5Reader::Format F>
+	bool Gp5PushReader::decodeMeasure(StreamReader& reader)
+	{
+		auto& song = *song_;
+		if (next_ >= song.measureHeaders.size() * song.tracks.size()) {
+			finishSong();
+			return false;
+		}
+
+		auto headerIndex = next_ / song.tracks.size();
+		auto trackIndex = next_ % song.tracks.size();
+		auto& track = song.tracks[trackIndex];
+		auto& header = song.measureHeaders[headerIndex];
+
+		// Measures make up most of the file, so rather than decode one that may
+		// run out of bytes into the song's arena, each is skipped over first,
+		// which allocates nothing, and only decoded once its bytes are all there
+		StreamReader probe(reader.data() + reader.position(), reader.remaining());
+		reader_.skipMeasure<F>(header, track.strings.size(), probe);
+		if (probe.failed()) {
+			reader.fail(probe.error().code, reader.position() + probe.error().offset);
+			return false;
+		}
+
+		// A measure ends on a line break, which is only left out at the
+		// very end of the file; until the input ends, one that reaches the end of
+		// the bytes so far may still have it coming
+		if (!isInputEnded_ && probe.atEnd()) {
+			return false;
+		}
+
+		auto& measure = track.measures.emplace_back(track, header);
+		reader_.readMeasure<F>(measure, reader);
+		if (reader.failed()) {
+			track.measures.pop_back();
+			return false;
+		}
+
+		notify(PushEventType::Measure, trackIndex, headerIndex);
+		++next_;
+		return true;
+	}
+
+	void Gp5PushReader::finishSong()
+	{
+		reader_.resolveTempos(*song_);
+		isFinished_ = true;
+		notify(PushEventType::Finished);
+	}
+
+	void Gp5PushReader::notify(PushEventType type, size_t track, size_t measure)
+	{
+		if (callback_) {
+			callback_({ type, track, measure });
+		}
+	}
+}
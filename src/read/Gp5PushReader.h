@@ -0,0 +1,113 @@
+#pragma once
+
+#include "Gp5Reader.h"
+#include "ParseObserver.h"
+#include "../Model.h"
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <tuple>
+#include <vector>
+
+namespace libgp
+{
+	enum class PushEventType : uint8_t
+	{
+		// The song info, lyrics, page setup and tempo
+		SongInfo = 0,
+		// Every measure header, with the direction signs set
+		MeasureHeaders = 1,
+		Track = 2,
+		Measure = 3,
+		// The last measure, after which the song is complete
+		Finished = 4
+	};
+
+	struct PushEvent
+	{
+		PushEventType type;
+		// The track and the measure header a track or measure event is for
+		size_t track = 0;
+		size_t measure = 0;
+	};
+
+	// Reads a Guitar Pro 5 file from bytes pushed to it as they arrive, such as
+	// the chunks of an upload, and reports each part of the song as soon as it
+	// is decoded. The parts come in file order: the song info, the measure
+	// headers, each track and then each measure, header by header.
+	//
+	// Each part is decoded whole once its bytes are all there. A part that runs
+	// out of bytes is rolled back and decoded again from its start when more
+	// arrive, so only the bytes of the part in progress are buffered. Attempts
+	// that are rolled back leave nothing in the song's arena. Text is copied
+	// into the song, which is built up as the parts arrive.
+	class Gp5PushReader
+	{
+	public:
+		// Called from feed and finish for every part decoded. The song can be
+		// looked at from the callback, as far as it has been read.
+		using Callback = std::function<void(const PushEvent& event)>;
+
+		explicit Gp5PushReader(Callback callback);
+		~Gp5PushReader();
+
+		Gp5PushReader(const Gp5PushReader&) = delete;
+		Gp5PushReader& operator=(const Gp5PushReader&) = delete;
+
+		// Decodes every part the new bytes complete. Throws GpReaderError for data
+		// that can never be read, such as an unsupported version.
+		void feed(const std::byte* data, size_t size);
+		// Tells the reader that no more bytes will come, which settles the last
+		// measure. Throws GpReaderError if the song is not complete.
+		void finish();
+
+		bool isFinished() const noexcept;
+		// The phase of the next part to decode
+		ParsePhase phase() const noexcept;
+		GpVersion version() const noexcept;
+
+		// Bytes received but not decoded yet
+		size_t bufferedSize() const noexcept;
+		// Bytes decoded so far
+		size_t position() const noexcept;
+
+		// The song as far as it has been read; null until the song info is read
+		const Song* song() const noexcept;
+		// Hands over the song once it is finished. Before then the reader still
+		// has parts to add to it, so there is nothing to take and null is returned.
+		std::unique_ptr<Song> takeSong();
+
+	private:
+		Gp5Reader reader_;
+		Callback callback_;
+
+		// The bytes from the start of the part in progress on, and how many bytes
+		// before them have been decoded and dropped
+		std::vector<std::byte> buffer_;
+		size_t offset_;
+		bool isInputEnded_;
+
+		ParsePhase phase_;
+		bool isFinished_;
+		std::unique_ptr<Song> song_;
+
+		// What the later parts of the file need from the earlier ones
+		std::vector<MidiChannel> midiChannels_;
+		std::tuple<Gp5Reader::DirectionSigns, Gp5Reader::DirectionSigns> directionSigns_;
+		bool hasCounts_;
+		uint32_t numMeasures_;
+		uint32_t numTracks_;
+		std::optional<MeasureHeader> previousHeader_;
+		// The next header, track or measure to decode
+		size_t next_;
+
+		void decode();
+		bool decodeNext(StreamReader& reader);
+		template<Gp5Reader::Format F> bool decodeNext(StreamReader& reader);
+		template<Gp5Reader::Format F> bool decodeMeasure(StreamReader& reader);
+		void finishSong();
+		void notify(PushEventType type, size_t track = 0, size_t measure = 0);
+	};
+}
@@ -1,12 +1,50 @@
 #include "Gp5Reader.h"
 #include "StreamReader.h"
+#include "LazySong.h"
 #include "Model.h"
+#include "../ThreadPool.h"
+#include <algorithm>
+#include <cmath>
+#include <memory>
+#include <type_traits>
 #include <utility>
 
 namespace libgp
 {
+	namespace
+	{
+		void countMeasures(const Song& song, ParsePhaseStats& stats)
+		{
+			for (auto& track : song.tracks) {
+				stats.measures += track.measures.size();
+				for (auto& measure : track.measures) {
+					for (auto& voice : measure.voices) {
+						stats.beats += voice.beats.size();
+						for (auto& beat : voice.beats) {
+							stats.notes += beat.notes.size();
+						}
+					}
+				}
+			}
+		}
+
+		// Passes on a value just read that lies within min and max, such as a
+		// shift or a divisor. One that does not fails the reader and is replaced
+		// with min, which the decoder can carry on with until it checks the reader.
+		template<typename T>
+		T checkRange(T value, int64_t min, int64_t max, StreamReader& reader)
+		{
+			if (value < min || value > max) {
+				reader.fail(ParseErrorCode::InvalidData, reader.position() - sizeof(T));
+				return static_cast<T>(min);
+			}
+
+			return value;
+		}
+	}
+
 	Gp5Reader::Gp5Reader() :
-		GpReaderBase({
+		Gp5Reader({
 			GpVersion::parse("FICHIER GUITAR PRO v5.00"), 
 			GpVersion::parse("FICHIER GUITAR PRO v5.10")
 		})
@@ -14,53 +52,359 @@ namespace libgp
 
 	}
 
-	std::unique_ptr<Song> Gp5Reader::readSong(std::istream& stream)
+	Gp5Reader::Gp5Reader(std::set<GpVersion> supportedVersions) :
+		GpReaderBase(std::move(supportedVersions)),
+		format_(Format::Gp510)
+	{
+
+	}
+
+	// Calls the function with the format of the file being read as a
+	// compile-time constant. Each format gets a decoder of its own, in which the
+	// layout differences are settled by if constexpr rather than at every field.
+	template<typename Function>
+	auto Gp5Reader::withFormat(Function&& function) const
+	{
+		switch (format_) {
+		case Format::Gp3:
+			return function(std::integral_constant<Format, Format::Gp3>());
+		case Format::Gp4:
+			return function(std::integral_constant<Format, Format::Gp4>());
+		case Format::Gp500:
+			return function(std::integral_constant<Format, Format::Gp500>());
+		default:
+			return function(std::integral_constant<Format, Format::Gp510>());
+		}
+	}
+
+	ThreadPool* Gp5Reader::threadPool() const noexcept { return options().threadPool; }
+
+	void Gp5Reader::setThreadPool(ThreadPool* pool) noexcept
+	{
+		auto options = GpReaderBase::options();
+		options.threadPool = pool;
+		setOptions(options);
+	}
+
+	MeasureIndex Gp5Reader::indexMeasures(const std::byte* data, size_t size)
+	{
+		StreamReader reader(data, size);
+		readFormat(reader);
+		if (reader.failed()) {
+			throw GpReaderError(readError(reader));
+		}
+
+		auto index = withFormat([&](auto format) {
+			constexpr auto F = decltype(format)::value;
+			auto song = readOutline<F>(reader);
+			return scanMeasures<F>(*song, reader);
+		});
+
+		if (reader.failed()) {
+			throw GpReaderError(readError(reader));
+		}
+
+		return index;
+	}
+
+	std::unique_ptr<Song> Gp5Reader::readSong(StreamReader& reader)
+	{
+		return tryReadSong(reader).value();
+	}
+
+	// The decoder stops at the first read that fails, so the reader is checked
+	// once each phase is over rather than after every read
+	ParseResult<std::unique_ptr<Song>> Gp5Reader::tryReadSong(StreamReader& reader)
+	{
+		readFormat(reader);
+		if (reader.failed()) {
+			return readError(reader);
+		}
+
+		return withFormat([&](auto format) -> ParseResult<std::unique_ptr<Song>> {
+			constexpr auto F = decltype(format)::value;
+			auto song = readOutline<F>(reader);
+			if (reader.failed()) {
+				return readError(reader);
+			}
+
+			ArenaScope scope(song->storage->arena());
+
+			observePhase(ParsePhase::Measures, reader, [&] {
+				if (threadPool() != nullptr && song->tracks.size() > 1) {
+					readMeasuresByTrack<F>(*song, reader);
+				} else {
+					readMeasures<F>(*song, reader);
+				}
+			}, [&](ParsePhaseStats& stats) { countMeasures(*song, stats); });
+
+			if (reader.failed()) {
+				return readError(reader);
+			}
+
+			return song;
+		});
+	}
+
+	std::unique_ptr<LazySong> Gp5Reader::readLazySong(StreamReader& reader)
+	{
+		readFormat(reader);
+		if (reader.failed()) {
+			throw GpReaderError(readError(reader));
+		}
+
+		return withFormat([&](auto format) {
+			constexpr auto F = decltype(format)::value;
+			auto song = readOutline<F>(reader);
+			ArenaScope scope(song->storage->arena());
+
+			layoutMeasures(*song);
+			auto index = std::make_shared<const MeasureIndex>(scanMeasures<F>(*song, reader));
+			if (reader.failed()) {
+				throw GpReaderError(readError(reader));
+			}
+
+			// The decoder keeps the source alive, and a copy of this reader for
+			// its settings; the format is part of the decoder's type
+			auto source = reader.shareSource();
+			auto data = reader.data();
+			auto decoder = [self = *this, index, source, data](Song& song, size_t track) {
+				auto error = self.readTrackMeasures<F>(song, track, *index, data);
+				if (error.code != ParseErrorCode::None) {
+					throw GpReaderError(error);
+				}
+			};
+
+			return std::make_unique<LazySong>(std::move(song), std::move(decoder));
+		});
+	}
+
+	// Reads the version and settles which instantiation of the decoder handles
+	// the rest of the file; nothing past this point looks at the version again
+	void Gp5Reader::readFormat(StreamReader& reader)
 	{
-		StreamReader reader(stream);
 		readAndValidateVersion(reader);
+		if (reader.failed()) {
+			return;
+		}
+
+		auto fileVersion = version();
+		switch (fileVersion.major()) {
+		case 3:
+			format_ = Format::Gp3;
+			break;
+		case 4:
+			format_ = Format::Gp4;
+			break;
+		default:
+			format_ = fileVersion.minor() == 0 ? Format::Gp500 : Format::Gp510;
+			break;
+		}
+	}
+
+	// Keeps the measure headers and tracks decoded before an error, and the
+	// measures of the headers that were decoded for every track. Salvaging
+	// always reads the measures in order, without the thread pool.
+	SalvagedSong Gp5Reader::salvageSong(StreamReader& reader)
+	{
+		SalvagedSong result;
+
+		readFormat(reader);
+		if (reader.failed()) {
+			result.error = readError(reader);
+			return result;
+		}
 
-		auto song = new Song();
+		withFormat([&](auto format) {
+			constexpr auto F = decltype(format)::value;
+			result.song = createSong();
+			auto& song = *result.song;
+			ArenaScope scope(song.storage->arena());
+
+			readOutline<F>(song, reader);
+			if (!reader.failed()) {
+				observePhase(ParsePhase::Measures, reader, [&] {
+					readMeasures<F>(song, reader);
+				}, [&](ParsePhaseStats& stats) { countMeasures(song, stats); });
+			}
+		});
+
+		if (reader.failed()) {
+			result.error = readError(reader);
+
+			auto& song = *result.song;
+			ArenaScope scope(song.storage->arena());
+			dropPartialMeasures(song);
+			layoutMeasures(song);
+			resolveTempos(song);
+		}
+
+		return result;
+	}
+
+	// The song's containers allocate from the arena of its storage
+	std::unique_ptr<Song> Gp5Reader::createSong() const
+	{
+		auto storage = std::make_shared<SongStorage>();
+		ArenaScope scope(storage->arena());
+
+		auto song = std::make_unique<Song>();
+		song->storage = std::move(storage);
+		return song;
+	}
+
+	template<Gp5Reader::Format F>
+	std::unique_ptr<Song> Gp5Reader::readOutline(StreamReader& reader)
+	{
+		auto song = createSong();
+		readOutline<F>(*song, reader);
+		return song;
+	}
+
+	// Reads everything after the version up to the measure data. Headers and
+	// tracks are added to the song as each is decoded whole.
+	template<Gp5Reader::Format F>
+	void Gp5Reader::readOutline(Song& song, StreamReader& reader) const
+	{
+		ArenaScope scope(song.storage->arena());
+
+		auto tripletFeel = observePhase(ParsePhase::SongInfo, reader, [&] { return readSongHeader<F>(song, reader); });
+		if (reader.failed()) {
+			return;
+		}
+
+		auto midiChannels = observePhase(ParsePhase::MidiChannels, reader, [&] { return readMidiChannels(reader); });
+		if (reader.failed()) {
+			return;
+		}
+
+		uint32_t numTracks = 0;
+		observePhase(ParsePhase::MeasureHeaders, reader, [&] {
+			std::tuple<DirectionSigns, DirectionSigns> directionSigns;
+			if constexpr (F >= Format::Gp500) {
+				directionSigns = readDirectionSigns(reader);
+				song.masterEffect.reverb = reader.readUnsignedInt();
+			}
+
+			auto numMeasures = reader.readUnsignedInt();
+			numTracks = reader.readUnsignedInt();
+			readMeasureHeaders<F>(numMeasures, song, directionSigns, tripletFeel, reader);
+		}, [&](ParsePhaseStats& stats) { stats.measureHeaders = song.measureHeaders.size(); });
+		if (reader.failed()) {
+			return;
+		}
+
+		observePhase(ParsePhase::Tracks, reader, [&] {
+			readTracks<F>(numTracks, song, midiChannels, reader);
+		}, [&](ParsePhaseStats& stats) { stats.tracks = song.tracks.size(); });
+	}
+
+	SongInfo Gp5Reader::readHeader(StreamReader& reader)
+	{
+		readFormat(reader);
+		if (reader.failed()) {
+			throw GpReaderError(readError(reader));
+		}
+
+		auto storage = std::make_shared<SongStorage>();
+		ArenaScope scope(storage->arena());
+
+		SongInfo info;
+		info.storage = std::move(storage);
+		observePhase(ParsePhase::SongInfo, reader, [&] {
+			withFormat([&](auto format) { readSongHeader<decltype(format)::value>(info, reader); });
+		});
+
+		if (reader.failed()) {
+			throw GpReaderError(readError(reader));
+		}
 
-		readSongInfo(*song, reader);
-		song->lyrics = readLyrics(reader);
+		return info;
+	}
+
+	// The text of the header is stored as is, so the views point straight into
+	// the source
+	SongInfoView Gp5Reader::readHeaderView(StreamReader& reader)
+	{
+		readFormat(reader);
+		if (reader.failed()) {
+			throw GpReaderError(readError(reader));
+		}
+
+		SongInfoView view;
+		view.source = reader.shareSource();
+		observePhase(ParsePhase::SongInfo, reader, [&] {
+			withFormat([&](auto format) { readSongInfo<decltype(format)::value>(view, reader); });
+		});
+
+		if (reader.failed()) {
+			throw GpReaderError(readError(reader));
+		}
+
+		return view;
+	}
+
+	// Returns the triplet feel versions before 5 set for the whole song; later
+	// versions set it for each measure instead
+	template<Gp5Reader::Format F>
+	TripletFeel Gp5Reader::readSongHeader(SongInfo& info, StreamReader& reader) const
+	{
+		readSongInfo<F>(info, reader);
+
+		if constexpr (F < Format::Gp500) {
+			auto tripletFeel = reader.readBoolean() ? TripletFeel::Eighth : TripletFeel::None;
 
-		// Possibly master RSE EQ?
-		reader.skip(19);
+			if constexpr (F == Format::Gp4) {
+				info.lyrics = readLyrics(reader);
+			} else {
+				info.lyrics.trackNumber = 0;
+			}
+
+			info.tempo = readTempo<F>(reader);
+			info.keySignature = static_cast<KeySignature>(reader.readSignedInt());
+			info.octave = F == Format::Gp4 ? reader.readUnsignedByte() : 0;
 
-		song->pageSetup = readPageSetup(reader);
-		song->tempo = readTempo(reader);
-		song->keySignature = static_cast<KeySignature>(reader.readSignedByte());
-		song->octave = reader.readUnsignedInt();
+			return tripletFeel;
+		}
 
-		auto midiChannels = readMidiChannels(reader);
-		auto directionSigns = readDirectionSigns(reader);
+		info.lyrics = readLyrics(reader);
 
-		song->masterEffect.reverb = reader.readUnsignedInt();
+		// The master effect of RSE, which 5.10 added: the volume, an unknown int
+		// and an equalizer of eleven knobs
+		if constexpr (F == Format::Gp510) {
+			reader.skip(19);
+		}
 
-		auto numMeasures = reader.readUnsignedInt();
-		auto numTracks = reader.readUnsignedInt();
-		readMeasureHeaders(numMeasures, *song, directionSigns, reader);
-		readTracks(numTracks, *song, midiChannels, reader);
-		readMeasures(*song, reader);
+		info.pageSetup = readPageSetup(reader);
+		info.tempo = readTempo<F>(reader);
+		info.keySignature = static_cast<KeySignature>(reader.readSignedByte());
+		info.octave = reader.readUnsignedInt();
 
-		return std::unique_ptr<Song>(song);
+		return TripletFeel::None;
 	}
 
-	void Gp5Reader::readSongInfo(Song& song, StreamReader& reader) const
+	template<Gp5Reader::Format F, typename Info>
+	void Gp5Reader::readSongInfo(Info& info, StreamReader& reader) const
 	{
-		song.title = reader.readIntByteSizedString();
-		song.subtitle = reader.readIntByteSizedString();
-		song.artist = reader.readIntByteSizedString();
-		song.album = reader.readIntByteSizedString();
-		song.lyricsWriter = reader.readIntByteSizedString();
-		song.musicWriter = reader.readIntByteSizedString();
-		song.copyright = reader.readIntByteSizedString();
-		song.tabAuthor = reader.readIntByteSizedString();
-		song.instructions = reader.readIntByteSizedString();
+		info.title = reader.readIntByteSizedString();
+		info.subtitle = reader.readIntByteSizedString();
+		info.artist = reader.readIntByteSizedString();
+		info.album = reader.readIntByteSizedString();
+		info.lyricsWriter = reader.readIntByteSizedString();
+
+		// Versions before 5 credit words and music together
+		info.musicWriter = F >= Format::Gp500
+			? reader.readIntByteSizedString()
+			: info.lyricsWriter;
+
+		info.copyright = reader.readIntByteSizedString();
+		info.tabAuthor = reader.readIntByteSizedString();
+		info.instructions = reader.readIntByteSizedString();
 		
 		auto numComments = reader.readUnsignedInt();
-		for (auto i = 0; i < numComments; ++i) {
-			song.comments.push_back(reader.readIntByteSizedString());
+		info.comments.reserve(std::min<size_t>(numComments, reader.remaining() / MinCommentSize));
+		for (uint32_t i = 0; i < numComments && !reader.failed(); ++i) {
+			info.comments.emplace_back(reader.readIntByteSizedString());
 		}
 	}
 
@@ -68,6 +412,7 @@ namespace libgp
 	{
 		Lyrics lyrics;
 		lyrics.trackNumber = reader.readUnsignedInt();
+		lyrics.lines.reserve(5);
 
 		for (auto i = 0; i < 5; ++i) {
 			LyricLine line;
@@ -99,21 +444,25 @@ namespace libgp
 		pageSetup.wordsBy = reader.readIntByteSizedString();
 		pageSetup.musicBy = reader.readIntByteSizedString();
 		pageSetup.wordsAndMusicBy = reader.readIntByteSizedString();
-		auto copyrightLine1 = reader.readIntByteSizedString();
-		auto copyRightLine2 = reader.readIntByteSizedString();
-		pageSetup.copyright = copyrightLine1 + "\n" + copyRightLine2;
+		pageSetup.copyright = reader.readIntByteSizedString();
+		pageSetup.copyright += '\n';
+		pageSetup.copyright += reader.readIntByteSizedString();
 		pageSetup.pageNumber = reader.readIntByteSizedString();
 
 		return pageSetup;
 	}
 
+	template<Gp5Reader::Format F>
 	Tempo Gp5Reader::readTempo(StreamReader& reader) const
 	{
 		Tempo tempo;
 
-		tempo.name = reader.readIntByteSizedString();
+		if constexpr (F >= Format::Gp500) {
+			tempo.name = reader.readIntByteSizedString();
+		}
+
 		tempo.value = reader.readUnsignedInt();
-		tempo.isHidden = (version().major() == 5 && version().minor() > 0)
+		tempo.isHidden = F == Format::Gp510
 			? reader.readBoolean()
 			: false;
 
@@ -122,7 +471,8 @@ namespace libgp
 
 	std::vector<MidiChannel> Gp5Reader::readMidiChannels(StreamReader& reader) const
 	{
-		std::vector<MidiChannel> channels{64};
+		std::vector<MidiChannel> channels;
+		channels.reserve(64);
 
 		for (auto i = 0; i < 64; ++i) {
 			MidiChannel channel;
@@ -174,51 +524,83 @@ namespace libgp
 		return std::make_tuple(signs, fromSigns);
 	}
 
-	void Gp5Reader::readMeasureHeaders(uint32_t numMeasures, Song& song, std::tuple<DirectionSigns, DirectionSigns> directionSigns, StreamReader& reader) const
+	template<Gp5Reader::Format F>
+	void Gp5Reader::readMeasureHeaders(uint32_t numMeasures, Song& song, const std::tuple<DirectionSigns, DirectionSigns>& directionSigns, TripletFeel tripletFeel, StreamReader& reader) const
 	{
+		song.measureHeaders.reserve(std::min<size_t>(numMeasures, reader.remaining()));
+
 		std::optional<MeasureHeader> previous = std::nullopt;
-		for (auto i = 1; i <= numMeasures; ++i) {
-			auto header = readMeasureHeader(i, song, previous, reader);
+		for (uint32_t i = 1; i <= numMeasures; ++i) {
+			auto header = readMeasureHeader<F>(i, song, previous, reader);
+			if (reader.failed()) {
+				return;
+			}
+
+			if constexpr (F < Format::Gp500) {
+				header.tripletFeel = tripletFeel;
+			}
+
 			song.measureHeaders.push_back(header);
 			previous = header;
 		}
 
-		auto signs = std::get<0>(directionSigns);
-		for (auto const&[sign, number] : signs) {
-			if (number > -1) {
-				song.measureHeaders[number - 1].direction = sign;
-			}
-		}
+		applyDirectionSigns(song, directionSigns, reader);
+	}
+
+	// Signs are stored before the measures are counted, so the measures they
+	// are placed at can only be checked once the headers are in. Unused signs
+	// have a measure of -1.
+	void Gp5Reader::applyDirectionSigns(Song& song, const std::tuple<DirectionSigns, DirectionSigns>& directionSigns, StreamReader& reader) const
+	{
+		auto apply = [&](const DirectionSigns& signs, std::string MeasureHeader::* field) {
+			for (auto const&[sign, number] : signs) {
+				if (number <= -1) {
+					continue;
+				}
+
+				if (number < 1 || static_cast<size_t>(number) > song.measureHeaders.size()) {
+					reader.fail(ParseErrorCode::InvalidData, 0);
+					return;
+				}
 
-		auto fromSigns = std::get<1>(directionSigns);
-		for (auto const&[sign, number] : fromSigns) {
-			if (number > -1) {
-				song.measureHeaders[number - 1].fromDirection = sign;
+				song.measureHeaders[number - 1].*field = sign;
 			}
-		}
+		};
+
+		apply(std::get<0>(directionSigns), &MeasureHeader::direction);
+		apply(std::get<1>(directionSigns), &MeasureHeader::fromDirection);
 	}
 
+	template<Gp5Reader::Format F>
 	MeasureHeader Gp5Reader::readMeasureHeader(uint32_t number, Song& song, std::optional<MeasureHeader> previous, StreamReader& reader) const
 	{
-		if (previous != std::nullopt) {
-			reader.skip(1);
+		if constexpr (F >= Format::Gp500) {
+			if (previous != std::nullopt) {
+				reader.skip(1);
+			}
 		}
 
 		auto flags = reader.readUnsignedByte();
-		
+
 		MeasureHeader header;
 		header.number = number;
 		header.start = 0;
 		header.tempo = song.tempo.value;
 
+		// The first measure has no time signature to carry on
+		if (previous == std::nullopt && (flags & 0x03) != 0x03) {
+			reader.fail(ParseErrorCode::InvalidData, reader.position() - 1);
+			return header;
+		}
+
 		if (flags & 0x01) {
-			header.timeSignature.numerator = reader.readSignedByte();
+			header.timeSignature.numerator = checkRange(reader.readSignedByte(), 1, 127, reader);
 		} else {
 			header.timeSignature.numerator = previous->timeSignature.numerator;
 		}
 
 		if (flags & 0x02) {
-			header.timeSignature.denominator.value = reader.readSignedByte();
+			header.timeSignature.denominator.value = checkRange(reader.readSignedByte(), 1, 127, reader);
 		} else {
 			header.timeSignature.denominator = previous->timeSignature.denominator;
 		}
@@ -230,7 +612,9 @@ namespace libgp
 		}
 
 		if (flags & 0x10) {
-			header.repeatAlternative = reader.readUnsignedByte();
+			header.repeatAlternative = F >= Format::Gp500
+				? reader.readUnsignedByte()
+				: readRepeatAlternative(song, reader);
 		}
 
 		if (flags & 0x20) {
@@ -239,7 +623,7 @@ namespace libgp
 
 		if (flags & 0x40) {
 			auto root = reader.readSignedByte();
-			auto type = reader.readSignedByte();
+			reader.skip(1); // Major or minor, which the key signature does not keep
 			header.keySignature = static_cast<KeySignature>(root);
 		} else if (header.number > 1) {
 			header.keySignature = previous->keySignature;
@@ -247,6 +631,10 @@ namespace libgp
 
 		header.hasDoubleBar = static_cast<bool>(flags & 0x80);
 
+		if constexpr (F < Format::Gp500) {
+			return header;
+		}
+
 		if (header.repeatClose > -1) {
 			header.repeatClose--;
 		}
@@ -262,7 +650,7 @@ namespace libgp
 			header.timeSignature.beams = previous->timeSignature.beams;
 		}
 
-		if (flags & 0x10 == 0) {
+		if (!(flags & 0x10)) {
 			reader.skip(1);
 		}
 
@@ -271,6 +659,21 @@ namespace libgp
 		return header;
 	}
 
+	// Versions before 5 store the last ending a measure is played on. The
+	// endings before it belong to this measure unless a measure since the
+	// repeat was opened has claimed them already.
+	uint8_t Gp5Reader::readRepeatAlternative(const Song& song, StreamReader& reader) const
+	{
+		auto last = std::min<uint8_t>(reader.readUnsignedByte(), 8);
+
+		uint8_t claimed = 0;
+		for (auto it = song.measureHeaders.rbegin(); it != song.measureHeaders.rend() && !it->isRepeatOpen; ++it) {
+			claimed |= it->repeatAlternative;
+		}
+
+		return static_cast<uint8_t>(((1 << last) - 1) ^ claimed);
+	}
+
 	Marker Gp5Reader::readMarker(StreamReader& reader) const
 	{
 		Marker marker;
@@ -289,43 +692,66 @@ namespace libgp
 		return color;
 	}
 
-	void Gp5Reader::readTracks(uint32_t numTracks, Song& song, std::vector<MidiChannel> midiChannels, StreamReader& reader) const
+	template<Gp5Reader::Format F>
+	void Gp5Reader::readTracks(uint32_t numTracks, Song& song, const std::vector<MidiChannel>& midiChannels, StreamReader& reader) const
 	{
-		for (auto i = 1; i <= numTracks; ++i) {
-			auto track = readTrack(i, midiChannels, reader);
-			song.tracks.push_back(track);
+		song.tracks.reserve(std::min<size_t>(numTracks, reader.remaining() / MinTrackSize));
+		for (uint32_t i = 1; i <= numTracks; ++i) {
+			auto track = readTrack<F>(i, midiChannels, reader);
+			if (reader.failed()) {
+				return;
+			}
+
+			song.tracks.push_back(std::move(track));
 		}
 
-		if (version().major() == 5 && version().minor() == 0) {
+		skipTrackPadding<F>(reader);
+	}
+
+	// Version 5 files have padding between the last track and the first
+	// measure, one byte shorter in 5.10
+	template<Gp5Reader::Format F>
+	void Gp5Reader::skipTrackPadding(StreamReader& reader) const
+	{
+		if constexpr (F == Format::Gp500) {
 			reader.skip(2);
-		} else {
+		} else if constexpr (F == Format::Gp510) {
 			reader.skip(1);
 		}
 	}
 
-	Track Gp5Reader::readTrack(uint32_t number, std::vector<MidiChannel> midiChannels, StreamReader& reader) const
+	template<Gp5Reader::Format F>
+	Track Gp5Reader::readTrack(uint32_t number, const std::vector<MidiChannel>& midiChannels, StreamReader& reader) const
 	{
-		if (number == 1 || (version().major() == 5 && version().minor() == 0)) {
+		if (F == Format::Gp500 || (F == Format::Gp510 && number == 1)) {
 			reader.skip(1);
 		}
 
 		auto flags1 = reader.readUnsignedByte();
 
-		Track track;
+		Track track{};
+		track.number = number;
 		track.isPercussionTrack = static_cast<bool>(flags1 & 0x01);
 		track.is12StringGuitarTrack = static_cast<bool>(flags1 & 0x02);
 		track.isBanjoTrack = static_cast<bool>(flags1 & 0x04);
+
+		// Tracks could not be hidden before version 5, nor use RSE
+		if constexpr (F < Format::Gp500) {
+			flags1 = (flags1 & 0x07) | 0x08;
+		}
+
 		track.isVisible = static_cast<bool>(flags1 & 0x08);
 		track.isSolo = static_cast<bool>(flags1 & 0x10);
 		track.isMute = static_cast<bool>(flags1 & 0x20);
 		track.useRSE = static_cast<bool>(flags1 & 0x40);
 		track.indicateTuning = static_cast<bool>(flags1 & 0x80);
-		track.name = reader.readString(40);
+		track.name = reader.readByteSizedString(40);
 		
 		auto numStrings = reader.readUnsignedInt();
-		for (auto i = 1; i <= 7; ++i) {
+		track.strings.reserve(std::min<size_t>(numStrings, 7));
+		for (uint32_t i = 1; i <= 7; ++i) {
 			auto tuning = reader.readUnsignedInt();
-			if (numStrings > i) {
+			if (i <= numStrings) {
 				GuitarString string;
 				string.number = i;
 				string.value = tuning;
@@ -335,11 +761,18 @@ namespace libgp
 
 		track.port = reader.readUnsignedInt();
 		track.channel = readMidiChannel(midiChannels, reader);
-		track.isPercussionTrack = track.channel->channel == 9;
+		if (track.channel && track.channel->channel == 9) {
+			track.isPercussionTrack = true;
+		}
+
 		track.numFrets = reader.readUnsignedInt();
 		track.offset = reader.readUnsignedInt();
 		track.color = readColor(reader);
 
+		if constexpr (F < Format::Gp500) {
+			return track;
+		}
+
 		auto flags2 = reader.readUnsignedShort();
 		track.settings.showTablature = static_cast<bool>(flags2 & 0x001);
 		track.settings.showNotation = static_cast<bool>(flags2 & 0x002);
@@ -355,17 +788,22 @@ namespace libgp
 		track.settings.extendRhythmic = static_cast<bool>(flags2 & 0x800);
 
 		track.rse.autoAccentuation = static_cast<Accentuation>(reader.readUnsignedByte());
-		track.channel->bank = reader.readUnsignedByte();
-		readTrackRSE(track.rse, reader);
+		auto bank = reader.readUnsignedByte();
+		if (track.channel) {
+			track.channel->bank = bank;
+		}
+
+		readTrackRSE<F>(track.rse, reader);
 
 		return track;
 	}
 
-	std::optional<MidiChannel> Gp5Reader::readMidiChannel(std::vector<MidiChannel> midiChannels, StreamReader& reader) const
+	std::optional<MidiChannel> Gp5Reader::readMidiChannel(const std::vector<MidiChannel>& midiChannels, StreamReader& reader) const
 	{
 		auto index = reader.readUnsignedInt() - 1;
 		auto effectChannel = reader.readUnsignedInt() - 1;
-		if (index < 0 || index >= midiChannels.size()) {
+		// No channel, stored as 0, wraps around past the last one
+		if (index >= midiChannels.size()) {
 			return std::nullopt;
 		}
 
@@ -381,20 +819,22 @@ namespace libgp
 		return trackChannel;
 	}
 
+	template<Gp5Reader::Format F>
 	void Gp5Reader::readTrackRSE(TrackRSE& rse, StreamReader& reader) const
 	{
 		rse.humanize = reader.readUnsignedByte();
 		reader.skip(12); // TODO: 3 ints???
 		reader.skip(12); // TODO: ???
-		rse.instrument = readRSEInstrument(reader);
+		rse.instrument = readRSEInstrument<F>(reader);
 
-		if (version().major() >= 5 && version().minor() > 0) {
+		if constexpr (F == Format::Gp510) {
 			rse.equalizer = readRSEEqualizer(4, reader);
 			rse.instrument.effect = reader.readIntByteSizedString();
 			rse.instrument.effectCategory = reader.readIntByteSizedString();
 		}
 	}
 
+	template<Gp5Reader::Format F>
 	RSEInstrument Gp5Reader::readRSEInstrument(StreamReader& reader) const
 	{
 		RSEInstrument instrument;
@@ -402,7 +842,7 @@ namespace libgp
 		instrument.unknown = reader.readUnsignedInt(); // TODO: ??? mostly 1
 		instrument.soundBank = reader.readSignedInt();
 
-		if (version().major() == 5 && version().minor() == 0) {
+		if constexpr (F == Format::Gp500) {
 			instrument.effectNumber = reader.readSignedShort();
 			reader.skip(1);
 		} else {
@@ -415,6 +855,7 @@ namespace libgp
 	RSEEqualizer Gp5Reader::readRSEEqualizer(uint8_t numKnobs, StreamReader& reader) const
 	{
 		RSEEqualizer equalizer;
+		equalizer.knobs.reserve(numKnobs);
 		for (auto i = 0; i < numKnobs; ++i) {
 			auto value = reader.readSignedByte();
 			equalizer.knobs.push_back(-value / 10.0);
@@ -424,60 +865,279 @@ namespace libgp
 		return equalizer;
 	}
 
+	template<Gp5Reader::Format F>
 	void Gp5Reader::readMeasures(Song& song, StreamReader& reader) const
 	{
-		auto tempo = song.tempo.value;
-		auto start = Duration::QuarterTime;
+		layoutMeasures(song);
+
+		for (auto& header : song.measureHeaders) {
+			for (auto& track : song.tracks) {
+				auto& measure = track.measures.emplace_back(track, header);
+				readMeasure<F>(measure, reader);
+				if (reader.failed()) {
+					return;
+				}
+			}
+		}
+
+		resolveTempos(song);
+	}
+
+	template<Gp5Reader::Format F>
+	void Gp5Reader::readMeasuresByTrack(Song& song, StreamReader& reader) const
+	{
+		layoutMeasures(song);
+
+		auto index = scanMeasures<F>(song, reader);
+		if (reader.failed()) {
+			return;
+		}
+
+		auto data = reader.data();
+		std::vector<ParseError> errors(song.tracks.size());
+
+		threadPool()->parallelFor(song.tracks.size(), [&](size_t trackIndex) {
+			errors[trackIndex] = readTrackMeasures<F>(song, trackIndex, index, data);
+		});
+
+		// Reports the error nearest the start, which a read in order would have hit first
+		const ParseError* first = nullptr;
+		for (auto& error : errors) {
+			if (error.code != ParseErrorCode::None && (first == nullptr || error.offset < first->offset)) {
+				first = &error;
+			}
+		}
+
+		if (first != nullptr) {
+			reader.fail(first->code, first->offset);
+		}
+	}
+
+	// Decodes the measures of one track from the blocks recorded in the index.
+	// Tracks can be decoded concurrently, as each allocates from its own arena.
+	// Returns the error the track stopped at, if any.
+	template<Gp5Reader::Format F>
+	ParseError Gp5Reader::readTrackMeasures(Song& song, size_t trackIndex, const MeasureIndex& index, const std::byte* data) const
+	{
+		ArenaScope scope(song.storage->addArena());
+
+		// Drops whatever an earlier attempt that failed part way through left behind
+		auto& track = song.tracks[trackIndex];
+		track.measures.clear();
+
+		for (size_t i = 0; i < song.measureHeaders.size(); ++i) {
+			auto begin = index.begin(i, trackIndex);
+			StreamReader blockReader(data + begin, index.end(i, trackIndex) - begin);
+
+			auto& measure = track.measures.emplace_back(track, song.measureHeaders[i]);
+			readMeasure<F>(measure, blockReader);
+
+			if (blockReader.failed()) {
+				// The offset is from the start of the block
+				auto error = blockReader.error();
+				error.offset += begin;
+				error.phase = ParsePhase::Measures;
+				return error;
+			}
+		}
+
+		return ParseError();
+	}
 
-		for (auto header : song.measureHeaders) {
+	// Sets where each measure starts and makes room for the measures of every
+	// track. Measures and voices refer back to their owners, so they must never
+	// be moved once created.
+	void Gp5Reader::layoutMeasures(Song& song) const
+	{
+		auto start = Duration::QuarterTime;
+		for (auto& header : song.measureHeaders) {
 			header.start = start;
+			start += header.calcLength();
+		}
+
+		for (auto& track : song.tracks) {
+			track.measures.reserve(song.measureHeaders.size());
+		}
+	}
+
+	// Measures are decoded one header after another, each for every track in
+	// turn, so the last one created is the one an error stopped in. It is
+	// dropped along with the others of its header.
+	void Gp5Reader::dropPartialMeasures(Song& song) const
+	{
+		size_t numMeasures = 0;
+		for (auto& track : song.tracks) {
+			numMeasures += track.measures.size();
+		}
 
-			for (auto track : song.tracks) {
-				Measure measure(track, header);
-				measure.header = header;
-				tempo = header.tempo;
-				track.measures.push_back(measure);
-				readMeasure(measure, reader);
+		auto complete = numMeasures > 0 ? (numMeasures - 1) / song.tracks.size() : 0;
+		for (auto& track : song.tracks) {
+			while (track.measures.size() > complete) {
+				track.measures.pop_back();
 			}
+		}
+	}
 
+	// Applies the tempo of mix table changes to their measure and carries it over
+	// into the following ones. Headers without measures, as in a salvaged song,
+	// keep the tempo carried over.
+	void Gp5Reader::resolveTempos(Song& song) const
+	{
+		auto tempo = song.tempo.value;
+		for (size_t i = 0; i < song.measureHeaders.size(); ++i) {
+			auto& header = song.measureHeaders[i];
 			header.tempo = tempo;
-			start += header.calcLength();
+
+			// Changes on several tracks or voices are not met in the order they
+			// are played, so the one that starts last wins
+			const Beat* last = nullptr;
+			for (auto& track : song.tracks) {
+				if (i >= track.measures.size()) {
+					continue;
+				}
+
+				for (auto& voice : track.measures[i].voices) {
+					for (auto& beat : voice.beats) {
+						auto& change = beat.effect.mixTableChange;
+						if (change && change->tempo >= 0 && (last == nullptr || beat.start >= last->start)) {
+							last = &beat;
+						}
+					}
+				}
+			}
+
+			if (last != nullptr) {
+				header.tempo = last->effect.mixTableChange->tempo;
+			}
+
+			tempo = header.tempo;
 		}
 	}
 
+	template<Gp5Reader::Format F>
 	void Gp5Reader::readMeasure(Measure& measure, StreamReader& reader) const
 	{
 		auto start = measure.header.start;
-		for (auto voice : measure.voices) {
-			readVoice(start, voice, reader);
+
+		// Versions before 5 have a single voice and no line breaks
+		if constexpr (F < Format::Gp500) {
+			readVoice<F>(start, measure.voices[0], reader);
+			return;
+		}
+
+		for (auto& voice : measure.voices) {
+			readVoice<F>(start, voice, reader);
 		}
 
-		measure.lineBreak = static_cast<LineBreak>(reader.readUnsignedByte());
+		// The line break of the very last measure may be cut off at the end of the file
+		measure.lineBreak = !reader.atEnd()
+			? static_cast<LineBreak>(reader.readUnsignedByte())
+			: LineBreak::None;
 	}
 
+	template<Gp5Reader::Format F>
 	void Gp5Reader::readVoice(uint32_t start, Voice& voice, StreamReader& reader) const
 	{
 		auto numBeats = reader.readUnsignedInt();
-		for (auto i = 0; i < numBeats; ++i) {
-			auto duration = readBeat(start, voice, reader);
+		voice.beats.reserve(std::min<size_t>(numBeats, reader.remaining() / MinBeatSize));
+		for (uint32_t i = 0; i < numBeats && !reader.failed(); ++i) {
+			auto duration = readBeat<F>(start, voice, reader);
 			start += duration;
 		}
 	}
 
+	template<Gp5Reader::Format F>
 	uint32_t Gp5Reader::readBeat(uint32_t start, Voice& voice, StreamReader& reader) const
 	{
 		auto flags = reader.readUnsignedByte();
-		auto beat = getBeat(voice, start);
+		auto& beat = getBeat(voice, start);
 
 		beat.status = flags & 0x40
 			? static_cast<BeatStatus>(reader.readUnsignedByte())
 			: BeatStatus::Normal;
 
-		auto duration = readDuration(flags, reader);
+		beat.duration = readDuration(flags, reader);
 
 		if (flags & 0x02) {
-			beat.effect.chord = readChord(voice.measure.track.strings.size(), reader);
+			beat.effect.chord = readChord<F>(voice.measure.track.strings.size(), reader);
+		}
+
+		if (flags & 0x04) {
+			beat.text = reader.readIntByteSizedString();
+		}
+
+		std::optional<Harmonic> harmonic;
+		if (flags & 0x08) {
+			if constexpr (F == Format::Gp3) {
+				harmonic = readGp3BeatEffect<F>(beat.effect, reader);
+			} else {
+				readBeatEffect<F>(beat.effect, reader);
+			}
+		}
+
+		if (flags & 0x10) {
+			beat.effect.mixTableChange = readMixTableChange<F>(reader);
+		}
+
+		readNotes<F>(voice, beat, reader);
+
+		if constexpr (F < Format::Gp500) {
+			if (harmonic) {
+				for (auto& note : beat.notes) {
+					note.effect.harmonic = harmonic;
+				}
+			}
+
+			return beat.status != BeatStatus::Empty
+				? beat.duration.calcTime()
+				: 0;
+		}
+
+		auto flags2 = reader.readUnsignedShort();
+		if (flags2 & 0x0010) {
+			beat.octave = Octave::Ottava;
+		}
+
+		if (flags2 & 0x0020) {
+			beat.octave = Octave::OttavaBassa;
+		}
+
+		if (flags2 & 0x0040) {
+			beat.octave = Octave::Quindicesima;
+		}
+
+		if (flags2 & 0x0100) {
+			beat.octave = Octave::QuindicesimaBassa;
+		}
+
+		beat.display.breakBeam = static_cast<bool>(flags2 & 0x0001);
+		beat.display.forceBeam = static_cast<bool>(flags2 & 0x0004);
+		beat.display.forceBracket = static_cast<bool>(flags2 & 0x2000);
+		beat.display.breakSecondaryTuplet = static_cast<bool>(flags2 & 0x1000);
+
+		if (flags2 & 0x0002) {
+			beat.display.beamDirection = VoiceDirection::Down;
 		}
+
+		if (flags2 & 0x0008) {
+			beat.display.beamDirection = VoiceDirection::Up;
+		}
+
+		if (flags2 & 0x0200) {
+			beat.display.tupletBracket = TupletBracket::Start;
+		}
+
+		if (flags2 & 0x0400) {
+			beat.display.tupletBracket = TupletBracket::End;
+		}
+
+		if (flags2 & 0x0800) {
+			beat.display.breakSecondary = reader.readUnsignedByte();
+		}
+
+		return beat.status != BeatStatus::Empty
+			? beat.duration.calcTime()
+			: 0;
 	}
 
 	Beat& Gp5Reader::getBeat(Voice& voice, uint32_t start) const
@@ -488,19 +1148,19 @@ namespace libgp
 			}
 		}
 
-		Beat beat;
+		auto& beat = voice.beats.emplace_back();
 		beat.start = start;
-		voice.beats.push_back(beat);
 		return beat;
 	}
 
 	Duration Gp5Reader::readDuration(uint8_t flags, StreamReader& reader) const
 	{
 		Duration duration;
-		duration.value = 1 << (reader.readSignedByte() + 2);
+		// -2 stands for a whole note and 5 for a hundred twenty-eighth
+		duration.value = static_cast<uint8_t>(1 << (checkRange(reader.readSignedByte(), -2, 5, reader) + 2));
 		duration.isDotted = static_cast<bool>(flags & 0x01);
 
-		if (flags & 0x02) {
+		if (flags & 0x20) {
 			auto tupletVal = reader.readUnsignedInt();
 			if (tupletVal == 3) {
 				duration.tuplet.enters = 3;
@@ -532,16 +1192,17 @@ namespace libgp
 		return duration;
 	}
 
+	template<Gp5Reader::Format F>
 	Chord Gp5Reader::readChord(size_t numStrings, StreamReader& reader) const
 	{
 		Chord chord;
-		for (auto i = 0; i < numStrings; ++i) {
-			chord.strings.push_back(-1);
-		}
+		chord.strings.assign(numStrings, -1);
 
 		chord.isNewFormat = reader.readBoolean();
 		if (!chord.isNewFormat) {
 			readOldChord(chord, reader);
+		} else if constexpr (F == Format::Gp3) {
+			readNewGp3Chord(chord, reader);
 		} else {
 			readNewChord(chord, reader);
 		}
@@ -554,7 +1215,7 @@ namespace libgp
 		chord.name = reader.readIntByteSizedString();
 		chord.firstFret = reader.readUnsignedInt();
 		if (chord.firstFret) {
-			for (auto i = 0; i < 6; ++i) {
+			for (size_t i = 0; i < 6; ++i) {
 				auto fret = reader.readSignedInt();
 				if (i < chord.strings.size()) {
 					chord.strings[i] = fret;
@@ -566,8 +1227,854 @@ namespace libgp
 	void Gp5Reader::readNewChord(Chord& chord, StreamReader& reader) const
 	{
 		chord.isSharp = reader.readBoolean();
-		auto intonation = chord.isSharp ? "sharp" : "flat";
 		reader.skip(3);
-		
-	}
-}
\ No newline at end of file
+		chord.root = reader.readUnsignedByte();
+		chord.type = static_cast<ChordType>(reader.readUnsignedByte());
+		chord.extension = static_cast<ChordExtension>(reader.readUnsignedByte());
+		chord.bass = reader.readSignedInt();
+		chord.tonality = reader.readSignedInt();
+		chord.add = reader.readUnsignedByte();
+		chord.name = reader.readByteSizedString(22);
+		chord.fifth = reader.readUnsignedByte();
+		chord.ninth = reader.readUnsignedByte();
+		chord.eleventh = reader.readUnsignedByte();
+		chord.firstFret = reader.readUnsignedInt();
+
+		for (size_t i = 0; i < 7; ++i) {
+			auto fret = reader.readSignedInt();
+			if (i < chord.strings.size()) {
+				chord.strings[i] = fret;
+			}
+		}
+
+		auto numBarres = reader.readUnsignedByte();
+		uint8_t barreFrets[5], barreStarts[5], barreEnds[5];
+		for (auto& fret : barreFrets) {
+			fret = reader.readUnsignedByte();
+		}
+
+		for (auto& start : barreStarts) {
+			start = reader.readUnsignedByte();
+		}
+
+		for (auto& end : barreEnds) {
+			end = reader.readUnsignedByte();
+		}
+
+		for (auto i = 0; i < numBarres && i < 5; ++i) {
+			chord.barres.push_back({ barreFrets[i], barreStarts[i], barreEnds[i] });
+		}
+
+		chord.omissions.reserve(7);
+		for (auto i = 0; i < 7; ++i) {
+			chord.omissions.push_back(reader.readBoolean());
+		}
+
+		reader.skip(1);
+
+		chord.fingerings.reserve(7);
+		for (auto i = 0; i < 7; ++i) {
+			chord.fingerings.push_back(static_cast<Fingering>(reader.readSignedByte()));
+		}
+
+		chord.show = reader.readUnsignedByte();
+	}
+
+	// The first version of the new format, with every field but the name stored
+	// as an int and no fingerings
+	void Gp5Reader::readNewGp3Chord(Chord& chord, StreamReader& reader) const
+	{
+		chord.isSharp = reader.readBoolean();
+		reader.skip(3);
+		chord.root = reader.readSignedInt();
+		chord.type = static_cast<ChordType>(reader.readSignedInt());
+		chord.extension = static_cast<ChordExtension>(reader.readSignedInt());
+		chord.bass = reader.readSignedInt();
+		chord.tonality = reader.readSignedInt();
+		chord.add = reader.readBoolean();
+		chord.name = reader.readByteSizedString(22);
+		chord.fifth = reader.readSignedInt();
+		chord.ninth = reader.readSignedInt();
+		chord.eleventh = reader.readSignedInt();
+		chord.firstFret = reader.readUnsignedInt();
+
+		for (size_t i = 0; i < 6; ++i) {
+			auto fret = reader.readSignedInt();
+			if (i < chord.strings.size()) {
+				chord.strings[i] = fret;
+			}
+		}
+
+		auto numBarres = reader.readSignedInt();
+		int32_t barreFrets[2], barreStarts[2], barreEnds[2];
+		for (auto& fret : barreFrets) {
+			fret = reader.readSignedInt();
+		}
+
+		for (auto& start : barreStarts) {
+			start = reader.readSignedInt();
+		}
+
+		for (auto& end : barreEnds) {
+			end = reader.readSignedInt();
+		}
+
+		for (auto i = 0; i < numBarres && i < 2; ++i) {
+			chord.barres.push_back({
+				static_cast<uint8_t>(barreFrets[i]),
+				static_cast<uint8_t>(barreStarts[i]),
+				static_cast<uint8_t>(barreEnds[i])
+			});
+		}
+
+		chord.omissions.reserve(7);
+		for (auto i = 0; i < 7; ++i) {
+			chord.omissions.push_back(reader.readBoolean());
+		}
+
+		reader.skip(1);
+	}
+
+	template<Gp5Reader::Format F>
+	void Gp5Reader::readBeatEffect(BeatEffect& effect, StreamReader& reader) const
+	{
+		auto flags1 = reader.readUnsignedByte();
+		auto flags2 = reader.readUnsignedByte();
+
+		effect.vibrato = flags1 & 0x03;
+		effect.hasFadeIn = static_cast<bool>(flags1 & 0x10);
+
+		if (flags1 & 0x20) {
+			effect.slapEffect = static_cast<SlapEffect>(reader.readUnsignedByte());
+		}
+
+		if (flags2 & 0x04) {
+			effect.tremoloBar = readBend(reader);
+		}
+
+		if (flags1 & 0x40) {
+			effect.stroke = readBeatStroke<F>(reader);
+		}
+
+		effect.hasRasgueado = static_cast<bool>(flags2 & 0x01);
+
+		if (flags2 & 0x02) {
+			effect.pickStroke = static_cast<BeatStrokeDirection>(reader.readUnsignedByte());
+		}
+	}
+
+	// GP3 keeps its beat effects in a single flags byte. Harmonics are set on
+	// the beat rather than on its notes, so they are returned for the caller to
+	// apply once the notes have been read.
+	template<Gp5Reader::Format F>
+	std::optional<Harmonic> Gp5Reader::readGp3BeatEffect(BeatEffect& effect, StreamReader& reader) const
+	{
+		auto flags = reader.readUnsignedByte();
+
+		effect.vibrato = flags & 0x03;
+		effect.hasFadeIn = static_cast<bool>(flags & 0x10);
+
+		// A tremolo bar shares its flag with the slap effects
+		if (flags & 0x20) {
+			auto type = reader.readUnsignedByte();
+			if (type == 0) {
+				effect.tremoloBar = readGp3TremoloBar(reader);
+			} else {
+				effect.slapEffect = static_cast<SlapEffect>(type);
+				reader.skip(4);
+			}
+		}
+
+		if (flags & 0x40) {
+			effect.stroke = readBeatStroke<F>(reader);
+		}
+
+		std::optional<Harmonic> harmonic;
+		if (flags & 0x0C) {
+			harmonic = Harmonic{};
+			harmonic->type = flags & 0x04 ? HarmonicType::Natural : HarmonicType::Artificial;
+		}
+
+		return harmonic;
+	}
+
+	template<Gp5Reader::Format F>
+	BeatStroke Gp5Reader::readBeatStroke(StreamReader& reader) const
+	{
+		// GP5 stores the up stroke first, the opposite of earlier versions
+		auto first = reader.readUnsignedByte();
+		auto second = reader.readUnsignedByte();
+		auto strokeUp = F >= Format::Gp500 ? first : second;
+		auto strokeDown = F >= Format::Gp500 ? second : first;
+
+		BeatStroke stroke;
+		if (strokeDown > 0) {
+			stroke.direction = BeatStrokeDirection::Down;
+			stroke.value = strokeDown;
+		} else if (strokeUp > 0) {
+			stroke.direction = BeatStrokeDirection::Up;
+			stroke.value = strokeUp;
+		}
+
+		return stroke;
+	}
+
+	Bend Gp5Reader::readBend(StreamReader& reader) const
+	{
+		// Positions are stored in sixtieths of the note and values in
+		// twenty-fifths of a semitone
+		const int32_t PositionLength = 60;
+		const int32_t SemitoneLength = 25;
+
+		Bend bend;
+		bend.type = static_cast<BendType>(reader.readSignedByte());
+		bend.value = reader.readSignedInt();
+
+		auto numPoints = reader.readUnsignedInt();
+		bend.points.reserve(std::min<size_t>(numPoints, reader.remaining() / MinBendPointSize));
+		for (uint32_t i = 0; i < numPoints && !reader.failed(); ++i) {
+			BendPoint point;
+			auto position = checkRange(reader.readSignedInt(), 0, PositionLength, reader);
+			point.position = static_cast<uint8_t>(std::lround(position * Bend::MaxPosition / static_cast<double>(PositionLength)));
+			point.value = static_cast<int8_t>(std::lround(static_cast<int64_t>(reader.readSignedInt()) * Bend::SemitoneLength / static_cast<double>(SemitoneLength)));
+			point.hasVibrato = reader.readBoolean();
+			bend.points.push_back(point);
+		}
+
+		return bend;
+	}
+
+	// GP3 only stores a dip, as deep as the value, down to the middle of the beat
+	Bend Gp5Reader::readGp3TremoloBar(StreamReader& reader) const
+	{
+		Bend bend;
+		bend.type = BendType::Dip;
+		bend.value = reader.readSignedInt();
+
+		auto depth = static_cast<int8_t>(std::lround(-(bend.value / (Bend::SemitoneLength * 2.0))));
+		bend.points.push_back({ 0, 0, false });
+		bend.points.push_back({ static_cast<uint8_t>(Bend::MaxPosition / 2), depth, false });
+		bend.points.push_back({ static_cast<uint8_t>(Bend::MaxPosition), 0, false });
+
+		return bend;
+	}
+
+	template<Gp5Reader::Format F>
+	MixTableChange Gp5Reader::readMixTableChange(StreamReader& reader) const
+	{
+		MixTableChange change;
+		change.instrument = reader.readSignedByte();
+
+		if constexpr (F >= Format::Gp500) {
+			change.rse = readRSEInstrument<F>(reader);
+
+			if constexpr (F == Format::Gp500) {
+				reader.skip(1);
+			}
+		}
+
+		MixTableItem* items[] = {
+			&change.volume,
+			&change.balance,
+			&change.chorus,
+			&change.reverb,
+			&change.phaser,
+			&change.tremolo
+		};
+
+		for (auto item : items) {
+			item->value = reader.readSignedByte();
+		}
+
+		if constexpr (F >= Format::Gp500) {
+			change.tempoName = reader.readIntByteSizedString();
+		}
+
+		change.tempo = reader.readSignedInt();
+
+		for (auto item : items) {
+			if (item->value >= 0) {
+				item->duration = reader.readUnsignedByte();
+			}
+		}
+
+		if (change.tempo >= 0) {
+			change.tempoDuration = reader.readUnsignedByte();
+
+			if constexpr (F == Format::Gp510) {
+				change.hideTempo = reader.readBoolean();
+			}
+		}
+
+		// GP3 applies every change to its own track only
+		if constexpr (F == Format::Gp3) {
+			return change;
+		}
+
+		auto flags = reader.readUnsignedByte();
+		for (auto i = 0; i < 6; ++i) {
+			items[i]->allTracks = static_cast<bool>(flags & (1 << i));
+		}
+
+		if constexpr (F == Format::Gp4) {
+			return change;
+		}
+
+		change.useRSE = static_cast<bool>(flags & 0x40);
+		change.wah.value = reader.readSignedByte();
+		change.wah.display = static_cast<bool>(flags & 0x80);
+
+		if constexpr (F == Format::Gp510) {
+			change.rse.effect = reader.readIntByteSizedString();
+			change.rse.effectCategory = reader.readIntByteSizedString();
+		}
+
+		return change;
+	}
+
+	template<Gp5Reader::Format F>
+	void Gp5Reader::readNotes(Voice& voice, Beat& beat, StreamReader& reader) const
+	{
+		auto stringFlags = reader.readUnsignedByte();
+		for (auto& string : voice.measure.track.strings) {
+			if (stringFlags & (1 << (7 - string.number))) {
+				auto& note = beat.notes.emplace_back();
+				readNote<F>(note, string, voice, beat, reader);
+			}
+		}
+	}
+
+	template<Gp5Reader::Format F>
+	void Gp5Reader::readNote(Note& note, const GuitarString& string, const Voice& voice, const Beat& beat, StreamReader& reader) const
+	{
+		auto flags = reader.readUnsignedByte();
+		note.string = string.number;
+		note.effect.isHeavyAccentuatedNote = F >= Format::Gp500 && (flags & 0x02);
+		note.effect.isGhostNote = static_cast<bool>(flags & 0x04);
+		note.effect.isAccentuated = F >= Format::Gp4 && (flags & 0x40);
+
+		if (flags & 0x20) {
+			note.type = static_cast<NoteType>(reader.readUnsignedByte());
+		}
+
+		// Versions before 5 can give a note its own duration and tuplet, which
+		// the model has no place for
+		if (F < Format::Gp500 && (flags & 0x01)) {
+			reader.skip(2);
+		}
+
+		if (flags & 0x10) {
+			note.velocity = unpackVelocity(reader.readSignedByte());
+		}
+
+		if (flags & 0x20) {
+			int32_t value = reader.readSignedByte();
+			if (note.type == NoteType::Tie) {
+				auto tiedValue = getTiedNoteValue(string.number, voice, beat);
+				if (tiedValue >= 0) {
+					value = tiedValue;
+				}
+			}
+
+			note.value = static_cast<uint8_t>(std::max(0, std::min(99, value)));
+		}
+
+		if (flags & 0x80) {
+			note.effect.leftHandFingering = static_cast<Fingering>(reader.readSignedByte());
+			note.effect.rightHandFingering = static_cast<Fingering>(reader.readSignedByte());
+		}
+
+		if constexpr (F >= Format::Gp500) {
+			if (flags & 0x01) {
+				note.durationPercent = reader.readDouble();
+			}
+
+			auto flags2 = reader.readUnsignedByte();
+			note.swapAccidentals = static_cast<bool>(flags2 & 0x02);
+		}
+
+		if (flags & 0x08) {
+			readNoteEffect<F>(note.effect, reader);
+		}
+	}
+
+	int32_t Gp5Reader::getTiedNoteValue(uint8_t string, const Voice& voice, const Beat& beat) const
+	{
+		auto voiceIndex = &voice - voice.measure.voices.data();
+		auto& measures = voice.measure.track.measures;
+
+		for (auto measure = measures.rbegin(); measure != measures.rend(); ++measure) {
+			auto& beats = measure->voices[voiceIndex].beats;
+			for (auto it = beats.rbegin(); it != beats.rend(); ++it) {
+				if (&*it == &beat || it->status == BeatStatus::Empty) {
+					continue;
+				}
+
+				for (auto& note : it->notes) {
+					if (note.string == string) {
+						return note.value;
+					}
+				}
+			}
+		}
+
+		return -1;
+	}
+
+	template<Gp5Reader::Format F>
+	void Gp5Reader::readNoteEffect(NoteEffect& effect, StreamReader& reader) const
+	{
+		auto flags1 = reader.readUnsignedByte();
+		auto flags2 = F >= Format::Gp4 ? reader.readUnsignedByte() : 0;
+
+		effect.isHammer = static_cast<bool>(flags1 & 0x02);
+		effect.letRing = static_cast<bool>(flags1 & 0x08);
+		effect.isStaccato = static_cast<bool>(flags2 & 0x01);
+		effect.palmMute = static_cast<bool>(flags2 & 0x02);
+		effect.hasVibrato = static_cast<bool>(flags2 & 0x40);
+
+		if (flags1 & 0x01) {
+			effect.bend = readBend(reader);
+		}
+
+		if (flags1 & 0x10) {
+			effect.grace = readGrace<F>(reader);
+		}
+
+		// GP3 has a single kind of slide, flagged with the other effects
+		if (F == Format::Gp3 && (flags1 & 0x04)) {
+			effect.slides.push_back(SlideType::ShiftSlideTo);
+		}
+
+		if (flags2 & 0x04) {
+			effect.tremoloPicking = readTremoloPicking(reader);
+		}
+
+		if (flags2 & 0x08) {
+			effect.slides = readSlides<F>(reader);
+		}
+
+		if (flags2 & 0x10) {
+			effect.harmonic = readHarmonic<F>(reader);
+		}
+
+		if (flags2 & 0x20) {
+			effect.trill = readTrill(reader);
+		}
+	}
+
+	template<Gp5Reader::Format F>
+	Grace Gp5Reader::readGrace(StreamReader& reader) const
+	{
+		Grace grace;
+		grace.fret = reader.readUnsignedByte();
+		grace.velocity = unpackVelocity(reader.readSignedByte());
+		grace.transition = static_cast<GraceTransition>(reader.readUnsignedByte());
+		grace.duration = static_cast<uint8_t>(1 << (7 - checkRange(reader.readUnsignedByte(), 0, 7, reader)));
+
+		// Before version 5, grace notes were always played before the beat
+		// and a dead one had no fret
+		if constexpr (F < Format::Gp500) {
+			grace.isDead = grace.fret == 0xFF;
+			grace.isOnBeat = false;
+			return grace;
+		}
+
+		auto flags = reader.readUnsignedByte();
+		grace.isDead = static_cast<bool>(flags & 0x01);
+		grace.isOnBeat = static_cast<bool>(flags & 0x02);
+
+		return grace;
+	}
+
+	template<Gp5Reader::Format F>
+	ArenaVector<SlideType> Gp5Reader::readSlides(StreamReader& reader) const
+	{
+		ArenaVector<SlideType> slides;
+
+		// GP4 stores a single slide as its type
+		if constexpr (F == Format::Gp4) {
+			auto type = static_cast<SlideType>(reader.readSignedByte());
+			if (type != SlideType::None) {
+				slides.push_back(type);
+			}
+
+			return slides;
+		}
+
+		auto flags = reader.readUnsignedByte();
+		if (flags & 0x01) {
+			slides.push_back(SlideType::ShiftSlideTo);
+		}
+
+		if (flags & 0x02) {
+			slides.push_back(SlideType::LegatoSlideTo);
+		}
+
+		if (flags & 0x04) {
+			slides.push_back(SlideType::OutDownwards);
+		}
+
+		if (flags & 0x08) {
+			slides.push_back(SlideType::OutUpwards);
+		}
+
+		if (flags & 0x10) {
+			slides.push_back(SlideType::IntoFromBelow);
+		}
+
+		if (flags & 0x20) {
+			slides.push_back(SlideType::IntoFromAbove);
+		}
+
+		return slides;
+	}
+
+	template<Gp5Reader::Format F>
+	Harmonic Gp5Reader::readHarmonic(StreamReader& reader) const
+	{
+		Harmonic harmonic;
+		auto type = reader.readSignedByte();
+		harmonic.pitch = 0;
+		harmonic.accidental = 0;
+		harmonic.octave = 0;
+		harmonic.fret = 0;
+
+		// GP4 has no data beyond the type, and numbers artificial harmonics
+		// after the interval they sound above the fret
+		if constexpr (F == Format::Gp4) {
+			harmonic.type = type > static_cast<int8_t>(HarmonicType::Semi)
+				? HarmonicType::Artificial
+				: static_cast<HarmonicType>(type);
+			return harmonic;
+		}
+
+		harmonic.type = static_cast<HarmonicType>(type);
+
+		if (harmonic.type == HarmonicType::Artificial) {
+			harmonic.pitch = reader.readUnsignedByte();
+			harmonic.accidental = reader.readSignedByte();
+			harmonic.octave = reader.readUnsignedByte();
+		} else if (harmonic.type == HarmonicType::Tapped) {
+			harmonic.fret = reader.readUnsignedByte();
+		}
+
+		return harmonic;
+	}
+
+	TremoloPicking Gp5Reader::readTremoloPicking(StreamReader& reader) const
+	{
+		// 1, 2 and 3 stand for eighth, sixteenth and thirty-second notes
+		TremoloPicking tremoloPicking;
+		tremoloPicking.duration = static_cast<uint8_t>(Duration::Quarter << checkRange(reader.readSignedByte(), 0, 5, reader));
+		return tremoloPicking;
+	}
+
+	Trill Gp5Reader::readTrill(StreamReader& reader) const
+	{
+		// 1, 2 and 3 stand for sixteenth, thirty-second and sixty-fourth notes
+		Trill trill;
+		trill.fret = reader.readSignedByte();
+		trill.duration = static_cast<uint8_t>(Duration::Eighth << checkRange(reader.readSignedByte(), 0, 4, reader));
+		return trill;
+	}
+
+	// Records where each measure block starts and, as mix table changes are
+	// passed over, resolves the tempo of every measure header
+	template<Gp5Reader::Format F>
+	MeasureIndex Gp5Reader::scanMeasures(Song& song, StreamReader& reader) const
+	{
+		MeasureIndex index;
+		index.numTracks = song.tracks.size();
+		index.offsets.reserve(song.measureHeaders.size() * song.tracks.size() + 1);
+
+		auto tempo = song.tempo.value;
+		for (auto& header : song.measureHeaders) {
+			header.tempo = tempo;
+
+			for (auto& track : song.tracks) {
+				index.offsets.push_back(reader.position());
+				skipMeasure<F>(header, track.strings.size(), reader);
+				if (reader.failed()) {
+					return index;
+				}
+			}
+
+			tempo = header.tempo;
+		}
+
+		index.offsets.push_back(reader.position());
+		return index;
+	}
+
+	// The skip functions below mirror the read functions above byte for byte,
+	// without building any of the model
+	template<Gp5Reader::Format F>
+	void Gp5Reader::skipMeasure(MeasureHeader& header, size_t numStrings, StreamReader& reader) const
+	{
+		if constexpr (F < Format::Gp500) {
+			skipVoice<F>(header, numStrings, reader);
+			return;
+		}
+
+		for (auto i = 0; i < Measure::MaxVoices; ++i) {
+			skipVoice<F>(header, numStrings, reader);
+		}
+
+		if (!reader.atEnd()) {
+			reader.skip(1);
+		}
+	}
+
+	template<Gp5Reader::Format F>
+	void Gp5Reader::skipVoice(MeasureHeader& header, size_t numStrings, StreamReader& reader) const
+	{
+		auto numBeats = reader.readUnsignedInt();
+		for (uint32_t i = 0; i < numBeats && !reader.failed(); ++i) {
+			skipBeat<F>(header, numStrings, reader);
+		}
+	}
+
+	template<Gp5Reader::Format F>
+	void Gp5Reader::skipBeat(MeasureHeader& header, size_t numStrings, StreamReader& reader) const
+	{
+		auto flags = reader.readUnsignedByte();
+
+		if (flags & 0x40) {
+			reader.skip(1);
+		}
+
+		reader.skip(flags & 0x20 ? 5 : 1);
+
+		if (flags & 0x02) {
+			skipChord<F>(reader);
+		}
+
+		if (flags & 0x04) {
+			reader.skipIntByteSizedString();
+		}
+
+		if (flags & 0x08) {
+			skipBeatEffect<F>(reader);
+		}
+
+		if (flags & 0x10) {
+			auto tempo = skipMixTableChange<F>(reader);
+			if (tempo >= 0) {
+				header.tempo = tempo;
+			}
+		}
+
+		// String n is flagged by bit 7 - n
+		auto stringFlags = reader.readUnsignedByte();
+		for (size_t string = 1; string <= numStrings; ++string) {
+			if (stringFlags & (1 << (7 - string))) {
+				skipNote<F>(reader);
+			}
+		}
+
+		if constexpr (F < Format::Gp500) {
+			return;
+		}
+
+		auto flags2 = reader.readUnsignedShort();
+		if (flags2 & 0x0800) {
+			reader.skip(1);
+		}
+	}
+
+	template<Gp5Reader::Format F>
+	void Gp5Reader::skipChord(StreamReader& reader) const
+	{
+		if (reader.readBoolean()) {
+			// Everything after the format flag has a fixed size in the new format
+			reader.skip(F == Format::Gp3 ? 124 : 106);
+			return;
+		}
+
+		reader.skipIntByteSizedString();
+		if (reader.readUnsignedInt()) {
+			reader.skip(6 * 4);
+		}
+	}
+
+	template<Gp5Reader::Format F>
+	void Gp5Reader::skipBeatEffect(StreamReader& reader) const
+	{
+		auto flags1 = reader.readUnsignedByte();
+
+		if constexpr (F == Format::Gp3) {
+			// A slap effect or tremolo bar type, then an int
+			if (flags1 & 0x20) {
+				reader.skip(5);
+			}
+
+			if (flags1 & 0x40) {
+				reader.skip(2);
+			}
+
+			return;
+		}
+
+		auto flags2 = reader.readUnsignedByte();
+
+		if (flags1 & 0x20) {
+			reader.skip(1);
+		}
+
+		if (flags2 & 0x04) {
+			skipBend(reader);
+		}
+
+		if (flags1 & 0x40) {
+			reader.skip(2);
+		}
+
+		if (flags2 & 0x02) {
+			reader.skip(1);
+		}
+	}
+
+	void Gp5Reader::skipBend(StreamReader& reader) const
+	{
+		reader.skip(5);
+		auto numPoints = reader.readUnsignedInt();
+		for (uint32_t i = 0; i < numPoints && !reader.failed(); ++i) {
+			reader.skip(9);
+		}
+	}
+
+	// Returns the new tempo, or -1 if the change leaves it as it is
+	template<Gp5Reader::Format F>
+	int32_t Gp5Reader::skipMixTableChange(StreamReader& reader) const
+	{
+		// Instrument, then the RSE instrument, whose effect number is a short and
+		// a padding byte in 5.00, followed in 5.00 by another unknown byte
+		reader.skip(1);
+		if constexpr (F == Format::Gp500) {
+			reader.skip(15 + 1);
+		} else if constexpr (F == Format::Gp510) {
+			reader.skip(16);
+		}
+
+		auto numItems = 0;
+		for (auto i = 0; i < 6; ++i) {
+			if (reader.readSignedByte() >= 0) {
+				++numItems;
+			}
+		}
+
+		if constexpr (F >= Format::Gp500) {
+			reader.skipIntByteSizedString();
+		}
+
+		auto tempo = reader.readSignedInt();
+		reader.skip(numItems);
+
+		if (tempo >= 0) {
+			reader.skip(F == Format::Gp510 ? 2 : 1);
+		}
+
+		// The flags, then the wah
+		if constexpr (F >= Format::Gp4) {
+			reader.skip(1);
+		}
+
+		if constexpr (F >= Format::Gp500) {
+			reader.skip(1);
+		}
+
+		if constexpr (F == Format::Gp510) {
+			reader.skipIntByteSizedString();
+			reader.skipIntByteSizedString();
+		}
+
+		return tempo;
+	}
+
+	template<Gp5Reader::Format F>
+	void Gp5Reader::skipNote(StreamReader& reader) const
+	{
+		auto flags = reader.readUnsignedByte();
+
+		if (flags & 0x20) {
+			reader.skip(1);
+		}
+
+		if (F < Format::Gp500 && (flags & 0x01)) {
+			reader.skip(2);
+		}
+
+		if (flags & 0x10) {
+			reader.skip(1);
+		}
+
+		if (flags & 0x20) {
+			reader.skip(1);
+		}
+
+		if (flags & 0x80) {
+			reader.skip(2);
+		}
+
+		if constexpr (F >= Format::Gp500) {
+			reader.skip(flags & 0x01 ? 8 + 1 : 1);
+		}
+
+		if (flags & 0x08) {
+			skipNoteEffect<F>(reader);
+		}
+	}
+
+	template<Gp5Reader::Format F>
+	void Gp5Reader::skipNoteEffect(StreamReader& reader) const
+	{
+		auto flags1 = reader.readUnsignedByte();
+		auto flags2 = F >= Format::Gp4 ? reader.readUnsignedByte() : 0;
+
+		if (flags1 & 0x01) {
+			skipBend(reader);
+		}
+
+		if (flags1 & 0x10) {
+			reader.skip(F >= Format::Gp500 ? 5 : 4);
+		}
+
+		if (flags2 & 0x04) {
+			reader.skip(1);
+		}
+
+		if (flags2 & 0x08) {
+			reader.skip(1);
+		}
+
+		// GP4 stores nothing beyond the type of a harmonic
+		if (flags2 & 0x10) {
+			auto type = static_cast<HarmonicType>(reader.readSignedByte());
+			if (F >= Format::Gp500 && type == HarmonicType::Artificial) {
+				reader.skip(3);
+			} else if (F >= Format::Gp500 && type == HarmonicType::Tapped) {
+				reader.skip(1);
+			}
+		}
+
+		if (flags2 & 0x20) {
+			reader.skip(2);
+		}
+	}
+
+	// The parts of the decoder Gp5PushReader runs one at a time, for the
+	// versions it reads
+	template TripletFeel Gp5Reader::readSongHeader<Gp5Reader::Format::Gp500>(SongInfo&, StreamReader&) const;
+	template TripletFeel Gp5Reader::readSongHeader<Gp5Reader::Format::Gp510>(SongInfo&, StreamReader&) const;
+	template MeasureHeader Gp5Reader::readMeasureHeader<Gp5Reader::Format::Gp500>(uint32_t, Song&, std::optional<MeasureHeader>, StreamReader&) const;
+	template MeasureHeader Gp5Reader::readMeasureHeader<Gp5Reader::Format::Gp510>(uint32_t, Song&, std::optional<MeasureHeader>, StreamReader&) const;
+	template Track Gp5Reader::readTrack<Gp5Reader::Format::Gp500>(uint32_t, const std::vector<MidiChannel>&, StreamReader&) const;
+	template Track Gp5Reader::readTrack<Gp5Reader::Format::Gp510>(uint32_t, const std::vector<MidiChannel>&, StreamReader&) const;
+	template void Gp5Reader::skipTrackPadding<Gp5Reader::Format::Gp500>(StreamReader&) const;
+	template void Gp5Reader::skipTrackPadding<Gp5Reader::Format::Gp510>(StreamReader&) const;
+	template void Gp5Reader::readMeasure<Gp5Reader::Format::Gp500>(Measure&, StreamReader&) const;
+	template void Gp5Reader::readMeasure<Gp5Reader::Format::Gp510>(Measure&, StreamReader&) const;
+	template void Gp5Reader::skipMeasure<Gp5Reader::Format::Gp500>(MeasureHeader&, size_t, StreamReader&) const;
+	template void Gp5Reader::skipMeasure<Gp5Reader::Format::Gp510>(MeasureHeader&, size_t, StreamReader&) const;
+}
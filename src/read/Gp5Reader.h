@@ -1,11 +1,14 @@
 #pragma once
 
 #include "GpReaderBase.h"
+#include "MeasureIndex.h"
+#include "../Arena.h"
 #include <vector>
 #include <map>
-#include <string>
+#include <string_view>
 #include <cstdint>
 #include <optional>
+#include <set>
 #include <tuple>
 
 namespace libgp
@@ -24,43 +27,161 @@ namespace libgp
 	struct Measure;
 	struct Voice;
 	struct Beat;
+	struct BeatEffect;
+	struct BeatStroke;
+	struct Bend;
+	struct MixTableChange;
 	struct Duration;
 	struct Chord;
+	struct Note;
+	struct NoteEffect;
+	struct Grace;
+	struct Harmonic;
+	struct TremoloPicking;
+	struct Trill;
+	struct GuitarString;
+	enum class SlideType : int8_t;
+	enum class TripletFeel : uint8_t;
+	class SongStorage;
+	class ThreadPool;
 
+	// Reads Guitar Pro 5 (.gp5) files. The earlier versions lay out the same
+	// song with fewer fields, so Gp3Reader and Gp4Reader decode with this class
+	// and only differ in the versions they accept.
 	class Gp5Reader : private GpReaderBase
 	{
 	public:
 		Gp5Reader();
 
-		std::unique_ptr<Song> readSong(std::istream& stream) override;
+		using GpReaderBase::readSong;
+		using GpReaderBase::readSongFromFile;
+		using GpReaderBase::tryReadSong;
+		using GpReaderBase::tryReadSongFromFile;
+		using GpReaderBase::salvageSong;
+		using GpReaderBase::salvageSongFromFile;
+		using GpReaderBase::readHeader;
+		using GpReaderBase::readHeaderFromFile;
+		using GpReaderBase::readHeaderView;
+		using GpReaderBase::readHeaderViewFromFile;
+		using GpReaderBase::readLazySong;
+		using GpReaderBase::readLazySongFromFile;
+		using GpReaderBase::version;
+		using GpReaderBase::options;
+		using GpReaderBase::setOptions;
+		using GpReaderBase::parseObserver;
+		using GpReaderBase::setParseObserver;
+
+		// When set, readSong decodes the measures of each track as a separate task
+		// on the pool, after a skip-scan has found where every block starts
+		ThreadPool* threadPool() const noexcept;
+		void setThreadPool(ThreadPool* pool) noexcept;
+
+		// Runs the skip-scan on its own, for callers that want to find or slice
+		// out measure blocks without decoding them
+		MeasureIndex indexMeasures(const std::byte* data, size_t size);
+
+	protected:
+		explicit Gp5Reader(std::set<GpVersion> supportedVersions);
+
+		std::unique_ptr<Song> readSong(StreamReader& reader) override;
+		ParseResult<std::unique_ptr<Song>> tryReadSong(StreamReader& reader) override;
+		SongInfo readHeader(StreamReader& reader) override;
+		SongInfoView readHeaderView(StreamReader& reader) override;
+		std::unique_ptr<LazySong> readLazySong(StreamReader& reader) override;
+		SalvagedSong salvageSong(StreamReader& reader) override;
 
 	private:
-		using DirectionSigns = std::map<std::string, int16_t>;
+		friend class ReaderRegistry;
+		// Runs the decoder one part of the file at a time as its bytes arrive
+		friend class Gp5PushReader;
+
+		// The layouts the decoder tells apart, in the order the versions came out.
+		// The functions that depend on the layout are instantiated for each one.
+		enum class Format : uint8_t
+		{
+			Gp3 = 0,
+			Gp4 = 1,
+			Gp500 = 2,
+			Gp510 = 3
+		};
 
-		void readSongInfo(Song& song, StreamReader& reader) const;
+		// The fewest bytes each kind of object counted in the file takes up, so
+		// that a count can reserve no more room than the bytes left could fill.
+		// A measure header can be a single byte of flags.
+		static constexpr size_t MinCommentSize = 5;
+		static constexpr size_t MinTrackSize = 98;
+		static constexpr size_t MinBeatSize = 3;
+		static constexpr size_t MinBendPointSize = 9;
+
+		Format format_;
+
+		using DirectionSigns = std::map<std::string_view, int16_t>;
+
+		void readFormat(StreamReader& reader);
+		template<typename Function> auto withFormat(Function&& function) const;
+		template<Format F> std::unique_ptr<Song> readOutline(StreamReader& reader);
+		template<Format F> void readOutline(Song& song, StreamReader& reader) const;
+		std::unique_ptr<Song> createSong() const;
+		template<Format F> TripletFeel readSongHeader(SongInfo& info, StreamReader& reader) const;
+		template<Format F, typename Info> void readSongInfo(Info& info, StreamReader& reader) const;
 		Lyrics readLyrics(StreamReader& reader) const;
 		PageSetup readPageSetup(StreamReader& reader) const;
-		Tempo readTempo(StreamReader& reader) const;
+		template<Format F> Tempo readTempo(StreamReader& reader) const;
 		std::vector<MidiChannel> readMidiChannels(StreamReader& reader) const;
 		std::tuple<DirectionSigns, DirectionSigns> readDirectionSigns(StreamReader& reader) const;
-		void readMeasureHeaders(uint32_t numMeasures, Song& song, std::tuple<DirectionSigns, DirectionSigns> directionSigns, StreamReader& reader) const;
-		MeasureHeader readMeasureHeader(uint32_t number, Song& song, std::optional<MeasureHeader> previous, StreamReader& reader) const;
+		template<Format F> void readMeasureHeaders(uint32_t numMeasures, Song& song, const std::tuple<DirectionSigns, DirectionSigns>& directionSigns, TripletFeel tripletFeel, StreamReader& reader) const;
+		void applyDirectionSigns(Song& song, const std::tuple<DirectionSigns, DirectionSigns>& directionSigns, StreamReader& reader) const;
+		template<Format F> MeasureHeader readMeasureHeader(uint32_t number, Song& song, std::optional<MeasureHeader> previous, StreamReader& reader) const;
+		uint8_t readRepeatAlternative(const Song& song, StreamReader& reader) const;
 		Marker readMarker(StreamReader& reader) const;
 		Color readColor(StreamReader& reader) const;
-		void readTracks(uint32_t numTracks, Song& song, std::vector<MidiChannel> midiChannels, StreamReader& reader) const;
-		Track readTrack(uint32_t number, std::vector<MidiChannel> midiChannels, StreamReader& reader) const;
-		std::optional<MidiChannel> readMidiChannel(std::vector<MidiChannel> midiChannels, StreamReader& reader) const;
-		void readTrackRSE(TrackRSE& rse, StreamReader& reader) const;
-		RSEInstrument readRSEInstrument(StreamReader& reader) const;
+		template<Format F> void readTracks(uint32_t numTracks, Song& song, const std::vector<MidiChannel>& midiChannels, StreamReader& reader) const;
+		template<Format F> Track readTrack(uint32_t number, const std::vector<MidiChannel>& midiChannels, StreamReader& reader) const;
+		template<Format F> void skipTrackPadding(StreamReader& reader) const;
+		std::optional<MidiChannel> readMidiChannel(const std::vector<MidiChannel>& midiChannels, StreamReader& reader) const;
+		template<Format F> void readTrackRSE(TrackRSE& rse, StreamReader& reader) const;
+		template<Format F> RSEInstrument readRSEInstrument(StreamReader& reader) const;
 		RSEEqualizer readRSEEqualizer(uint8_t numKnobs, StreamReader& reader) const;
-		void readMeasures(Song& song, StreamReader& reader) const;
-		void readMeasure(Measure& measure, StreamReader& reader) const;
-		void readVoice(uint32_t start, Voice& voice, StreamReader& reader) const;
-		uint32_t readBeat(uint32_t start, Voice& voice, StreamReader& reader) const;
+		template<Format F> void readMeasures(Song& song, StreamReader& reader) const;
+		template<Format F> void readMeasuresByTrack(Song& song, StreamReader& reader) const;
+		template<Format F> ParseError readTrackMeasures(Song& song, size_t trackIndex, const MeasureIndex& index, const std::byte* data) const;
+		void layoutMeasures(Song& song) const;
+		void dropPartialMeasures(Song& song) const;
+		void resolveTempos(Song& song) const;
+		template<Format F> void readMeasure(Measure& measure, StreamReader& reader) const;
+		template<Format F> void readVoice(uint32_t start, Voice& voice, StreamReader& reader) const;
+		template<Format F> uint32_t readBeat(uint32_t start, Voice& voice, StreamReader& reader) const;
 		Beat& getBeat(Voice& voice, uint32_t start) const;
 		Duration readDuration(uint8_t flags, StreamReader& reader) const;
-		Chord readChord(size_t numStrings, StreamReader& reader) const;
+		template<Format F> Chord readChord(size_t numStrings, StreamReader& reader) const;
 		void readOldChord(Chord& chord, StreamReader& reader) const;
 		void readNewChord(Chord& chord, StreamReader& reader) const;
+		void readNewGp3Chord(Chord& chord, StreamReader& reader) const;
+		template<Format F> void readBeatEffect(BeatEffect& effect, StreamReader& reader) const;
+		template<Format F> std::optional<Harmonic> readGp3BeatEffect(BeatEffect& effect, StreamReader& reader) const;
+		template<Format F> BeatStroke readBeatStroke(StreamReader& reader) const;
+		Bend readBend(StreamReader& reader) const;
+		Bend readGp3TremoloBar(StreamReader& reader) const;
+		template<Format F> MixTableChange readMixTableChange(StreamReader& reader) const;
+		template<Format F> void readNotes(Voice& voice, Beat& beat, StreamReader& reader) const;
+		template<Format F> void readNote(Note& note, const GuitarString& string, const Voice& voice, const Beat& beat, StreamReader& reader) const;
+		int32_t getTiedNoteValue(uint8_t string, const Voice& voice, const Beat& beat) const;
+		template<Format F> void readNoteEffect(NoteEffect& effect, StreamReader& reader) const;
+		template<Format F> Grace readGrace(StreamReader& reader) const;
+		template<Format F> ArenaVector<SlideType> readSlides(StreamReader& reader) const;
+		template<Format F> Harmonic readHarmonic(StreamReader& reader) const;
+		TremoloPicking readTremoloPicking(StreamReader& reader) const;
+		Trill readTrill(StreamReader& reader) const;
+
+		template<Format F> MeasureIndex scanMeasures(Song& song, StreamReader& reader) const;
+		template<Format F> void skipMeasure(MeasureHeader& header, size_t numStrings, StreamReader& reader) const;
+		template<Format F> void skipVoice(MeasureHeader& header, size_t numStrings, StreamReader& reader) const;
+		template<Format F> void skipBeat(MeasureHeader& header, size_t numStrings, StreamReader& reader) const;
+		template<Format F> void skipChord(StreamReader& reader) const;
+		template<Format F> void skipBeatEffect(StreamReader& reader) const;
+		void skipBend(StreamReader& reader) const;
+		template<Format F> int32_t skipMixTableChange(StreamReader& reader) const;
+		template<Format F> void skipNote(StreamReader& reader) const;
+		template<Format F> void skipNoteEffect(StreamReader& reader) const;
 	};
-}
\ No newline at end of file
+}
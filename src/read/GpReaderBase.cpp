@@ -1,58 +1,311 @@
 #include "GpReaderBase.h"
 #include "StreamReader.h"
 #include "GpReaderError.h"
+#include "MappedFile.h"
+#include "LazySong.h"
 #include "Model.h"
 #include <cstdint>
 #include <string>
 #include <algorithm>
 #include <limits>
 #include <cmath>
+#include <vector>
 
 namespace libgp
 {
+	namespace
+	{
+		// A retained source can be shared by whatever needs to point into it after
+		// the read returns
+		template<typename Read>
+		auto readBuffer(const std::byte* data, size_t size, bool retainSource, Read read)
+		{
+			if (retainSource) {
+				// The caller owns the buffer, so the song needs its own copy to point into
+				auto buffer = std::make_shared<const std::vector<std::byte>>(data, data + size);
+				StreamReader reader(buffer->data(), buffer->size(), buffer);
+				return read(reader);
+			}
+
+			StreamReader reader(data, size);
+			return read(reader);
+		}
+
+		template<typename Read>
+		auto readFile(const std::string& path, bool retainSource, Read read)
+		{
+			if (retainSource) {
+				// The song points into the mapping, so the song keeps it alive
+				auto file = std::make_shared<const MappedFile>(path);
+				StreamReader reader(file->data(), file->size(), file);
+				return read(reader);
+			}
+
+			// Otherwise the mapping only has to live for the duration of the parse
+			MappedFile file(path);
+			StreamReader reader(file.data(), file.size());
+			return read(reader);
+		}
+	}
+
 	GpReaderBase::GpReaderBase(std::set<GpVersion> supportedVersions) :
-		supportedVersions_(supportedVersions)
+		supportedVersions_(supportedVersions),
+		phase_(ParsePhase::Version)
+	{
+	}
+
+	// Catches what fails before the reader gets to decoding, such as a file
+	// that cannot be opened, and the errors of decoders that throw. The phase is
+	// added here, where it is known.
+	template<typename Read>
+	auto GpReaderBase::tryRead(Read read)
 	{
+		using Result = decltype(read());
+
+		phase_ = ParsePhase::Version;
+		try {
+			return read();
+		} catch (const GpReaderError& e) {
+			auto error = e.error();
+			error.phase = phase();
+			return Result(error);
+		}
+	}
+
+	// Catches what fails before the reader gets to decoding, such as a file
+	// that cannot be opened
+	template<typename Read>
+	SalvagedSong GpReaderBase::salvage(Read read)
+	{
+		phase_ = ParsePhase::Version;
+		try {
+			return read();
+		} catch (const GpReaderError& e) {
+			SalvagedSong result;
+			result.error = e.error();
+			result.error->phase = phase();
+			return result;
+		}
 	}
 
 	GpReaderBase::~GpReaderBase() = default;
 
 	GpVersion GpReaderBase::version() const noexcept { return version_; }
 
+	const ReaderOptions& GpReaderBase::options() const noexcept { return options_; }
+
+	void GpReaderBase::setOptions(const ReaderOptions& options) noexcept { options_ = options; }
+
+	ParseObserver* GpReaderBase::parseObserver() const noexcept { return options_.parseObserver; }
+
+	void GpReaderBase::setParseObserver(ParseObserver* observer) noexcept { options_.parseObserver = observer; }
+
+	std::unique_ptr<Song> GpReaderBase::readSong(std::istream& stream)
+	{
+		StreamReader reader(stream);
+		return readSong(reader);
+	}
+
+	std::unique_ptr<Song> GpReaderBase::readSong(const std::byte* data, size_t size)
+	{
+		return readBuffer(data, size, false, [this](StreamReader& reader) { return readSong(reader); });
+	}
+
+	std::unique_ptr<Song> GpReaderBase::readSongFromFile(const std::string& path)
+	{
+		return readFile(path, false, [this](StreamReader& reader) { return readSong(reader); });
+	}
+
+	ParseResult<std::unique_ptr<Song>> GpReaderBase::tryReadSong(std::istream& stream)
+	{
+		return tryRead([&] {
+			StreamReader reader(stream);
+			return tryReadSong(reader);
+		});
+	}
+
+	ParseResult<std::unique_ptr<Song>> GpReaderBase::tryReadSong(const std::byte* data, size_t size)
+	{
+		return tryRead([&] {
+			return readBuffer(data, size, false, [this](StreamReader& reader) { return tryReadSong(reader); });
+		});
+	}
+
+	ParseResult<std::unique_ptr<Song>> GpReaderBase::tryReadSongFromFile(const std::string& path)
+	{
+		return tryRead([&] {
+			return readFile(path, false, [this](StreamReader& reader) { return tryReadSong(reader); });
+		});
+	}
+
+	SalvagedSong GpReaderBase::salvageSong(std::istream& stream)
+	{
+		return salvage([&] {
+			StreamReader reader(stream);
+			return salvageSong(reader);
+		});
+	}
+
+	SalvagedSong GpReaderBase::salvageSong(const std::byte* data, size_t size)
+	{
+		return salvage([&] {
+			return readBuffer(data, size, false, [this](StreamReader& reader) { return salvageSong(reader); });
+		});
+	}
+
+	SalvagedSong GpReaderBase::salvageSongFromFile(const std::string& path)
+	{
+		return salvage([&] {
+			return readFile(path, false, [this](StreamReader& reader) { return salvageSong(reader); });
+		});
+	}
+
+	SongInfo GpReaderBase::readHeader(std::istream& stream)
+	{
+		StreamReader reader(stream);
+		return readHeader(reader);
+	}
+
+	SongInfo GpReaderBase::readHeader(const std::byte* data, size_t size)
+	{
+		return readBuffer(data, size, false, [this](StreamReader& reader) { return readHeader(reader); });
+	}
+
+	SongInfo GpReaderBase::readHeaderFromFile(const std::string& path)
+	{
+		return readFile(path, false, [this](StreamReader& reader) { return readHeader(reader); });
+	}
+
+	SongInfoView GpReaderBase::readHeaderView(std::istream& stream)
+	{
+		StreamReader reader(stream);
+		return readHeaderView(reader);
+	}
+
+	SongInfoView GpReaderBase::readHeaderView(const std::byte* data, size_t size)
+	{
+		return readBuffer(data, size, true, [this](StreamReader& reader) { return readHeaderView(reader); });
+	}
+
+	SongInfoView GpReaderBase::readHeaderViewFromFile(const std::string& path)
+	{
+		return readFile(path, true, [this](StreamReader& reader) { return readHeaderView(reader); });
+	}
+
+	std::unique_ptr<LazySong> GpReaderBase::readLazySong(std::istream& stream)
+	{
+		StreamReader reader(stream);
+		return readLazySong(reader);
+	}
+
+	std::unique_ptr<LazySong> GpReaderBase::readLazySong(const std::byte* data, size_t size)
+	{
+		return readBuffer(data, size, true, [this](StreamReader& reader) { return readLazySong(reader); });
+	}
+
+	std::unique_ptr<LazySong> GpReaderBase::readLazySongFromFile(const std::string& path)
+	{
+		return readFile(path, true, [this](StreamReader& reader) { return readLazySong(reader); });
+	}
+
+	std::unique_ptr<LazySong> GpReaderBase::readLazySong(StreamReader& reader)
+	{
+		return std::make_unique<LazySong>(readSong(reader), [](Song&, size_t) {});
+	}
+
+	SongInfoView GpReaderBase::readHeaderView(StreamReader& reader)
+	{
+		auto info = std::make_shared<const SongInfo>(readHeader(reader));
+
+		SongInfoView view;
+		view.title = info->title;
+		view.subtitle = info->subtitle;
+		view.artist = info->artist;
+		view.album = info->album;
+		view.lyricsWriter = info->lyricsWriter;
+		view.musicWriter = info->musicWriter;
+		view.copyright = info->copyright;
+		view.tabAuthor = info->tabAuthor;
+		view.instructions = info->instructions;
+		view.comments.assign(info->comments.begin(), info->comments.end());
+		view.source = std::move(info);
+
+		return view;
+	}
+
+	ParseResult<std::unique_ptr<Song>> GpReaderBase::tryReadSong(StreamReader& reader)
+	{
+		return readSong(reader);
+	}
+
+	SalvagedSong GpReaderBase::salvageSong(StreamReader& reader)
+	{
+		SalvagedSong result;
+		try {
+			result.song = readSong(reader);
+		} catch (const GpReaderError& e) {
+			result.error = e.error();
+			result.error->phase = phase();
+		}
+
+		return result;
+	}
+
 	void GpReaderBase::readAndValidateVersion(StreamReader& reader)
 	{
-		auto version = readVersion(reader);
-		
+		observePhase(ParsePhase::Version, reader, [&] {
+			auto version = readVersion(reader);
+			if (!version) {
+				reader.fail(ParseErrorCode::InvalidVersion, 0);
+			} else if (supportedVersions_.find(*version) == supportedVersions_.end()) {
+				reader.fail(ParseErrorCode::UnsupportedVersion, 0);
+			} else {
+				version_ = *version;
+			}
+		});
+	}
+
+	void GpReaderBase::validateVersion(const GpVersion& version)
+	{
 		if (supportedVersions_.find(version) == supportedVersions_.end()) {
-			throw GpReaderError("Unsupported version: " + version.full());
+			throw GpReaderError("Unsupported version: " + version.full(), ParseErrorCode::UnsupportedVersion);
 		}
 
 		version_ = version;
 	}
 
-	GpVersion GpReaderBase::readVersion(StreamReader& reader) const
+	ParseError GpReaderBase::readError(const StreamReader& reader) const noexcept
+	{
+		auto error = reader.error();
+		error.phase = phase();
+		return error;
+	}
+
+	ParsePhase GpReaderBase::phase() const noexcept { return phase_; }
+
+	std::optional<GpVersion> GpReaderBase::readVersion(StreamReader& reader) const
 	{
 		// There are always 30 bytes allocated to the version string, but the first
 		// byte of the file holds the actual string length
 		auto size = reader.readUnsignedByte() & 0xFF;
 		auto strLen = size >= 0 && size <= 30 ? size : 30;
 
-		auto version = reader.readString(30);
-		version.resize(strLen);
-
-		try {
-			return GpVersion::parse(version);
-		} catch (const std::exception e) {
-			throw GpReaderError("Unable to read version");
-		}
+		return GpVersion::tryParse(std::string(reader.readString(30).substr(0, strLen)));
 	}
 
 	int16_t GpReaderBase::byteToChannelShort(int8_t byte) const noexcept
 	{
 		auto shortMax = std::numeric_limits<int16_t>::max();
 		auto shortMin = std::numeric_limits<int16_t>::min();
-		auto shifted = static_cast<int16_t>((byte << 3) - 1);
+		auto shifted = static_cast<int16_t>(byte * 8 - 1);
 		auto value = std::max(shortMin, std::min(shortMax, shifted));
 		return std::max(value, (int16_t)-1) + 1;
 	}
+
+	uint8_t GpReaderBase::unpackVelocity(int8_t dynamic) const noexcept
+	{
+		const int MinVelocity = 15;
+		const int VelocityIncrement = 16;
+		return static_cast<uint8_t>(MinVelocity + VelocityIncrement * dynamic - VelocityIncrement);
+	}
 }
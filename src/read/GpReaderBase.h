@@ -1,15 +1,38 @@
 #pragma once
 
 #include "../GpVersion.h"
+#include "ParseObserver.h"
+#include "ParseResult.h"
 #include "StreamReader.h"
+#include <chrono>
+#include <cstddef>
 #include <string>
 #include <istream>
 #include <memory>
+#include <optional>
 #include <set>
+#include <type_traits>
+#include <utility>
 
 namespace libgp
 {
+	struct SongInfo;
+	struct SongInfoView;
 	struct Song;
+	class LazySong;
+	class ThreadPool;
+
+	// The settings a reader applies to every read. ReaderRegistry hands them on
+	// to the reader it picks for each source.
+	struct ReaderOptions
+	{
+		// When set, the phases of every parse are timed and reported to the
+		// observer, which has to outlive the reads
+		ParseObserver* parseObserver = nullptr;
+		// When set, readers that can decode the measures of each track on their
+		// own do so as separate tasks on the pool; the others read as without
+		ThreadPool* threadPool = nullptr;
+	};
 
 	class GpReaderBase
 	{
@@ -19,16 +42,126 @@ namespace libgp
 
 		GpVersion version() const noexcept;
 
-		virtual std::unique_ptr<Song> readSong(std::istream& stream) = 0;
+		const ReaderOptions& options() const noexcept;
+		void setOptions(const ReaderOptions& options) noexcept;
+
+		ParseObserver* parseObserver() const noexcept;
+		void setParseObserver(ParseObserver* observer) noexcept;
+
+		std::unique_ptr<Song> readSong(std::istream& stream);
+		std::unique_ptr<Song> readSong(const std::byte* data, size_t size);
+		std::unique_ptr<Song> readSongFromFile(const std::string& path);
+
+		// Report a source that cannot be read as an error code, the offset of
+		// the read that failed and the phase it failed in, rather than by
+		// throwing. Errors other than those of the source, such as running out
+		// of memory, are still thrown.
+		ParseResult<std::unique_ptr<Song>> tryReadSong(std::istream& stream);
+		ParseResult<std::unique_ptr<Song>> tryReadSong(const std::byte* data, size_t size);
+		ParseResult<std::unique_ptr<Song>> tryReadSongFromFile(const std::string& path);
+
+		// Read what they can of a source that is cut off or corrupt, keeping the
+		// measure headers, tracks and measures decoded before the error. Formats
+		// that cannot keep part of a song return one only if it is read whole.
+		SalvagedSong salvageSong(std::istream& stream);
+		SalvagedSong salvageSong(const std::byte* data, size_t size);
+		SalvagedSong salvageSongFromFile(const std::string& path);
+
+		// Reads only the song header, stopping before any track or measure data
+		SongInfo readHeader(std::istream& stream);
+		SongInfo readHeader(const std::byte* data, size_t size);
+		SongInfo readHeaderFromFile(const std::string& path);
+
+		// Reads the text of the song header without copying it. A stream is read
+		// to its end first, as the views have to stay put; formats whose text has
+		// to be decoded point the views into a decoded copy instead.
+		SongInfoView readHeaderView(std::istream& stream);
+		SongInfoView readHeaderView(const std::byte* data, size_t size);
+		SongInfoView readHeaderViewFromFile(const std::string& path);
+
+		// Reads everything but the measures, which each track decodes from the
+		// retained source the first time it is asked for. Formats that cannot
+		// decode tracks on their own read the whole song up front.
+		std::unique_ptr<LazySong> readLazySong(std::istream& stream);
+		std::unique_ptr<LazySong> readLazySong(const std::byte* data, size_t size);
+		std::unique_ptr<LazySong> readLazySongFromFile(const std::string& path);
 
 	protected:
+		virtual std::unique_ptr<Song> readSong(StreamReader& reader) = 0;
+		// Readers whose decoder stops at the first failed read rather than throw
+		// override this; by default it calls readSong
+		virtual ParseResult<std::unique_ptr<Song>> tryReadSong(StreamReader& reader);
+		virtual SongInfo readHeader(StreamReader& reader) = 0;
+		virtual SongInfoView readHeaderView(StreamReader& reader);
+		virtual std::unique_ptr<LazySong> readLazySong(StreamReader& reader);
+		virtual SalvagedSong salvageSong(StreamReader& reader);
+
+		// Fails the reader for a version that cannot be parsed or is not supported
 		void readAndValidateVersion(StreamReader& reader);
+		// For formats that do not start with a version string
+		void validateVersion(const GpVersion& version);
+		// The error the reader failed with, in the phase the read got to
+		ParseError readError(const StreamReader& reader) const noexcept;
+		// The phase the last read got to, which is where it failed if it did
+		virtual ParsePhase phase() const noexcept;
+		// Marks the phase a parse is in, runs it and reports it to the observer,
+		// if there is one. The count function fills in the objects the phase
+		// decoded, and is only called when there is an observer.
+		template<typename Read, typename Count>
+		auto observePhase(ParsePhase phase, StreamReader& reader, Read&& read, Count&& count) const;
+		template<typename Read>
+		auto observePhase(ParsePhase phase, StreamReader& reader, Read&& read) const;
+
 		int16_t byteToChannelShort(int8_t byte) const noexcept;
+		uint8_t unpackVelocity(int8_t dynamic) const noexcept;
 
 	private:
+		// Dispatches to the protected entry points of the reader it picks
+		friend class ReaderRegistry;
+
 		GpVersion version_;
 		std::set<GpVersion> supportedVersions_;
+		ReaderOptions options_;
+		mutable ParsePhase phase_;
 
-		GpVersion readVersion(StreamReader& reader) const;
+		std::optional<GpVersion> readVersion(StreamReader& reader) const;
+		template<typename Read> auto tryRead(Read read);
+		template<typename Read> SalvagedSong salvage(Read read);
 	};
+
+	template<typename Read, typename Count>
+	auto GpReaderBase::observePhase(ParsePhase phase, StreamReader& reader, Read&& read, Count&& count) const
+	{
+		phase_ = phase;
+		if (options_.parseObserver == nullptr) {
+			return read();
+		}
+
+		ParsePhaseStats stats;
+		stats.phase = phase;
+		auto position = reader.position();
+		auto start = std::chrono::steady_clock::now();
+
+		auto report = [&] {
+			stats.duration = std::chrono::steady_clock::now() - start;
+			stats.bytes = reader.position() - position;
+			count(stats);
+			options_.parseObserver->onPhase(stats);
+		};
+
+		if constexpr (std::is_void_v<decltype(read())>) {
+			read();
+			report();
+		} else {
+			auto result = read();
+			report();
+			return result;
+		}
+	}
+
+	template<typename Read>
+	auto GpReaderBase::observePhase(ParsePhase phase, StreamReader& reader, Read&& read) const
+	{
+		return observePhase(phase, reader, std::forward<Read>(read), [](ParsePhaseStats&) {});
+	}
 }
\ No newline at end of file
@@ -2,13 +2,39 @@
 
 namespace libgp
 {
-	GpReaderError::GpReaderError(const std::string& message) :
+	const char* ParseError::message() const noexcept
+	{
+		switch (code) {
+		case ParseErrorCode::None:
+			return "No error";
+		case ParseErrorCode::UnexpectedEnd:
+			return "Unexpected end of the stream";
+		case ParseErrorCode::InvalidVersion:
+			return "Unable to read version";
+		case ParseErrorCode::UnsupportedVersion:
+			return "Unsupported version";
+		case ParseErrorCode::FileError:
+			return "Unable to read file";
+		default:
+			return "Invalid data";
+		}
+	}
+
+	GpReaderError::GpReaderError(const std::string& message, ParseErrorCode code) :
 		message_(message)
 	{
+		error_.code = code;
 	}
 
-	const char* GpReaderError::what() const
+	GpReaderError::GpReaderError(const ParseError& error) noexcept :
+		error_(error)
 	{
-		return message_.c_str();
 	}
+
+	const char* GpReaderError::what() const noexcept
+	{
+		return !message_.empty() ? message_.c_str() : error_.message();
+	}
+
+	const ParseError& GpReaderError::error() const noexcept { return error_; }
 }
\ No newline at end of file
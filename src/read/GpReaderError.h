@@ -1,17 +1,50 @@
 #pragma once
 
+#include "ParseObserver.h"
+#include <cstddef>
+#include <cstdint>
 #include <exception>
+#include <string>
 
 namespace libgp
 {
+	enum class ParseErrorCode : uint8_t
+	{
+		None = 0,
+		// The source ends before the song does
+		UnexpectedEnd = 1,
+		InvalidVersion = 2,
+		UnsupportedVersion = 3,
+		// Values that cannot be part of a song, or a malformed container
+		InvalidData = 4,
+		// The file could not be opened or mapped
+		FileError = 5
+	};
+
+	// Where and why a read failed. The offset is that of the read that failed,
+	// from the start of the source, and is 0 for errors not tied to a position.
+	struct ParseError
+	{
+		ParseErrorCode code = ParseErrorCode::None;
+		size_t offset = 0;
+		ParsePhase phase = ParsePhase::Version;
+
+		// A description of the code
+		const char* message() const noexcept;
+	};
+
 	class GpReaderError : public std::exception
 	{
 	public:
-		explicit GpReaderError(const std::string& message = "Guitar Pro reader error");
+		explicit GpReaderError(const std::string& message = "Guitar Pro reader error", ParseErrorCode code = ParseErrorCode::InvalidData);
+		// Takes its message from the code, so making one does not allocate
+		explicit GpReaderError(const ParseError& error) noexcept;
 
-		const char* what() const override;
+		const char* what() const noexcept override;
+		const ParseError& error() const noexcept;
 
 	private:
 		std::string message_;
+		ParseError error_;
 	};
 }
\ No newline at end of file
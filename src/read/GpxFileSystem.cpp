@@ -0,0 +1,164 @@
+#include "GpxFileSystem.h"
+#include "BitReader.h"
+#include "GpReaderError.h"
+#include <algorithm>
+#include <cstring>
+
+namespace libgp
+{
+	namespace
+	{
+		const std::string_view CompressedMagic = "BCFZ";
+		const std::string_view UncompressedMagic = "BCFS";
+		const size_t MagicSize = 4;
+
+		// Entries are sector sized: a type, a zero-padded name, the file size and
+		// then the list of sectors
+		const uint32_t FileEntry = 2;
+		const size_t NameOffset = 0x04;
+		const size_t MaxNameSize = 127;
+		const size_t SizeOffset = 0x8C;
+		const size_t SectorsOffset = 0x94;
+
+		// A back reference costs at least 1 + 4 + 2 * 15 bits and copies at most
+		// 2^15 - 1 bytes, which bounds how far a valid block can expand
+		const size_t MaxExpansion = 8192;
+
+		bool hasMagic(const std::byte* data, size_t size, std::string_view magic) noexcept
+		{
+			return size >= MagicSize && std::memcmp(data, magic.data(), MagicSize) == 0;
+		}
+	}
+
+	GpxFileSystem::GpxFileSystem(const std::byte* data, size_t size) :
+		image_(nullptr),
+		imageSize_(0)
+	{
+		if (hasMagic(data, size, CompressedMagic)) {
+			buffer_ = decompress(data + MagicSize, size - MagicSize);
+			data = buffer_.data();
+			size = buffer_.size();
+		}
+
+		if (!hasMagic(data, size, UncompressedMagic)) {
+			throw GpReaderError("Not a Guitar Pro 6 container");
+		}
+
+		image_ = data + MagicSize;
+		imageSize_ = size - MagicSize;
+		indexEntries();
+	}
+
+	bool GpxFileSystem::isContainer(const std::byte* data, size_t size) noexcept
+	{
+		return hasMagic(data, size, CompressedMagic) || hasMagic(data, size, UncompressedMagic);
+	}
+
+	bool GpxFileSystem::contains(std::string_view name) const noexcept { return find(name) != nullptr; }
+
+	std::vector<char> GpxFileSystem::readFile(std::string_view name) const
+	{
+		auto entry = find(name);
+		if (entry == nullptr) {
+			throw GpReaderError("Missing file in the container: " + std::string(name));
+		}
+
+		std::vector<char> file;
+		file.reserve(entry->size);
+
+		auto offset = entry->sectorsOffset;
+		while (file.size() < entry->size) {
+			auto sector = readInt(offset);
+			offset += 4;
+
+			auto position = static_cast<size_t>(sector) * SectorSize;
+			if (sector == 0 || position + SectorSize > imageSize_) {
+				throw GpReaderError("Invalid sector in the container: " + std::string(name));
+			}
+
+			auto chunk = reinterpret_cast<const char*>(image_ + position);
+			file.insert(file.end(), chunk, chunk + std::min<size_t>(SectorSize, entry->size - file.size()));
+		}
+
+		return file;
+	}
+
+	void GpxFileSystem::indexEntries()
+	{
+		// The first sector is the header of the image
+		for (auto offset = SectorSize; offset + SectorSize <= imageSize_; offset += SectorSize) {
+			if (readInt(offset) != FileEntry) {
+				continue;
+			}
+
+			auto name = reinterpret_cast<const char*>(image_ + offset + NameOffset);
+			Entry entry;
+			entry.name = std::string_view(name, std::find(name, name + MaxNameSize, '\0') - name);
+			entry.size = readInt(offset + SizeOffset);
+			entry.sectorsOffset = offset + SectorsOffset;
+			entries_.push_back(entry);
+		}
+	}
+
+	const GpxFileSystem::Entry* GpxFileSystem::find(std::string_view name) const noexcept
+	{
+		auto it = std::find_if(entries_.begin(), entries_.end(), [name](const Entry& entry) { return entry.name == name; });
+		return it != entries_.end() ? &*it : nullptr;
+	}
+
+	uint32_t GpxFileSystem::readInt(size_t offset) const
+	{
+		if (offset + 4 > imageSize_) {
+			throw GpReaderError("An error occurred while reading the container");
+		}
+
+		uint32_t value;
+		std::memcpy(&value, image_ + offset, 4);
+		return value;
+	}
+
+	// BCFZ is an LZ77 variant over a bit stream. Each step is either a back
+	// reference (flag 1, a 4-bit word size, then offset and length of that many
+	// bits) or a run of up to three literal bytes (flag 0, a 2-bit count).
+	std::vector<std::byte> GpxFileSystem::decompress(const std::byte* data, size_t size)
+	{
+		if (size < 4) {
+			throw GpReaderError("An error occurred while reading the container");
+		}
+
+		int32_t expectedSize;
+		std::memcpy(&expectedSize, data, 4);
+		if (expectedSize < 0 || static_cast<size_t>(expectedSize) > size * MaxExpansion) {
+			throw GpReaderError("Invalid size of the compressed container");
+		}
+
+		std::vector<std::byte> output(static_cast<size_t>(expectedSize));
+		auto out = output.data();
+		auto end = out + output.size();
+
+		BitReader bits(data + 4, size - 4);
+		while (out != end) {
+			if (bits.readBit()) {
+				auto wordSize = static_cast<uint8_t>(bits.readBits(4));
+				auto offset = static_cast<size_t>(bits.readBitsReversed(wordSize));
+				auto length = static_cast<size_t>(bits.readBitsReversed(wordSize));
+
+				if (offset > static_cast<size_t>(out - output.data())) {
+					throw GpReaderError("Invalid back reference in the compressed container");
+				}
+
+				// Never copies past the current position, so the ranges cannot overlap
+				length = std::min({ length, offset, static_cast<size_t>(end - out) });
+				std::memcpy(out, out - offset, length);
+				out += length;
+			} else {
+				auto length = std::min<size_t>(bits.readBitsReversed(2), end - out);
+				for (size_t i = 0; i < length; ++i) {
+					*out++ = static_cast<std::byte>(bits.readByte());
+				}
+			}
+		}
+
+		return output;
+	}
+}
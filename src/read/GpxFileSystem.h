@@ -0,0 +1,51 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+namespace libgp
+{
+	// The container of a Guitar Pro 6 document. A BCFZ block is decompressed into
+	// a BCFS image, a small file system of 4 KiB sectors whose first sector is a
+	// header and whose file entries each list the sectors holding the file.
+	class GpxFileSystem
+	{
+	public:
+		static constexpr size_t SectorSize = 0x1000;
+
+		// Accepts either a compressed (BCFZ) or an uncompressed (BCFS) container.
+		// An uncompressed container is read in place and must outlive this object.
+		GpxFileSystem(const std::byte* data, size_t size);
+
+		static bool isContainer(const std::byte* data, size_t size) noexcept;
+
+		bool contains(std::string_view name) const noexcept;
+
+		// Copies the file out of the sectors it is spread over
+		std::vector<char> readFile(std::string_view name) const;
+
+	private:
+		struct Entry
+		{
+			std::string_view name;
+			uint32_t size;
+			// Where the zero-terminated sector list of the entry starts
+			size_t sectorsOffset;
+		};
+
+		// Holds the image when it had to be decompressed
+		std::vector<std::byte> buffer_;
+		// The image without its magic, so that sector n starts at n * SectorSize
+		const std::byte* image_;
+		size_t imageSize_;
+		std::vector<Entry> entries_;
+
+		void indexEntries();
+		const Entry* find(std::string_view name) const noexcept;
+		uint32_t readInt(size_t offset) const;
+
+		static std::vector<std::byte> decompress(const std::byte* data, size_t size);
+	};
+}
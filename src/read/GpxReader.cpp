@@ -0,0 +1,1310 @@
+#include "GpxReader.h"
+#include "GpxFileSystem.h"
+#include "GpReaderError.h"
+#include "StreamReader.h"
+#include "XmlReader.h"
+#include "Model.h"
+#include <algorithm>
+#include <array>
+#include <charconv>
+#include <cmath>
+#include <iterator>
+#include <locale>
+#include <optional>
+#include <sstream>
+#include <string>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+
+namespace libgp
+{
+	namespace
+	{
+		// GP6 files carry no version string of their own
+		const char* const Version = "GUITAR PRO v6.00";
+		const char* const ScoreFile = "score.gpif";
+
+		template<typename T>
+		T toNumber(std::string_view text, T fallback = T())
+		{
+			T value;
+			if constexpr (std::is_floating_point<T>::value) {
+				// Not every standard library parses floats with from_chars, and
+				// strtof takes the decimal point of the global locale, so floats go
+				// through a stream with the classic locale, which is the one GPIF uses
+				std::istringstream stream{ std::string(text) };
+				stream.imbue(std::locale::classic());
+				return stream >> value ? value : fallback;
+			} else {
+				auto result = std::from_chars(text.data(), text.data() + text.size(), value);
+				return result.ec == std::errc() ? value : fallback;
+			}
+		}
+
+		std::vector<int32_t> toNumbers(std::string_view text)
+		{
+			std::vector<int32_t> numbers;
+			auto it = text.data();
+			auto end = text.data() + text.size();
+
+			while (it != end) {
+				if (*it == ' ' || *it == '\t' || *it == '\r' || *it == '\n') {
+					++it;
+					continue;
+				}
+
+				int32_t value;
+				auto result = std::from_chars(it, end, value);
+				if (result.ec != std::errc()) {
+					throw GpReaderError("Invalid number list: " + std::string(text));
+				}
+
+				numbers.push_back(value);
+				it = result.ptr;
+			}
+
+			return numbers;
+		}
+
+		// A <Property name="..."> entry, which GPIF wraps around an element named
+		// after the type of its value
+		struct Property
+		{
+			std::string_view name;
+			std::string_view type;
+			std::string_view value;
+
+			bool isEnabled() const noexcept { return type == "Enable"; }
+		};
+
+		Property readProperty(XmlReader& xml)
+		{
+			Property property;
+			property.name = xml.attribute("name");
+
+			auto depth = xml.depth();
+			while (xml.nextChild(depth)) {
+				if (property.type.empty()) {
+					property.type = xml.name();
+					property.value = xml.readText();
+				}
+			}
+
+			return property;
+		}
+
+		// Bars have four voice slots, where -1 leaves a slot empty
+		struct ParsedBar
+		{
+			Clef clef = Clef::Treble;
+			std::array<int32_t, 4> voices = { -1, -1, -1, -1 };
+		};
+
+		enum class GraceKind : uint8_t
+		{
+			None = 0,
+			BeforeBeat = 1,
+			OnBeat = 2
+		};
+
+		// Entries can be shared: two voices may list the same beat and two beats the
+		// same note. Each is counted when it is referenced, so that assembling the
+		// measures can move an entry out for its last use and copy it before that.
+		template<typename T>
+		T take(T& value, uint32_t& references)
+		{
+			if (references > 0 && --references == 0) {
+				return std::move(value);
+			}
+
+			return value;
+		}
+
+		template<typename Table>
+		typename Table::mapped_type& lookup(Table& table, int32_t id, const char* kind)
+		{
+			auto it = table.find(id);
+			if (it == table.end()) {
+				throw GpReaderError(std::string("Missing ") + kind + " " + std::to_string(id));
+			}
+
+			return it->second;
+		}
+
+		// The General MIDI keys of the drum kit elements, for files written before
+		// notes carried their key, indexed by element and then by variation
+		const uint8_t DrumKitKeys[][3] = {
+			{ 35, 35, 35 }, // Kick
+			{ 38, 38, 37 }, // Snare, rim shot, side stick
+			{ 56, 56, 56 }, // Cowbell low
+			{ 56, 56, 56 }, // Cowbell medium
+			{ 56, 56, 56 }, // Cowbell high
+			{ 43, 43, 43 }, // Tom very low
+			{ 45, 45, 45 }, // Tom low
+			{ 47, 47, 47 }, // Tom medium
+			{ 48, 48, 48 }, // Tom high
+			{ 50, 50, 50 }, // Tom very high
+			{ 42, 42, 46 }, // Hi-hat closed, half, open
+			{ 44, 44, 44 }, // Pedal hi-hat
+			{ 57, 57, 57 }, // Crash medium
+			{ 49, 49, 49 }, // Crash high
+			{ 55, 55, 55 }, // Splash
+			{ 51, 51, 53 }, // Ride, edge, bell
+			{ 52, 52, 52 }  // China
+		};
+
+		const std::pair<std::string_view, std::string_view> TargetDirections[] = {
+			{ "Coda", "Coda" },
+			{ "DoubleCoda", "Double Coda" },
+			{ "Segno", "Segno" },
+			{ "SegnoSegno", "Segno Segno" },
+			{ "Fine", "Fine" }
+		};
+
+		const std::pair<std::string_view, std::string_view> JumpDirections[] = {
+			{ "DaCapo", "Da Capo" },
+			{ "DaCapoAlCoda", "Da Capo al Coda" },
+			{ "DaCapoAlDoubleCoda", "Da Capo al Double Coda" },
+			{ "DaCapoAlFine", "Da Capo al Fine" },
+			{ "DaSegno", "Da Segno" },
+			{ "DaSegnoAlCoda", "Da Segno al Coda" },
+			{ "DaSegnoAlDoubleCoda", "Da Segno al Double Coda" },
+			{ "DaSegnoAlFine", "Da Segno al Fine" },
+			{ "DaSegnoSegno", "Da Segno Segno" },
+			{ "DaSegnoSegnoAlCoda", "Da Segno Segno al Coda" },
+			{ "DaSegnoSegnoAlDoubleCoda", "Da Segno Segno al Double Coda" },
+			{ "DaSegnoSegnoAlFine", "Da Segno Segno al Fine" },
+			{ "DaCoda", "Da Coda" },
+			{ "DaDoubleCoda", "Da Double Coda" }
+		};
+
+		template<size_t Size>
+		std::string_view findDirection(const std::pair<std::string_view, std::string_view> (&directions)[Size], std::string_view name) noexcept
+		{
+			for (auto const&[gpifName, modelName] : directions) {
+				if (gpifName == name) {
+					return modelName;
+				}
+			}
+
+			return std::string_view();
+		}
+
+		Fingering toFingering(std::string_view finger) noexcept
+		{
+			if (finger == "P") {
+				return Fingering::Thumb;
+			} else if (finger == "I") {
+				return Fingering::Index;
+			} else if (finger == "M") {
+				return Fingering::Middle;
+			} else if (finger == "A") {
+				return Fingering::Annular;
+			} else if (finger == "C") {
+				return Fingering::Little;
+			}
+
+			return Fingering::Open;
+		}
+	}
+
+	struct GpxReader::ParsedBeat
+	{
+		uint32_t references = 0;
+		Beat beat;
+		int32_t rhythm = -1;
+		uint8_t velocity = Note::DefaultVelocity;
+		GraceKind grace = GraceKind::None;
+		std::optional<TremoloPicking> tremoloPicking;
+		size_t firstNote = 0;
+		size_t numNotes = 0;
+	};
+
+	struct GpxReader::ParsedNote
+	{
+		uint32_t references = 0;
+		Note note;
+		int32_t string = -1;
+		int32_t key = -1;
+		int32_t trill = -1;
+	};
+
+	struct GpxReader::PendingGrace
+	{
+		uint8_t string;
+		uint8_t fret;
+		uint8_t duration;
+		uint8_t velocity;
+		bool isDead;
+		bool isOnBeat;
+	};
+
+	// The tables of the document, indexed by id. Voices and beats keep their
+	// lists of ids as ranges of one shared list each.
+	struct GpxReader::Score
+	{
+		std::vector<int32_t> trackOrder;
+		std::map<uint32_t, uint32_t> tempos;
+		std::unordered_map<int32_t, Track> tracks;
+		// The bar of each track in each master bar, a row per master bar
+		std::vector<int32_t> masterBarBars;
+		std::unordered_map<int32_t, ParsedBar> bars;
+		std::unordered_map<int32_t, std::pair<size_t, size_t>> voices;
+		std::vector<int32_t> beatIds;
+		std::unordered_map<int32_t, ParsedBeat> beats;
+		std::vector<int32_t> noteIds;
+		std::unordered_map<int32_t, ParsedNote> notes;
+		std::unordered_map<int32_t, Duration> rhythms;
+	};
+
+	GpxReader::GpxReader() :
+		GpReaderBase({
+			GpVersion::parse(Version)
+		})
+	{
+
+	}
+
+	std::unique_ptr<Song> GpxReader::readSong(StreamReader& reader)
+	{
+		auto file = readScoreFile(reader);
+		XmlReader xml(file->data(), file->size());
+
+		auto storage = std::make_shared<SongStorage>();
+		ArenaScope scope(storage->arena());
+
+		auto song = std::make_unique<Song>();
+		song->storage = std::move(storage);
+
+		Score score;
+		readDocument(*song, song->measureHeaders, score, xml, false);
+		buildTracks(*song, score);
+		buildMeasures(*song, score);
+		resolveTempos(*song, score.tempos);
+
+		return song;
+	}
+
+	SongInfo GpxReader::readHeader(StreamReader& reader)
+	{
+		auto file = readScoreFile(reader);
+		XmlReader xml(file->data(), file->size());
+
+		auto storage = std::make_shared<SongStorage>();
+		ArenaScope scope(storage->arena());
+
+		SongInfo info;
+		info.storage = std::move(storage);
+
+		// Only the key is wanted from the bars, so reading stops after them
+		Score score;
+		ArenaVector<MeasureHeader> headers;
+		readDocument(info, headers, score, xml, true);
+
+		return info;
+	}
+
+	// Unpacks the score document. It is tokenized in place, so every view the
+	// tokenizer hands out points into the returned buffer.
+	std::shared_ptr<std::vector<char>> GpxReader::readScoreFile(StreamReader& reader)
+	{
+		reader.loadAll();
+		GpxFileSystem files(reader.data() + reader.position(), reader.remaining());
+		reader.skip(reader.remaining());
+
+		validateVersion(GpVersion::parse(Version));
+		return std::make_shared<std::vector<char>>(files.readFile(ScoreFile));
+	}
+
+	void GpxReader::readDocument(SongInfo& info, ArenaVector<MeasureHeader>& headers, Score& score, XmlReader& xml, bool headerOnly) const
+	{
+		if (!xml.nextChild(0) || xml.name() != "GPIF") {
+			throw GpReaderError("Not a Guitar Pro 6 score");
+		}
+
+		info.tempo.value = 120;
+		info.tempo.isHidden = false;
+		info.lyrics.trackNumber = 0;
+
+		auto hasScore = false;
+		while (xml.nextChild(1)) {
+			auto name = xml.name();
+			if (name == "Score") {
+				readScoreInfo(info, xml);
+				hasScore = true;
+			} else if (name == "MasterTrack") {
+				readMasterTrack(info, score, xml);
+			} else if (name == "Tracks") {
+				readTracks(info, score, xml);
+			} else if (name == "MasterBars") {
+				readMasterBars(headers, score, xml);
+				if (headerOnly) {
+					break;
+				}
+			} else if (name == "Bars") {
+				readBars(score, xml);
+			} else if (name == "Voices") {
+				readVoices(score, xml);
+			} else if (name == "Beats") {
+				readBeats(score, xml);
+			} else if (name == "Notes") {
+				readNotes(score, xml);
+			} else if (name == "Rhythms") {
+				readRhythms(score, xml);
+			}
+		}
+
+		if (!hasScore) {
+			throw GpReaderError("Missing score information");
+		}
+
+		// Keys belong to bars, so the song takes the key it starts in
+		info.keySignature = !headers.empty() ? headers.front().keySignature : KeySignature::CMajor;
+		info.octave = 0;
+	}
+
+	void GpxReader::readScoreInfo(SongInfo& info, XmlReader& xml) const
+	{
+		auto depth = xml.depth();
+		while (xml.nextChild(depth)) {
+			auto name = xml.name();
+			if (name == "Title") {
+				info.title = xml.readText();
+			} else if (name == "SubTitle") {
+				info.subtitle = xml.readText();
+			} else if (name == "Artist") {
+				info.artist = xml.readText();
+			} else if (name == "Album") {
+				info.album = xml.readText();
+			} else if (name == "Words") {
+				info.lyricsWriter = xml.readText();
+			} else if (name == "Music") {
+				info.musicWriter = xml.readText();
+			} else if (name == "Copyright") {
+				info.copyright = xml.readText();
+			} else if (name == "Tabber") {
+				info.tabAuthor = xml.readText();
+			} else if (name == "Instructions") {
+				info.instructions = xml.readText();
+			} else if (name == "Notices") {
+				// Notices are a single block of text, where earlier versions kept a list of lines
+				auto notices = xml.readText();
+				while (!notices.empty()) {
+					auto end = std::min(notices.find('\n'), notices.size());
+					auto line = notices.substr(0, end);
+					if (!line.empty() && line.back() == '\r') {
+						line.remove_suffix(1);
+					}
+
+					info.comments.emplace_back(line);
+					notices.remove_prefix(std::min(end + 1, notices.size()));
+				}
+			} else if (name == "PageSetup") {
+				info.pageSetup = readPageSetup(xml);
+			}
+		}
+	}
+
+	PageSetup GpxReader::readPageSetup(XmlReader& xml) const
+	{
+		PageSetup pageSetup;
+		auto depth = xml.depth();
+		while (xml.nextChild(depth)) {
+			auto name = xml.name();
+			if (name == "Width") {
+				pageSetup.sizeX = toNumber(xml.readText(), pageSetup.sizeX);
+			} else if (name == "Height") {
+				pageSetup.sizeY = toNumber(xml.readText(), pageSetup.sizeY);
+			} else if (name == "LeftMargin") {
+				pageSetup.marginLeft = toNumber(xml.readText(), pageSetup.marginLeft);
+			} else if (name == "RightMargin") {
+				pageSetup.marginRight = toNumber(xml.readText(), pageSetup.marginRight);
+			} else if (name == "TopMargin") {
+				pageSetup.marginTop = toNumber(xml.readText(), pageSetup.marginTop);
+			} else if (name == "BottomMargin") {
+				pageSetup.marginBottom = toNumber(xml.readText(), pageSetup.marginBottom);
+			} else if (name == "Scale") {
+				pageSetup.scoreSizeProportion = toNumber(xml.readText(), pageSetup.scoreSizeProportion);
+			}
+		}
+
+		return pageSetup;
+	}
+
+	// The master track lists the tracks in the order bars refer to them
+	void GpxReader::readMasterTrack(SongInfo& info, Score& score, XmlReader& xml) const
+	{
+		auto depth = xml.depth();
+		while (xml.nextChild(depth)) {
+			auto name = xml.name();
+			if (name == "Tracks") {
+				score.trackOrder = toNumbers(xml.readText());
+			} else if (name == "Automations") {
+				auto automationsDepth = xml.depth();
+				while (xml.nextChild(automationsDepth)) {
+					if (xml.name() == "Automation") {
+						readAutomation(info, score, xml);
+					}
+				}
+			}
+		}
+	}
+
+	// Tempos are automations of the master track. Sets the tempo the song starts
+	// at and records the bars where it changes.
+	void GpxReader::readAutomation(SongInfo& info, Score& score, XmlReader& xml) const
+	{
+		std::string_view type;
+		std::string_view bar;
+		std::string_view value;
+		std::string_view visible;
+
+		auto depth = xml.depth();
+		while (xml.nextChild(depth)) {
+			auto name = xml.name();
+			if (name == "Type") {
+				type = xml.readText();
+			} else if (name == "Bar") {
+				bar = xml.readText();
+			} else if (name == "Value") {
+				value = xml.readText();
+			} else if (name == "Visible") {
+				visible = xml.readText();
+			}
+		}
+
+		if (type != "Tempo") {
+			return;
+		}
+
+		// The value is followed by the unit of the beat it counts
+		auto barIndex = toNumber<uint32_t>(bar);
+		auto tempo = toNumber<uint32_t>(value.substr(0, value.find(' ')), info.tempo.value);
+		score.tempos[barIndex] = tempo;
+
+		if (barIndex == 0) {
+			info.tempo.value = tempo;
+			info.tempo.isHidden = visible == "false";
+		}
+	}
+
+	void GpxReader::readTracks(SongInfo& info, Score& score, XmlReader& xml) const
+	{
+		auto depth = xml.depth();
+		while (xml.nextChild(depth)) {
+			if (xml.name() != "Track") {
+				continue;
+			}
+
+			auto id = toNumber<int32_t>(xml.attribute("id"), -1);
+			Lyrics lyrics;
+			auto track = readTrack(lyrics, xml);
+
+			// Without a master track the tracks are taken in the order they appear
+			auto position = std::find(score.trackOrder.begin(), score.trackOrder.end(), id);
+			if (position == score.trackOrder.end()) {
+				position = score.trackOrder.insert(score.trackOrder.end(), id);
+			}
+
+			track.number = static_cast<uint32_t>(position - score.trackOrder.begin() + 1);
+
+			// Lyrics belong to tracks; the song takes those of the first track that has any
+			auto hasText = std::any_of(lyrics.lines.begin(), lyrics.lines.end(), [](const LyricLine& line) {
+				return !line.lyrics.empty();
+			});
+
+			if (hasText && (info.lyrics.trackNumber == 0 || track.number < info.lyrics.trackNumber)) {
+				info.lyrics = std::move(lyrics);
+				info.lyrics.trackNumber = track.number;
+			}
+
+			score.tracks.emplace(id, std::move(track));
+		}
+	}
+
+	Track GpxReader::readTrack(Lyrics& lyrics, XmlReader& xml) const
+	{
+		Track track{};
+		track.numFrets = 24;
+		track.isVisible = true;
+
+		// The mixer comes before the MIDI settings, so the channel is put
+		// together from both once the track ends
+		MidiChannel channel{};
+		auto hasChannel = false;
+
+		auto depth = xml.depth();
+		while (xml.nextChild(depth)) {
+			auto name = xml.name();
+			if (name == "Name") {
+				track.name = xml.readText();
+			} else if (name == "Color") {
+				auto color = toNumbers(xml.readText());
+				if (color.size() >= 3) {
+					track.color.red = static_cast<uint8_t>(color[0]);
+					track.color.green = static_cast<uint8_t>(color[1]);
+					track.color.blue = static_cast<uint8_t>(color[2]);
+				}
+			} else if (name == "Properties") {
+				readTrackProperties(track, xml);
+			} else if (name == "PlaybackState") {
+				auto playbackState = xml.readText();
+				track.isSolo = playbackState == "Solo";
+				track.isMute = playbackState == "Mute";
+			} else if (name == "RSE") {
+				readMixer(channel, xml);
+			} else if (name == "GeneralMidi") {
+				readGeneralMidi(track, channel, xml);
+				hasChannel = true;
+			} else if (name == "Lyrics") {
+				lyrics = readLyrics(xml);
+			}
+		}
+
+		if (hasChannel) {
+			track.isPercussionTrack = track.isPercussionTrack || channel.isPercussionChannel();
+			track.channel = channel;
+		}
+
+		return track;
+	}
+
+	void GpxReader::readTrackProperties(Track& track, XmlReader& xml) const
+	{
+		auto depth = xml.depth();
+		while (xml.nextChild(depth)) {
+			if (xml.name() != "Property") {
+				continue;
+			}
+
+			auto property = readProperty(xml);
+			if (property.name == "Tuning") {
+				// Pitches run from the lowest string up, while string 1 is the highest
+				auto pitches = toNumbers(property.value);
+				track.strings.clear();
+				track.strings.reserve(pitches.size());
+				for (size_t i = 0; i < pitches.size(); ++i) {
+					GuitarString string;
+					string.number = static_cast<uint8_t>(i + 1);
+					string.value = static_cast<uint8_t>(pitches[pitches.size() - i - 1]);
+					track.strings.push_back(string);
+				}
+			} else if (property.name == "CapoFret") {
+				track.offset = toNumber<uint32_t>(property.value);
+			} else if (property.name == "AutoBrush") {
+				track.settings.autoBrush = true;
+			} else if (property.name == "AutoLetRing") {
+				track.settings.autoLetRing = true;
+			}
+		}
+	}
+
+	void GpxReader::readGeneralMidi(Track& track, MidiChannel& channel, XmlReader& xml) const
+	{
+		track.isPercussionTrack = xml.attribute("table") == "Percussion";
+
+		auto depth = xml.depth();
+		while (xml.nextChild(depth)) {
+			auto name = xml.name();
+			if (name == "PrimaryChannel") {
+				channel.channel = toNumber<uint8_t>(xml.readText());
+			} else if (name == "SecondaryChannel") {
+				channel.effectChannel = toNumber<uint8_t>(xml.readText());
+			} else if (name == "Program") {
+				channel.instrument = toNumber<int32_t>(xml.readText());
+			} else if (name == "Port") {
+				track.port = toNumber<uint8_t>(xml.readText());
+			}
+		}
+	}
+
+	// The mixer keeps balance and volume as fractions of the full range
+	void GpxReader::readMixer(MidiChannel& channel, XmlReader& xml) const
+	{
+		auto depth = xml.depth();
+		while (xml.nextChild(depth)) {
+			if (xml.name() != "ChannelStrip") {
+				continue;
+			}
+
+			auto stripDepth = xml.depth();
+			while (xml.nextChild(stripDepth)) {
+				if (xml.name() != "Parameters") {
+					continue;
+				}
+
+				auto parameters = xml.readText();
+				std::vector<float> levels;
+				while (!parameters.empty()) {
+					auto end = std::min(parameters.find(' '), parameters.size());
+					levels.push_back(toNumber<float>(parameters.substr(0, end)));
+					parameters.remove_prefix(std::min(end + 1, parameters.size()));
+				}
+
+				if (levels.size() > 12) {
+					channel.balance = byteToChannelShort(static_cast<int8_t>(levels[11] * 16));
+					channel.volume = byteToChannelShort(static_cast<int8_t>(levels[12] * 16));
+				}
+			}
+		}
+	}
+
+	Lyrics GpxReader::readLyrics(XmlReader& xml) const
+	{
+		Lyrics lyrics;
+		lyrics.trackNumber = 0;
+
+		auto depth = xml.depth();
+		while (xml.nextChild(depth)) {
+			if (xml.name() != "Line") {
+				continue;
+			}
+
+			std::string_view text;
+			uint32_t offset = 0;
+
+			auto lineDepth = xml.depth();
+			while (xml.nextChild(lineDepth)) {
+				auto name = xml.name();
+				if (name == "Text") {
+					text = xml.readText();
+				} else if (name == "Offset") {
+					offset = toNumber<uint32_t>(xml.readText());
+				}
+			}
+
+			lyrics.lines.emplace_back(offset + 1, std::string(text));
+		}
+
+		return lyrics;
+	}
+
+	void GpxReader::readMasterBars(ArenaVector<MeasureHeader>& headers, Score& score, XmlReader& xml) const
+	{
+		auto depth = xml.depth();
+		while (xml.nextChild(depth)) {
+			if (xml.name() != "MasterBar") {
+				continue;
+			}
+
+			auto number = static_cast<uint32_t>(headers.size() + 1);
+			auto previous = !headers.empty() ? &headers.back() : nullptr;
+			auto header = readMeasureHeader(number, previous, score, xml);
+			headers.push_back(std::move(header));
+		}
+	}
+
+	MeasureHeader GpxReader::readMeasureHeader(uint32_t number, const MeasureHeader* previous, Score& score, XmlReader& xml) const
+	{
+		MeasureHeader header;
+		header.number = number;
+
+		if (previous != nullptr) {
+			header.timeSignature = previous->timeSignature;
+			header.keySignature = previous->keySignature;
+		}
+
+		// Tracks without a bar here are left with an empty measure
+		auto stride = score.trackOrder.size();
+		auto bars = score.masterBarBars.size();
+		score.masterBarBars.resize(bars + stride, -1);
+
+		auto depth = xml.depth();
+		while (xml.nextChild(depth)) {
+			auto name = xml.name();
+			if (name == "Time") {
+				auto time = xml.readText();
+				auto slash = time.find('/');
+				if (slash != std::string_view::npos) {
+					header.timeSignature.numerator = toNumber<int8_t>(time.substr(0, slash), 4);
+					header.timeSignature.denominator.value = toNumber<uint8_t>(time.substr(slash + 1), Duration::Quarter);
+				}
+			} else if (name == "Key") {
+				auto keyDepth = xml.depth();
+				while (xml.nextChild(keyDepth)) {
+					if (xml.name() == "AccidentalCount") {
+						header.keySignature = static_cast<KeySignature>(toNumber<int32_t>(xml.readText()));
+					}
+				}
+			} else if (name == "Bars") {
+				auto ids = toNumbers(xml.readText());
+				std::copy_n(ids.begin(), std::min(ids.size(), stride), score.masterBarBars.begin() + bars);
+			} else if (name == "Repeat") {
+				header.isRepeatOpen = xml.attribute("start") == "true";
+				if (xml.attribute("end") == "true") {
+					header.repeatClose = toNumber<int8_t>(xml.attribute("count"), 1) - 1;
+				}
+			} else if (name == "AlternateEndings") {
+				for (auto ending : toNumbers(xml.readText())) {
+					if (ending > 0 && ending <= 8) {
+						header.repeatAlternative |= static_cast<uint8_t>(1 << (ending - 1));
+					}
+				}
+			} else if (name == "Section") {
+				std::string_view letter;
+				std::string_view text;
+
+				auto sectionDepth = xml.depth();
+				while (xml.nextChild(sectionDepth)) {
+					if (xml.name() == "Letter") {
+						letter = xml.readText();
+					} else if (xml.name() == "Text") {
+						text = xml.readText();
+					}
+				}
+
+				header.marker.title = !text.empty() ? text : letter;
+			} else if (name == "DoubleBar") {
+				header.hasDoubleBar = true;
+			} else if (name == "TripletFeel") {
+				auto tripletFeel = xml.readText();
+				if (tripletFeel == "Triplet8th") {
+					header.tripletFeel = TripletFeel::Eighth;
+				} else if (tripletFeel == "Triplet16th") {
+					header.tripletFeel = TripletFeel::Sixteenth;
+				}
+			} else if (name == "Directions") {
+				auto directionsDepth = xml.depth();
+				while (xml.nextChild(directionsDepth)) {
+					if (xml.name() == "Target") {
+						header.direction = findDirection(TargetDirections, xml.readText());
+					} else if (xml.name() == "Jump") {
+						header.fromDirection = findDirection(JumpDirections, xml.readText());
+					}
+				}
+			}
+		}
+
+		return header;
+	}
+
+	void GpxReader::readBars(Score& score, XmlReader& xml) const
+	{
+		auto depth = xml.depth();
+		while (xml.nextChild(depth)) {
+			if (xml.name() != "Bar") {
+				continue;
+			}
+
+			auto& bar = score.bars[toNumber<int32_t>(xml.attribute("id"), -1)];
+
+			auto barDepth = xml.depth();
+			while (xml.nextChild(barDepth)) {
+				auto name = xml.name();
+				if (name == "Clef") {
+					auto clef = xml.readText();
+					if (clef == "F4") {
+						bar.clef = Clef::Bass;
+					} else if (clef == "C3") {
+						bar.clef = Clef::Alto;
+					} else if (clef == "C4") {
+						bar.clef = Clef::Tenor;
+					}
+				} else if (name == "Voices") {
+					auto voices = toNumbers(xml.readText());
+					std::copy_n(voices.begin(), std::min(voices.size(), bar.voices.size()), bar.voices.begin());
+				}
+			}
+		}
+	}
+
+	void GpxReader::readVoices(Score& score, XmlReader& xml) const
+	{
+		auto depth = xml.depth();
+		while (xml.nextChild(depth)) {
+			if (xml.name() != "Voice") {
+				continue;
+			}
+
+			auto& voice = score.voices[toNumber<int32_t>(xml.attribute("id"), -1)];
+
+			auto voiceDepth = xml.depth();
+			while (xml.nextChild(voiceDepth)) {
+				if (xml.name() != "Beats") {
+					continue;
+				}
+
+				auto beats = toNumbers(xml.readText());
+				voice = { score.beatIds.size(), beats.size() };
+				score.beatIds.insert(score.beatIds.end(), beats.begin(), beats.end());
+
+				for (auto id : beats) {
+					++score.beats[id].references;
+				}
+			}
+		}
+	}
+
+	void GpxReader::readBeats(Score& score, XmlReader& xml) const
+	{
+		auto depth = xml.depth();
+		while (xml.nextChild(depth)) {
+			if (xml.name() == "Beat") {
+				auto& beat = score.beats[toNumber<int32_t>(xml.attribute("id"), -1)];
+				readBeat(beat, score, xml);
+			}
+		}
+	}
+
+	void GpxReader::readBeat(ParsedBeat& parsed, Score& score, XmlReader& xml) const
+	{
+		const std::string_view Dynamics[] = { "PPP", "PP", "P", "MP", "MF", "F", "FF", "FFF" };
+		auto& beat = parsed.beat;
+
+		auto depth = xml.depth();
+		while (xml.nextChild(depth)) {
+			auto name = xml.name();
+			if (name == "Rhythm") {
+				parsed.rhythm = toNumber<int32_t>(xml.attribute("ref"), -1);
+			} else if (name == "Notes") {
+				auto notes = toNumbers(xml.readText());
+				parsed.firstNote = score.noteIds.size();
+				parsed.numNotes = notes.size();
+				score.noteIds.insert(score.noteIds.end(), notes.begin(), notes.end());
+
+				for (auto id : notes) {
+					score.notes[id].references += parsed.references;
+				}
+			} else if (name == "GraceNotes") {
+				parsed.grace = xml.readText() == "OnBeat" ? GraceKind::OnBeat : GraceKind::BeforeBeat;
+			} else if (name == "Dynamic") {
+				auto dynamic = std::find(std::begin(Dynamics), std::end(Dynamics), xml.readText());
+				if (dynamic != std::end(Dynamics)) {
+					parsed.velocity = unpackVelocity(static_cast<int8_t>(dynamic - std::begin(Dynamics) + 1));
+				}
+			} else if (name == "FreeText") {
+				beat.text = xml.readText();
+			} else if (name == "Fadding") {
+				beat.effect.hasFadeIn = xml.readText() == "FadeIn";
+			} else if (name == "Ottavia") {
+				auto octave = xml.readText();
+				if (octave == "8va") {
+					beat.octave = Octave::Ottava;
+				} else if (octave == "8vb") {
+					beat.octave = Octave::OttavaBassa;
+				} else if (octave == "15ma") {
+					beat.octave = Octave::Quindicesima;
+				} else if (octave == "15mb") {
+					beat.octave = Octave::QuindicesimaBassa;
+				}
+			} else if (name == "Tremolo") {
+				// Tremolo picking is written as the fraction of a whole note, such as 1/8
+				auto tremolo = xml.readText();
+				auto slash = tremolo.find('/');
+				if (slash != std::string_view::npos) {
+					TremoloPicking tremoloPicking;
+					tremoloPicking.duration = toNumber<uint8_t>(tremolo.substr(slash + 1), Duration::Eighth);
+					parsed.tremoloPicking = tremoloPicking;
+				}
+			} else if (name == "Properties") {
+				readBeatProperties(beat.effect, xml);
+			}
+		}
+	}
+
+	void GpxReader::readBeatProperties(BeatEffect& effect, XmlReader& xml) const
+	{
+		auto depth = xml.depth();
+		while (xml.nextChild(depth)) {
+			if (xml.name() != "Property") {
+				continue;
+			}
+
+			auto property = readProperty(xml);
+			if (property.name == "PickStroke") {
+				if (property.value == "Up") {
+					effect.pickStroke = BeatStrokeDirection::Up;
+				} else if (property.value == "Down") {
+					effect.pickStroke = BeatStrokeDirection::Down;
+				}
+			} else if (property.name == "Rasgueado") {
+				effect.hasRasgueado = true;
+			} else if (property.name == "Slapped" && property.isEnabled()) {
+				effect.slapEffect = SlapEffect::Slapping;
+			} else if (property.name == "Popped" && property.isEnabled() && effect.slapEffect != SlapEffect::Slapping) {
+				effect.slapEffect = SlapEffect::Popping;
+			}
+		}
+	}
+
+	void GpxReader::readNotes(Score& score, XmlReader& xml) const
+	{
+		auto depth = xml.depth();
+		while (xml.nextChild(depth)) {
+			if (xml.name() == "Note") {
+				readNote(score.notes[toNumber<int32_t>(xml.attribute("id"), -1)], xml);
+			}
+		}
+	}
+
+	void GpxReader::readNote(ParsedNote& parsed, XmlReader& xml) const
+	{
+		auto& note = parsed.note;
+		auto& effect = note.effect;
+		note.type = NoteType::Normal;
+
+		auto depth = xml.depth();
+		while (xml.nextChild(depth)) {
+			auto name = xml.name();
+			if (name == "Properties") {
+				readNoteProperties(parsed, xml);
+			} else if (name == "Tie") {
+				// A muted note stays dead whichever comes first
+				if (xml.attribute("destination") == "true" && note.type == NoteType::Normal) {
+					note.type = NoteType::Tie;
+				}
+			} else if (name == "LetRing") {
+				effect.letRing = true;
+			} else if (name == "Vibrato") {
+				effect.hasVibrato = true;
+			} else if (name == "AntiAccent") {
+				effect.isGhostNote = true;
+			} else if (name == "Accent") {
+				auto accent = toNumber<int32_t>(xml.readText());
+				effect.isStaccato = static_cast<bool>(accent & 0x01);
+				effect.isHeavyAccentuatedNote = static_cast<bool>(accent & 0x04);
+				effect.isAccentuated = static_cast<bool>(accent & 0x08);
+			} else if (name == "LeftFingering") {
+				effect.leftHandFingering = toFingering(xml.readText());
+			} else if (name == "RightFingering") {
+				effect.rightHandFingering = toFingering(xml.readText());
+			} else if (name == "Trill") {
+				// Trills are written as the pitch to alternate with
+				parsed.trill = toNumber<int32_t>(xml.readText(), -1);
+			}
+		}
+	}
+
+	// Bends are an origin, an optional middle and a destination point. Offsets
+	// are percentages of the note and values hundredths of a whole tone.
+	void GpxReader::readNoteProperties(ParsedNote& parsed, XmlReader& xml) const
+	{
+		const float PositionLength = 100;
+		const float SemitoneLength = 50;
+
+		auto& note = parsed.note;
+		auto& effect = note.effect;
+		auto element = -1;
+		auto variation = 0;
+		auto isBended = false;
+		std::optional<float> bendValues[3];
+		float bendOffsets[3] = { 0, PositionLength / 2, PositionLength };
+		std::string_view harmonicFret;
+
+		auto depth = xml.depth();
+		while (xml.nextChild(depth)) {
+			if (xml.name() != "Property") {
+				continue;
+			}
+
+			auto property = readProperty(xml);
+			auto& name = property.name;
+			if (name == "String") {
+				parsed.string = toNumber<int32_t>(property.value, -1);
+			} else if (name == "Fret") {
+				note.value = toNumber<uint8_t>(property.value);
+			} else if (name == "Midi") {
+				parsed.key = toNumber<int32_t>(property.value, -1);
+			} else if (name == "Element") {
+				element = toNumber<int32_t>(property.value, -1);
+			} else if (name == "Variation") {
+				variation = toNumber<int32_t>(property.value);
+			} else if (name == "Muted" && property.isEnabled()) {
+				note.type = NoteType::Dead;
+			} else if (name == "PalmMuted") {
+				effect.palmMute = property.isEnabled();
+			} else if (name == "HopoOrigin") {
+				effect.isHammer = property.isEnabled();
+			} else if (name == "Slide") {
+				// The flags are those of earlier versions
+				const SlideType SlideTypes[] = {
+					SlideType::ShiftSlideTo,
+					SlideType::LegatoSlideTo,
+					SlideType::OutDownwards,
+					SlideType::OutUpwards,
+					SlideType::IntoFromBelow,
+					SlideType::IntoFromAbove
+				};
+
+				auto slides = toNumber<int32_t>(property.value);
+				for (size_t i = 0; i < std::size(SlideTypes); ++i) {
+					if (slides & (1 << i)) {
+						effect.slides.push_back(SlideTypes[i]);
+					}
+				}
+			} else if (name == "HarmonicType") {
+				Harmonic harmonic{};
+				harmonic.type = HarmonicType::Natural;
+				if (property.value == "Artificial") {
+					harmonic.type = HarmonicType::Artificial;
+				} else if (property.value == "Pinch") {
+					harmonic.type = HarmonicType::Pinch;
+				} else if (property.value == "Tap") {
+					harmonic.type = HarmonicType::Tapped;
+				} else if (property.value == "Semi") {
+					harmonic.type = HarmonicType::Semi;
+				}
+
+				effect.harmonic = harmonic;
+			} else if (name == "HarmonicFret") {
+				harmonicFret = property.value;
+			} else if (name == "Bended") {
+				isBended = property.isEnabled();
+			} else if (name == "BendOriginValue") {
+				bendValues[0] = toNumber<float>(property.value);
+			} else if (name == "BendMiddleValue") {
+				bendValues[1] = toNumber<float>(property.value);
+			} else if (name == "BendDestinationValue") {
+				bendValues[2] = toNumber<float>(property.value);
+			} else if (name == "BendOriginOffset") {
+				bendOffsets[0] = toNumber(property.value, bendOffsets[0]);
+			} else if (name == "BendMiddleOffset1") {
+				bendOffsets[1] = toNumber(property.value, bendOffsets[1]);
+			} else if (name == "BendDestinationOffset") {
+				bendOffsets[2] = toNumber(property.value, bendOffsets[2]);
+			}
+		}
+
+		if (parsed.key < 0 && element >= 0 && element < static_cast<int32_t>(std::size(DrumKitKeys)) && variation >= 0 && variation < 3) {
+			parsed.key = DrumKitKeys[element][variation];
+		}
+
+		if (effect.harmonic) {
+			effect.harmonic->fret = static_cast<uint8_t>(toNumber<float>(harmonicFret));
+		}
+
+		if (!isBended) {
+			return;
+		}
+
+		auto& bend = effect.bend;
+		for (size_t i = 0; i < std::size(bendValues); ++i) {
+			if (bendValues[i]) {
+				BendPoint point;
+				point.position = static_cast<uint8_t>(std::lround(bendOffsets[i] * Bend::MaxPosition / PositionLength));
+				point.value = static_cast<int8_t>(std::lround(*bendValues[i] * Bend::SemitoneLength / SemitoneLength));
+				point.hasVibrato = false;
+				bend.points.push_back(point);
+			}
+		}
+
+		if (bend.points.empty()) {
+			return;
+		}
+
+		auto origin = bend.points.front().value;
+		auto destination = bend.points.back().value;
+		auto peak = std::max_element(bend.points.begin(), bend.points.end(), [](const BendPoint& lhs, const BendPoint& rhs) {
+			return lhs.value < rhs.value;
+		})->value;
+
+		if (origin > 0) {
+			bend.type = destination < origin ? BendType::PrebendRelease : BendType::Prebend;
+		} else if (peak > destination) {
+			bend.type = BendType::BendRelease;
+		} else {
+			bend.type = BendType::Bend;
+		}
+
+		bend.value = static_cast<int32_t>(peak * SemitoneLength);
+	}
+
+	void GpxReader::readRhythms(Score& score, XmlReader& xml) const
+	{
+		auto depth = xml.depth();
+		while (xml.nextChild(depth)) {
+			if (xml.name() == "Rhythm") {
+				auto id = toNumber<int32_t>(xml.attribute("id"), -1);
+				score.rhythms[id] = readRhythm(xml);
+			}
+		}
+	}
+
+	Duration GpxReader::readRhythm(XmlReader& xml) const
+	{
+		// Note values run from whole notes down, halving each time
+		const std::string_view NoteValues[] = { "Whole", "Half", "Quarter", "Eighth", "16th", "32nd", "64th", "128th" };
+
+		Duration duration;
+		auto depth = xml.depth();
+		while (xml.nextChild(depth)) {
+			auto name = xml.name();
+			if (name == "NoteValue") {
+				auto noteValue = std::find(std::begin(NoteValues), std::end(NoteValues), xml.readText());
+				if (noteValue != std::end(NoteValues)) {
+					duration.value = static_cast<uint8_t>(1 << (noteValue - std::begin(NoteValues)));
+				}
+			} else if (name == "AugmentationDot") {
+				auto count = toNumber<int32_t>(xml.attribute("count"), 1);
+				duration.isDotted = count == 1;
+				duration.isDoubleDotted = count == 2;
+			} else if (name == "PrimaryTuplet") {
+				duration.tuplet.enters = toNumber<uint8_t>(xml.attribute("num"), 1);
+				duration.tuplet.times = toNumber<uint8_t>(xml.attribute("den"), 1);
+			}
+		}
+
+		return duration;
+	}
+
+	void GpxReader::buildTracks(Song& song, Score& score) const
+	{
+		song.tracks.reserve(score.trackOrder.size());
+		for (auto id : score.trackOrder) {
+			song.tracks.push_back(std::move(lookup(score.tracks, id, "track")));
+		}
+
+		score.tracks.clear();
+	}
+
+	void GpxReader::buildMeasures(Song& song, Score& score) const
+	{
+		// Measures and voices refer back to their owners, so they must never be
+		// moved once created
+		auto start = Duration::QuarterTime;
+		for (auto& header : song.measureHeaders) {
+			header.start = start;
+			start += header.calcLength();
+		}
+
+		for (auto& track : song.tracks) {
+			track.measures.reserve(song.measureHeaders.size());
+		}
+
+		auto stride = song.tracks.size();
+		if (score.masterBarBars.size() != song.measureHeaders.size() * stride) {
+			throw GpReaderError("Master bars were read before the tracks they refer to");
+		}
+
+		for (size_t i = 0; i < song.measureHeaders.size(); ++i) {
+			for (size_t t = 0; t < stride; ++t) {
+				auto& track = song.tracks[t];
+				auto& measure = track.measures.emplace_back(track, song.measureHeaders[i]);
+
+				auto barId = score.masterBarBars[i * stride + t];
+				if (barId < 0) {
+					continue;
+				}
+
+				auto& bar = lookup(score.bars, barId, "bar");
+				measure.clef = bar.clef;
+
+				for (size_t v = 0; v < bar.voices.size(); ++v) {
+					if (bar.voices[v] < 0) {
+						continue;
+					}
+
+					while (measure.voices.size() <= v) {
+						measure.voices.emplace_back(measure);
+					}
+
+					buildVoice(measure.voices[v], lookup(score.voices, bar.voices[v], "voice"), score);
+				}
+			}
+		}
+	}
+
+	void GpxReader::buildVoice(Voice& voice, const std::pair<size_t, size_t>& beats, Score& score) const
+	{
+		auto& track = voice.measure.track;
+		voice.beats.reserve(beats.second);
+
+		// Grace notes are beats of their own in GPIF, but effects of the notes they
+		// lead into in the model
+		std::vector<PendingGrace> graces;
+		auto start = voice.measure.header.start;
+
+		for (auto k = beats.first; k < beats.first + beats.second; ++k) {
+			auto& parsed = lookup(score.beats, score.beatIds[k], "beat");
+			auto duration = parsed.rhythm >= 0 ? lookup(score.rhythms, parsed.rhythm, "rhythm") : Duration();
+
+			if (parsed.grace != GraceKind::None) {
+				for (auto n = parsed.firstNote; n < parsed.firstNote + parsed.numNotes; ++n) {
+					auto note = buildNote(lookup(score.notes, score.noteIds[n], "note"), track);
+					graces.push_back({ note.string, note.value, duration.value, parsed.velocity, note.type == NoteType::Dead, parsed.grace == GraceKind::OnBeat });
+				}
+
+				if (parsed.references > 0) {
+					--parsed.references;
+				}
+
+				continue;
+			}
+
+			auto& beat = voice.beats.emplace_back(take(parsed.beat, parsed.references));
+			beat.duration = duration;
+			beat.start = start;
+			start += beat.duration.calcTime();
+
+			beat.notes.reserve(parsed.numNotes);
+			for (auto n = parsed.firstNote; n < parsed.firstNote + parsed.numNotes; ++n) {
+				auto& note = beat.notes.emplace_back(buildNote(lookup(score.notes, score.noteIds[n], "note"), track));
+				note.velocity = parsed.velocity;
+				if (parsed.tremoloPicking) {
+					note.effect.tremoloPicking = parsed.tremoloPicking;
+				}
+			}
+
+			beat.status = !beat.notes.empty() ? BeatStatus::Normal : BeatStatus::Rest;
+			applyGraces(beat, graces);
+		}
+	}
+
+	Note GpxReader::buildNote(ParsedNote& parsed, const Track& track) const
+	{
+		auto note = take(parsed.note, parsed.references);
+
+		// Strings are counted from the lowest one up, the opposite of the model
+		if (parsed.string >= 0 && static_cast<size_t>(parsed.string) < track.strings.size()) {
+			note.string = static_cast<uint8_t>(track.strings.size() - parsed.string);
+		}
+
+		if (track.isPercussionTrack && parsed.key >= 0) {
+			note.value = static_cast<uint8_t>(parsed.key);
+		}
+
+		if (parsed.trill >= 0 && note.string > 0) {
+			Trill trill;
+			trill.fret = static_cast<uint8_t>(parsed.trill - track.strings[note.string - 1].value);
+			trill.duration = Duration::Sixteenth;
+			note.effect.trill = trill;
+		}
+
+		return note;
+	}
+
+	void GpxReader::applyGraces(Beat& beat, std::vector<PendingGrace>& graces) const
+	{
+		for (auto& pending : graces) {
+			for (auto& note : beat.notes) {
+				if (note.string == pending.string) {
+					Grace grace;
+					grace.duration = pending.duration;
+					grace.fret = pending.fret;
+					grace.isDead = pending.isDead;
+					grace.isOnBeat = pending.isOnBeat;
+					grace.transition = GraceTransition::None;
+					grace.velocity = pending.velocity;
+					note.effect.grace = grace;
+				}
+			}
+		}
+
+		graces.clear();
+	}
+
+	// Carries each tempo change over into the measures that follow it
+	void GpxReader::resolveTempos(Song& song, const std::map<uint32_t, uint32_t>& tempos) const
+	{
+		auto tempo = song.tempo.value;
+		for (size_t i = 0; i < song.measureHeaders.size(); ++i) {
+			auto change = tempos.find(static_cast<uint32_t>(i));
+			if (change != tempos.end()) {
+				tempo = change->second;
+			}
+
+			song.measureHeaders[i].tempo = tempo;
+		}
+	}
+}
@@ -0,0 +1,100 @@
+#pragma once
+
+#include "GpReaderBase.h"
+#include "../Arena.h"
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace libgp
+{
+	struct PageSetup;
+	struct MeasureHeader;
+	struct Lyrics;
+	struct MidiChannel;
+	struct Track;
+	struct Voice;
+	struct Beat;
+	struct BeatEffect;
+	struct Note;
+	struct Duration;
+	class SongStorage;
+	class XmlReader;
+
+	// Reads Guitar Pro 6 (.gpx) files: the container is unpacked and the score
+	// document inside it, score.gpif, is mapped onto the same model as the
+	// earlier formats.
+	//
+	// The document is read in a single pass with a pull tokenizer, without
+	// building a tree. GPIF keeps bars, voices, beats, notes and rhythms in flat
+	// tables that refer to each other by id; each entry is decoded straight into
+	// its model type when its table is reached and indexed by id, and measures
+	// are put together from those entries once the document ends.
+	class GpxReader : private GpReaderBase
+	{
+	public:
+		GpxReader();
+
+		using GpReaderBase::readSong;
+		using GpReaderBase::readSongFromFile;
+		using GpReaderBase::tryReadSong;
+		using GpReaderBase::tryReadSongFromFile;
+		using GpReaderBase::salvageSong;
+		using GpReaderBase::salvageSongFromFile;
+		using GpReaderBase::readHeader;
+		using GpReaderBase::readHeaderFromFile;
+		using GpReaderBase::readHeaderView;
+		using GpReaderBase::readHeaderViewFromFile;
+		using GpReaderBase::readLazySong;
+		using GpReaderBase::readLazySongFromFile;
+		using GpReaderBase::version;
+
+	protected:
+		std::unique_ptr<Song> readSong(StreamReader& reader) override;
+		SongInfo readHeader(StreamReader& reader) override;
+
+	private:
+		friend class ReaderRegistry;
+
+		struct ParsedBeat;
+		struct ParsedNote;
+		struct PendingGrace;
+		struct Score;
+
+		std::shared_ptr<std::vector<char>> readScoreFile(StreamReader& reader);
+
+		void readDocument(SongInfo& info, ArenaVector<MeasureHeader>& headers, Score& score, XmlReader& xml, bool headerOnly) const;
+		void readScoreInfo(SongInfo& info, XmlReader& xml) const;
+		PageSetup readPageSetup(XmlReader& xml) const;
+		void readMasterTrack(SongInfo& info, Score& score, XmlReader& xml) const;
+		void readAutomation(SongInfo& info, Score& score, XmlReader& xml) const;
+		void readTracks(SongInfo& info, Score& score, XmlReader& xml) const;
+		Track readTrack(Lyrics& lyrics, XmlReader& xml) const;
+		void readTrackProperties(Track& track, XmlReader& xml) const;
+		void readGeneralMidi(Track& track, MidiChannel& channel, XmlReader& xml) const;
+		void readMixer(MidiChannel& channel, XmlReader& xml) const;
+		Lyrics readLyrics(XmlReader& xml) const;
+		void readMasterBars(ArenaVector<MeasureHeader>& headers, Score& score, XmlReader& xml) const;
+		MeasureHeader readMeasureHeader(uint32_t number, const MeasureHeader* previous, Score& score, XmlReader& xml) const;
+		void readBars(Score& score, XmlReader& xml) const;
+		void readVoices(Score& score, XmlReader& xml) const;
+		void readBeats(Score& score, XmlReader& xml) const;
+		void readBeat(ParsedBeat& beat, Score& score, XmlReader& xml) const;
+		void readBeatProperties(BeatEffect& effect, XmlReader& xml) const;
+		void readNotes(Score& score, XmlReader& xml) const;
+		void readNote(ParsedNote& note, XmlReader& xml) const;
+		void readNoteProperties(ParsedNote& note, XmlReader& xml) const;
+		void readRhythms(Score& score, XmlReader& xml) const;
+		Duration readRhythm(XmlReader& xml) const;
+
+		void buildTracks(Song& song, Score& score) const;
+		void buildMeasures(Song& song, Score& score) const;
+		void buildVoice(Voice& voice, const std::pair<size_t, size_t>& beats, Score& score) const;
+		Note buildNote(ParsedNote& parsed, const Track& track) const;
+		void applyGraces(Beat& beat, std::vector<PendingGrace>& graces) const;
+		void resolveTempos(Song& song, const std::map<uint32_t, uint32_t>& tempos) const;
+	};
+}
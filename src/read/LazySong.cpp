@@ -0,0 +1,45 @@
+#include "LazySong.h"
+#include "Model.h"
+#include <utility>
+
+namespace libgp
+{
+	LazySong::LazySong(std::unique_ptr<Song> song, TrackDecoder decoder) :
+		song_(std::move(song)),
+		decoder_(std::move(decoder)),
+		loadFlags_(std::make_unique<std::once_flag[]>(song_->tracks.size())),
+		loaded_(std::make_unique<std::atomic<bool>[]>(song_->tracks.size()))
+	{
+		for (size_t i = 0; i < song_->tracks.size(); ++i) {
+			loaded_[i] = false;
+		}
+	}
+
+	LazySong::~LazySong() = default;
+
+	const Song& LazySong::song() const noexcept { return *song_; }
+
+	size_t LazySong::numTracks() const noexcept { return song_->tracks.size(); }
+
+	bool LazySong::isLoaded(size_t index) const noexcept { return loaded_[index]; }
+
+	Track& LazySong::track(size_t index)
+	{
+		auto& track = song_->tracks.at(index);
+		std::call_once(loadFlags_[index], [this, index] {
+			decoder_(*song_, index);
+			loaded_[index] = true;
+		});
+
+		return track;
+	}
+
+	std::unique_ptr<Song> LazySong::release()
+	{
+		for (size_t i = 0; i < numTracks(); ++i) {
+			track(i);
+		}
+
+		return std::move(song_);
+	}
+}
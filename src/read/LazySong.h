@@ -0,0 +1,51 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <mutex>
+
+namespace libgp
+{
+	struct Song;
+	struct Track;
+
+	// Song whose tracks only decode their measures the first time they are asked
+	// for, so opening a large score to look at one track costs about one track's
+	// worth of decoding. Everything else, including the measure headers, is read
+	// up front.
+	class LazySong
+	{
+	public:
+		// Decodes the measures of one track into the song
+		using TrackDecoder = std::function<void(Song& song, size_t track)>;
+
+		LazySong(std::unique_ptr<Song> song, TrackDecoder decoder);
+		~LazySong();
+
+		LazySong(const LazySong&) = delete;
+		LazySong& operator=(const LazySong&) = delete;
+
+		// The song as loaded so far; tracks that have not been asked for have no measures
+		const Song& song() const noexcept;
+
+		size_t numTracks() const noexcept;
+		bool isLoaded(size_t index) const noexcept;
+
+		// Returns the track, decoding its measures if this is the first call for
+		// it. Safe to call from several threads; if decoding throws, the next call
+		// tries again.
+		Track& track(size_t index);
+
+		// Decodes every track not loaded yet and hands over the complete song,
+		// leaving this object empty
+		std::unique_ptr<Song> release();
+
+	private:
+		std::unique_ptr<Song> song_;
+		TrackDecoder decoder_;
+		std::unique_ptr<std::once_flag[]> loadFlags_;
+		std::unique_ptr<std::atomic<bool>[]> loaded_;
+	};
+}
@@ -0,0 +1,162 @@
+#include "MappedFile.h"
+#include "GpReaderError.h"
+#include <utility>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace libgp
+{
+#ifdef _WIN32
+	MappedFile::MappedFile(const std::string& path) :
+		data_(nullptr),
+		size_(0),
+		file_(INVALID_HANDLE_VALUE),
+		mapping_(nullptr)
+	{
+		file_ = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+		if (file_ == INVALID_HANDLE_VALUE) {
+			throw GpReaderError("Unable to open file: " + path, ParseErrorCode::FileError);
+		}
+
+		LARGE_INTEGER fileSize;
+		if (!GetFileSizeEx(file_, &fileSize)) {
+			close();
+			throw GpReaderError("Unable to read file size: " + path, ParseErrorCode::FileError);
+		}
+
+		size_ = static_cast<size_t>(fileSize.QuadPart);
+		if (size_ == 0) {
+			return;
+		}
+
+		mapping_ = CreateFileMappingA(file_, nullptr, PAGE_READONLY, 0, 0, nullptr);
+		if (mapping_ == nullptr) {
+			close();
+			throw GpReaderError("Unable to map file: " + path, ParseErrorCode::FileError);
+		}
+
+		data_ = static_cast<const std::byte*>(MapViewOfFile(mapping_, FILE_MAP_READ, 0, 0, 0));
+		if (data_ == nullptr) {
+			close();
+			throw GpReaderError("Unable to map file: " + path, ParseErrorCode::FileError);
+		}
+	}
+
+	void MappedFile::close() noexcept
+	{
+		if (data_ != nullptr) {
+			UnmapViewOfFile(data_);
+		}
+
+		if (mapping_ != nullptr) {
+			CloseHandle(mapping_);
+		}
+
+		if (file_ != INVALID_HANDLE_VALUE) {
+			CloseHandle(file_);
+		}
+
+		data_ = nullptr;
+		size_ = 0;
+		mapping_ = nullptr;
+		file_ = INVALID_HANDLE_VALUE;
+	}
+
+	MappedFile::MappedFile(MappedFile&& other) noexcept :
+		data_(std::exchange(other.data_, nullptr)),
+		size_(std::exchange(other.size_, 0)),
+		file_(std::exchange(other.file_, INVALID_HANDLE_VALUE)),
+		mapping_(std::exchange(other.mapping_, nullptr))
+	{
+	}
+
+	MappedFile& MappedFile::operator=(MappedFile&& other) noexcept
+	{
+		if (this != &other) {
+			close();
+			data_ = std::exchange(other.data_, nullptr);
+			size_ = std::exchange(other.size_, 0);
+			file_ = std::exchange(other.file_, INVALID_HANDLE_VALUE);
+			mapping_ = std::exchange(other.mapping_, nullptr);
+		}
+
+		return *this;
+	}
+#else
+	MappedFile::MappedFile(const std::string& path) :
+		data_(nullptr),
+		size_(0)
+	{
+		auto fd = ::open(path.c_str(), O_RDONLY);
+		if (fd < 0) {
+			throw GpReaderError("Unable to open file: " + path, ParseErrorCode::FileError);
+		}
+
+		struct stat info;
+		if (::fstat(fd, &info) != 0) {
+			::close(fd);
+			throw GpReaderError("Unable to read file size: " + path, ParseErrorCode::FileError);
+		}
+
+		size_ = static_cast<size_t>(info.st_size);
+		if (size_ == 0) {
+			::close(fd);
+			return;
+		}
+
+		// The descriptor is not needed once the pages are mapped
+		auto address = ::mmap(nullptr, size_, PROT_READ, MAP_SHARED, fd, 0);
+		::close(fd);
+
+		if (address == MAP_FAILED) {
+			size_ = 0;
+			throw GpReaderError("Unable to map file: " + path, ParseErrorCode::FileError);
+		}
+
+		::madvise(address, size_, MADV_SEQUENTIAL);
+		data_ = static_cast<const std::byte*>(address);
+	}
+
+	void MappedFile::close() noexcept
+	{
+		if (data_ != nullptr) {
+			::munmap(const_cast<std::byte*>(data_), size_);
+		}
+
+		data_ = nullptr;
+		size_ = 0;
+	}
+
+	MappedFile::MappedFile(MappedFile&& other) noexcept :
+		data_(std::exchange(other.data_, nullptr)),
+		size_(std::exchange(other.size_, 0))
+	{
+	}
+
+	MappedFile& MappedFile::operator=(MappedFile&& other) noexcept
+	{
+		if (this != &other) {
+			close();
+			data_ = std::exchange(other.data_, nullptr);
+			size_ = std::exchange(other.size_, 0);
+		}
+
+		return *this;
+	}
+#endif
+
+	MappedFile::~MappedFile() { close(); }
+
+	const std::byte* MappedFile::data() const noexcept { return data_; }
+
+	size_t MappedFile::size() const noexcept { return size_; }
+}
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+namespace libgp
+{
+	// Read-only memory mapping of a whole file. The mapping is released when the
+	// object is destroyed, so any pointers into data() must not outlive it.
+	class MappedFile
+	{
+	public:
+		explicit MappedFile(const std::string& path);
+		~MappedFile();
+
+		MappedFile(MappedFile&& other) noexcept;
+		MappedFile& operator=(MappedFile&& other) noexcept;
+
+		MappedFile(const MappedFile&) = delete;
+		MappedFile& operator=(const MappedFile&) = delete;
+
+		const std::byte* data() const noexcept;
+		size_t size() const noexcept;
+
+	private:
+		const std::byte* data_;
+		size_t size_;
+#ifdef _WIN32
+		void* file_;
+		void* mapping_;
+#endif
+
+		void close() noexcept;
+	};
+}
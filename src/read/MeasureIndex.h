@@ -0,0 +1,22 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+namespace libgp
+{
+	// Byte ranges of the blocks in a song's measure data, which is stored measure
+	// by measure and, within each measure, track by track. Offsets are relative to
+	// the start of the file, and every block can be decoded on its own.
+	struct MeasureIndex
+	{
+		size_t numTracks = 0;
+		// Start of every block in file order, followed by the end of the last one
+		std::vector<size_t> offsets;
+
+		size_t numMeasures() const noexcept { return numTracks > 0 && !offsets.empty() ? (offsets.size() - 1) / numTracks : 0; }
+
+		size_t begin(size_t measure, size_t track) const { return offsets[measure * numTracks + track]; }
+		size_t end(size_t measure, size_t track) const { return offsets[measure * numTracks + track + 1]; }
+	};
+}
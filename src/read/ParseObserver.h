@@ -0,0 +1,48 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+namespace libgp
+{
+	// The steps a Guitar Pro 3 to 5 file is decoded in, in file order
+	enum class ParsePhase : uint8_t
+	{
+		Version = 0,
+		// Song info, lyrics, page setup, tempo and key
+		SongInfo = 1,
+		MidiChannels = 2,
+		// The direction signs and the measure headers
+		MeasureHeaders = 3,
+		Tracks = 4,
+		Measures = 5
+	};
+
+	// What a phase took and what it decoded. Counts are those of the objects the
+	// phase creates and are zero for the others.
+	struct ParsePhaseStats
+	{
+		ParsePhase phase = ParsePhase::Version;
+		std::chrono::nanoseconds duration{ 0 };
+		size_t bytes = 0;
+		size_t measureHeaders = 0;
+		size_t tracks = 0;
+		size_t measures = 0;
+		size_t beats = 0;
+		size_t notes = 0;
+	};
+
+	// Receives the statistics of each phase of a parse as it ends. A reader
+	// without an observer does not time or count anything.
+	//
+	// Phases that fail report nothing, and a read stopping early, such as
+	// readHeader or readLazySong, reports only the phases it gets through.
+	class ParseObserver
+	{
+	public:
+		virtual ~ParseObserver() = default;
+
+		virtual void onPhase(const ParsePhaseStats& stats) = 0;
+	};
+}
@@ -0,0 +1,73 @@
+#pragma once
+
+#include "GpReaderError.h"
+#include <memory>
+#include <optional>
+#include <utility>
+
+namespace libgp
+{
+	struct Song;
+
+	// What a read that does not throw returns: either what was read, or where
+	// and why the read failed
+	template<typename T>
+	class ParseResult
+	{
+	public:
+		ParseResult(T value) :
+			value_(std::move(value))
+		{
+		}
+
+		ParseResult(const ParseError& error) noexcept :
+			error_(error)
+		{
+		}
+
+		bool hasValue() const noexcept { return value_.has_value(); }
+		explicit operator bool() const noexcept { return hasValue(); }
+
+		// Throws the error as a GpReaderError when the read failed
+		T& value() &
+		{
+			check();
+			return *value_;
+		}
+
+		const T& value() const &
+		{
+			check();
+			return *value_;
+		}
+
+		T&& value() &&
+		{
+			check();
+			return std::move(*value_);
+		}
+
+		// The error of a failed read; its code is None for one that succeeded
+		const ParseError& error() const noexcept { return error_; }
+
+	private:
+		std::optional<T> value_;
+		ParseError error_;
+
+		void check() const
+		{
+			if (!value_) {
+				throw GpReaderError(error_);
+			}
+		}
+	};
+
+	// What a tolerant read got out of a source: the song as far as it could be
+	// decoded, and where and why decoding stopped if it did not reach the end.
+	// There is no song when nothing of it could be kept.
+	struct SalvagedSong
+	{
+		std::unique_ptr<Song> song;
+		std::optional<ParseError> error;
+	};
+}
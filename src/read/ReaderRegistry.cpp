@@ -0,0 +1,182 @@
+#include "ReaderRegistry.h"
+#include "CacheReader.h"
+#include "Gp3Reader.h"
+#include "Gp4Reader.h"
+#include "Gp5Reader.h"
+#include "GpxFileSystem.h"
+#include "GpxReader.h"
+#include "GpReaderError.h"
+#include "LazySong.h"
+#include "Model.h"
+#include "../cache/CacheFormat.h"
+#include <algorithm>
+#include <string>
+#include <string_view>
+#include <utility>
+
+namespace libgp
+{
+	namespace
+	{
+		const std::string_view ZipMagic("PK\x03\x04", 4);
+		const std::string_view GpPrefix = "FICHIER GUITAR PRO v";
+
+		std::string_view toText(const std::byte* data, size_t size) noexcept
+		{
+			return std::string_view(reinterpret_cast<const char*>(data), size);
+		}
+
+		// Everything up to and including the "v" of the version number
+		std::string_view versionPrefix(std::string_view version) noexcept
+		{
+			return version.substr(0, version.rfind('v') + 1);
+		}
+
+		const char* toString(FileFormat format) noexcept
+		{
+			switch (format) {
+			case FileFormat::Gp3:
+				return "Guitar Pro 3";
+			case FileFormat::Gp4:
+				return "Guitar Pro 4";
+			case FileFormat::Gp5:
+				return "Guitar Pro 5";
+			case FileFormat::Gpx:
+				return "Guitar Pro 6";
+			case FileFormat::Gp7:
+				return "Guitar Pro 7";
+			case FileFormat::Cache:
+				return "song cache";
+			default:
+				return "unknown";
+			}
+		}
+	}
+
+	FileFormat detectFormat(const std::byte* data, size_t size) noexcept
+	{
+		size = std::min(size, ReaderRegistry::MaxSniffSize);
+
+		if (GpxFileSystem::isContainer(data, size)) {
+			return FileFormat::Gpx;
+		}
+
+		auto text = toText(data, size);
+		if (text.substr(0, ZipMagic.size()) == ZipMagic) {
+			return FileFormat::Gp7;
+		}
+
+		// The versioned formats start with a length byte and a 30-byte version field
+		if (size < 2) {
+			return FileFormat::Unknown;
+		}
+
+		auto version = text.substr(1, std::to_integer<size_t>(data[0]));
+		if (version.substr(0, GpPrefix.size()) == GpPrefix && version.size() > GpPrefix.size()) {
+			switch (version[GpPrefix.size()]) {
+			case '3':
+				return FileFormat::Gp3;
+			case '4':
+				return FileFormat::Gp4;
+			case '5':
+				return FileFormat::Gp5;
+			default:
+				return FileFormat::Unknown;
+			}
+		}
+
+		auto cachePrefix = versionPrefix(cache::Version);
+		if (version.substr(0, cachePrefix.size()) == cachePrefix) {
+			return FileFormat::Cache;
+		}
+
+		return FileFormat::Unknown;
+	}
+
+	ReaderRegistry::ReaderRegistry() :
+		GpReaderBase({}),
+		format_(FileFormat::Unknown)
+	{
+		// The readers derive privately from their base, which only this class
+		// may convert to
+		registerReader(FileFormat::Gp3, []() { return std::unique_ptr<GpReaderBase>(new Gp3Reader()); });
+		registerReader(FileFormat::Gp4, []() { return std::unique_ptr<GpReaderBase>(new Gp4Reader()); });
+		registerReader(FileFormat::Gp5, []() { return std::unique_ptr<GpReaderBase>(new Gp5Reader()); });
+		registerReader(FileFormat::Gpx, []() { return std::unique_ptr<GpReaderBase>(new GpxReader()); });
+		registerReader(FileFormat::Cache, []() { return std::unique_ptr<GpReaderBase>(new CacheReader()); });
+	}
+
+	void ReaderRegistry::registerReader(FileFormat format, Factory factory)
+	{
+		factories_[format] = std::move(factory);
+	}
+
+	bool ReaderRegistry::canRead(FileFormat format) const noexcept
+	{
+		return factories_.find(format) != factories_.end();
+	}
+
+	FileFormat ReaderRegistry::format() const noexcept { return format_; }
+
+	GpVersion ReaderRegistry::version() const noexcept
+	{
+		return reader_ != nullptr ? reader_->version() : GpVersion();
+	}
+
+	std::unique_ptr<Song> ReaderRegistry::readSong(StreamReader& reader)
+	{
+		return selectReader(reader).readSong(reader);
+	}
+
+	ParseResult<std::unique_ptr<Song>> ReaderRegistry::tryReadSong(StreamReader& reader)
+	{
+		return selectReader(reader).tryReadSong(reader);
+	}
+
+	SongInfo ReaderRegistry::readHeader(StreamReader& reader)
+	{
+		return selectReader(reader).readHeader(reader);
+	}
+
+	SongInfoView ReaderRegistry::readHeaderView(StreamReader& reader)
+	{
+		return selectReader(reader).readHeaderView(reader);
+	}
+
+	std::unique_ptr<LazySong> ReaderRegistry::readLazySong(StreamReader& reader)
+	{
+		return selectReader(reader).readLazySong(reader);
+	}
+
+	SalvagedSong ReaderRegistry::salvageSong(StreamReader& reader)
+	{
+		return selectReader(reader).salvageSong(reader);
+	}
+
+	ParsePhase ReaderRegistry::phase() const noexcept
+	{
+		return reader_ != nullptr ? reader_->phase() : GpReaderBase::phase();
+	}
+
+	// Peeks at the start of the source without consuming it, so the reader that
+	// is picked sees the source from its first byte
+	GpReaderBase& ReaderRegistry::selectReader(StreamReader& reader)
+	{
+		auto available = reader.prefetch(MaxSniffSize);
+		format_ = detectFormat(reader.data() + reader.position(), available);
+		reader_.reset();
+
+		if (format_ == FileFormat::Unknown) {
+			throw GpReaderError("Unrecognized file format");
+		}
+
+		auto factory = factories_.find(format_);
+		if (factory == factories_.end()) {
+			throw GpReaderError(std::string("No reader is registered for the ") + toString(format_) + " format");
+		}
+
+		reader_ = factory->second();
+		reader_->setOptions(options());
+		return *reader_;
+	}
+}
@@ -0,0 +1,85 @@
+#pragma once
+
+#include "GpReaderBase.h"
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+
+namespace libgp
+{
+	enum class FileFormat : uint8_t
+	{
+		Unknown = 0,
+		Gp3 = 1,
+		Gp4 = 2,
+		Gp5 = 3,
+		// Guitar Pro 6, a BCFZ or BCFS container
+		Gpx = 4,
+		// Guitar Pro 7 and later, a ZIP archive
+		Gp7 = 5,
+		// A song cache written by CacheWriter
+		Cache = 6
+	};
+
+	// Tells the format from the first bytes of a file alone. At most
+	// MaxSniffSize bytes are looked at, and fewer are fine if that is all there is.
+	FileFormat detectFormat(const std::byte* data, size_t size) noexcept;
+
+	// Reads songs of any registered format. The format is sniffed from the first
+	// bytes of the source and the source is then handed to the reader registered
+	// for it, so nothing is read twice and no parse is attempted only to fail.
+	//
+	// The readers of the library are registered up front; registering another
+	// reader for a format replaces the one before it.
+	class ReaderRegistry : private GpReaderBase
+	{
+	public:
+		static constexpr size_t MaxSniffSize = 31;
+
+		using Factory = std::function<std::unique_ptr<GpReaderBase>()>;
+
+		ReaderRegistry();
+
+		using GpReaderBase::readSong;
+		using GpReaderBase::readSongFromFile;
+		using GpReaderBase::tryReadSong;
+		using GpReaderBase::tryReadSongFromFile;
+		using GpReaderBase::salvageSong;
+		using GpReaderBase::salvageSongFromFile;
+		using GpReaderBase::readHeader;
+		using GpReaderBase::readHeaderFromFile;
+		using GpReaderBase::readHeaderView;
+		using GpReaderBase::readHeaderViewFromFile;
+		using GpReaderBase::readLazySong;
+		using GpReaderBase::readLazySongFromFile;
+		using GpReaderBase::options;
+		using GpReaderBase::setOptions;
+		using GpReaderBase::parseObserver;
+		using GpReaderBase::setParseObserver;
+
+		void registerReader(FileFormat format, Factory factory);
+		bool canRead(FileFormat format) const noexcept;
+
+		// The format and version of the last source read, once a reader was picked
+		FileFormat format() const noexcept;
+		GpVersion version() const noexcept;
+
+	protected:
+		std::unique_ptr<Song> readSong(StreamReader& reader) override;
+		ParseResult<std::unique_ptr<Song>> tryReadSong(StreamReader& reader) override;
+		SongInfo readHeader(StreamReader& reader) override;
+		SongInfoView readHeaderView(StreamReader& reader) override;
+		std::unique_ptr<LazySong> readLazySong(StreamReader& reader) override;
+		SalvagedSong salvageSong(StreamReader& reader) override;
+		ParsePhase phase() const noexcept override;
+
+	private:
+		std::map<FileFormat, Factory> factories_;
+		FileFormat format_;
+		std::unique_ptr<GpReaderBase> reader_;
+
+		GpReaderBase& selectReader(StreamReader& reader);
+	};
+}
@@ -1,25 +1,115 @@
 #pragma once
 
 #include "GpReaderError.h"
+#include "../ByteOrder.h"
+#include <algorithm>
+#include <cstddef>
 #include <cstdint>
+#include <cstring>
 #include <istream>
-#include <string>
+#include <limits>
+#include <memory>
+#include <string_view>
 #include <type_traits>
+#include <utility>
+#include <vector>
 
 namespace libgp
 {
+	// Reads little-endian Guitar Pro primitives from a contiguous block of memory.
+	// Every read performs a single bounds check against the end of the block, so
+	// primitives compile down to a load and a cursor bump.
+	//
+	// A read that runs past the end does not throw. It records the error, which
+	// sticks, and returns zero; every read after it returns zero as well, so a
+	// decoder only has to check failed() where it would act on what it read.
+	//
+	// Strings are returned as views into the block, which a stream source may
+	// move as it grows, so callers copy what they keep before the next read.
 	class StreamReader
 	{
 	public:
+		// The optional source owns the block and can be retained by whoever needs
+		// views into it to outlive the reader
+		StreamReader(const std::byte* data, size_t size, std::shared_ptr<const void> source = nullptr) noexcept :
+			data_(data),
+			size_(size),
+			position_(0),
+			source_(std::move(source)),
+			stream_(nullptr)
+		{
+		}
+
+		// Adapter for stream sources: the stream is copied into an owned buffer in
+		// chunks as parsing reaches the end of what has been read so far, so a parse
+		// that stops early only reads what it needs
 		explicit StreamReader(std::istream& stream) :
-			stream_(stream)
+			StreamReader(nullptr, 0)
+		{
+			buffer_ = std::make_shared<std::vector<std::byte>>();
+			source_ = buffer_;
+			stream_ = &stream;
+		}
+
+		StreamReader(const StreamReader&) = delete;
+		StreamReader& operator=(const StreamReader&) = delete;
+
+		const std::byte* data() const noexcept { return data_; }
+		size_t size() const noexcept { return size_; }
+		size_t position() const noexcept { return position_; }
+		size_t remaining() const noexcept { return size_ - position_; }
+
+		// Returns the owner of the block, if any. A stream source is read to its end
+		// first so that views into the block stay valid.
+		std::shared_ptr<const void> shareSource()
 		{
+			loadAll();
+			return source_;
 		}
 
-		void skip(uint32_t numBytes) 
+		// Makes up to numBytes available past the cursor without moving it, for
+		// peeking at a header, and returns how many are
+		size_t prefetch(size_t numBytes)
 		{
-			for (auto i = 0; i < numBytes; ++i) {
-				readUnsignedByte();
+			pull(numBytes);
+			return std::min(numBytes, remaining());
+		}
+
+		// Reads a stream source to its end, for formats that have to be decoded as
+		// a whole rather than field by field
+		void loadAll() { pull(std::numeric_limits<size_t>::max()); }
+
+		bool failed() const noexcept { return error_.code != ParseErrorCode::None; }
+		// The first error recorded; its code is None while no read has failed
+		const ParseError& error() const noexcept { return error_; }
+
+		// Records an error found in the values read rather than at the end of
+		// the source, after which the reader fails like one that ran out
+		void fail(ParseErrorCode code, size_t offset) noexcept
+		{
+			if (!failed()) {
+				error_ = ParseError{ code, offset };
+			}
+
+			// Nothing past the cursor can be read any more
+			size_ = position_;
+			stream_ = nullptr;
+		}
+
+		// True once the cursor has reached the end of the source
+		bool atEnd()
+		{
+			if (position_ == size_) {
+				pull(1);
+			}
+
+			return position_ == size_;
+		}
+
+		void skip(size_t numBytes)
+		{
+			if (require(numBytes)) {
+				position_ += numBytes;
 			}
 		}
 
@@ -32,47 +122,127 @@ namespace libgp
 		int32_t readSignedInt() { return read<int32_t>(); }
 		uint32_t readUnsignedInt() { return read<uint32_t>(); }
 
+		double readDouble() { return read<double>(); }
+
 		bool readBoolean() { return static_cast<bool>(readUnsignedByte()); }
 
-		std::string readString(const size_t size)
+		// Reads any trivially copyable value stored as it is laid out in memory,
+		// with numbers little-endian
+		template<typename T>
+		T readRaw()
 		{
-			auto buffer = new char[size];
-			if (!stream_.read(buffer, size)) {
-				throw GpReaderError("An error occurred while reading the stream");
-			}
-
-			return std::string(buffer, size);
+			static_assert(std::is_trivially_copyable<T>::value, "Raw reads need trivially copyable types");
+			return read<T>();
 		}
 
-		std::string readByteSizedString() { return readStringAfter<uint8_t>(); }
+		std::string_view readString(const size_t size) { return readView(size); }
 
-		std::string readIntSizedString() { return readStringAfter<uint32_t>(); }
+		std::string_view readByteSizedString() { return readStringAfter<uint8_t>(); }
 
-		std::string readIntByteSizedString()
+		// Reads a string whose length byte is followed by a fixed-size field
+		std::string_view readByteSizedString(const size_t size)
+		{
+			auto strLen = std::min<size_t>(readUnsignedByte(), size);
+			return readView(size).substr(0, strLen);
+		}
+
+		std::string_view readIntSizedString() { return readStringAfter<uint32_t>(); }
+
+		std::string_view readIntByteSizedString()
 		{
 			skip(4);
 			return readByteSizedString();
 		}
 
+		void skipIntByteSizedString()
+		{
+			skip(4);
+			skip(readUnsignedByte());
+		}
+
 	private:
-		std::istream& stream_;
+		const std::byte* data_;
+		size_t size_;
+		size_t position_;
+		std::shared_ptr<const void> source_;
+		std::istream* stream_;
+		std::shared_ptr<std::vector<std::byte>> buffer_;
+		ParseError error_;
+
+		static constexpr size_t ChunkSize = 64 * 1024;
+
+		bool require(size_t numBytes)
+		{
+			return numBytes <= size_ - position_ || fill(numBytes);
+		}
+
+		// Slow path: fails unless numBytes are available past the cursor
+		bool fill(size_t numBytes)
+		{
+			pull(numBytes);
+
+			if (numBytes > size_ - position_) {
+				fail(ParseErrorCode::UnexpectedEnd, position_);
+				return false;
+			}
+
+			return true;
+		}
+
+		// Pulls more of the stream into the buffer until numBytes are available
+		// past the cursor or the stream runs out
+		void pull(size_t numBytes)
+		{
+			if (stream_ != nullptr) {
+				auto& buffer = *buffer_;
+				while (buffer.size() - position_ < numBytes) {
+					auto used = buffer.size();
+					buffer.resize(used + std::max(ChunkSize, used));
+					stream_->read(reinterpret_cast<char*>(buffer.data() + used), buffer.size() - used);
+					buffer.resize(used + static_cast<size_t>(stream_->gcount()));
+
+					if (!*stream_) {
+						stream_ = nullptr;
+						break;
+					}
+				}
+
+				data_ = buffer.data();
+				size_ = buffer.size();
+			}
+		}
+
+		std::string_view readView(size_t size)
+		{
+			if (!require(size)) {
+				return std::string_view();
+			}
+
+			std::string_view text(reinterpret_cast<const char*>(data_ + position_), size);
+			position_ += size;
+
+			return text;
+		}
 
 		template<typename T, size_t Size = sizeof(T)>
 		T read()
 		{
-			T value;
-			if (!stream_.read(reinterpret_cast<char*>(&value), Size)) {
-				throw GpReaderError("An error occurred while reading the stream");
+			if (!require(Size)) {
+				return T();
 			}
 
-			return value;
+			T value;
+			std::memcpy(&value, data_ + position_, Size);
+			position_ += Size;
+
+			return fromLittleEndian(value);
 		}
 
 		template<typename T, typename std::enable_if<std::is_integral<T>::value, T>::type* = nullptr>
-		std::string readStringAfter()
+		std::string_view readStringAfter()
 		{
 			auto strLen = read<T>();
 			return readString(strLen);
 		}
 	};
-}
\ No newline at end of file
+}
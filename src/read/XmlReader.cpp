@@ -0,0 +1,349 @@
+#include "XmlReader.h"
+#include "GpReaderError.h"
+#include <algorithm>
+#include <cstdlib>
+#include <string>
+
+namespace libgp
+{
+	namespace
+	{
+		bool isWhitespace(char c) noexcept { return c == ' ' || c == '\t' || c == '\r' || c == '\n'; }
+
+		bool isNameEnd(char c) noexcept { return isWhitespace(c) || c == '/' || c == '>' || c == '=' || c == '?'; }
+
+		std::string_view trim(std::string_view text) noexcept
+		{
+			while (!text.empty() && isWhitespace(text.front())) {
+				text.remove_prefix(1);
+			}
+
+			while (!text.empty() && isWhitespace(text.back())) {
+				text.remove_suffix(1);
+			}
+
+			return text;
+		}
+
+		// Writes the code point as UTF-8 and returns the end of what was written
+		char* writeUtf8(uint32_t codePoint, char* out) noexcept
+		{
+			if (codePoint < 0x80) {
+				*out++ = static_cast<char>(codePoint);
+			} else if (codePoint < 0x800) {
+				*out++ = static_cast<char>(0xC0 | (codePoint >> 6));
+				*out++ = static_cast<char>(0x80 | (codePoint & 0x3F));
+			} else if (codePoint < 0x10000) {
+				*out++ = static_cast<char>(0xE0 | (codePoint >> 12));
+				*out++ = static_cast<char>(0x80 | ((codePoint >> 6) & 0x3F));
+				*out++ = static_cast<char>(0x80 | (codePoint & 0x3F));
+			} else {
+				*out++ = static_cast<char>(0xF0 | (codePoint >> 18));
+				*out++ = static_cast<char>(0x80 | ((codePoint >> 12) & 0x3F));
+				*out++ = static_cast<char>(0x80 | ((codePoint >> 6) & 0x3F));
+				*out++ = static_cast<char>(0x80 | (codePoint & 0x3F));
+			}
+
+			return out;
+		}
+	}
+
+	XmlReader::XmlReader(char* data, size_t size) :
+		position_(data),
+		end_(data + size),
+		token_(Token::EndOfDocument),
+		depth_(0),
+		isEmptyElement_(false)
+	{
+	}
+
+	XmlReader::Token XmlReader::next()
+	{
+		// A self-closing tag is reported as a start tag followed by an end tag
+		if (isEmptyElement_) {
+			isEmptyElement_ = false;
+			token_ = Token::EndElement;
+			depth_ = openElements_.size();
+			openElements_.pop_back();
+			return token_;
+		}
+
+		for (;;) {
+			if (position_ == end_) {
+				if (!openElements_.empty()) {
+					throw GpReaderError("Malformed XML: missing closing tag for " + std::string(openElements_.back()));
+				}
+
+				token_ = Token::EndOfDocument;
+				depth_ = 0;
+				return token_;
+			}
+
+			if (startsWith("<![CDATA[")) {
+				auto begin = position_ + 9;
+				auto end = find("]]>");
+				position_ = end + 3;
+
+				token_ = Token::Text;
+				text_ = std::string_view(begin, end - begin);
+				depth_ = openElements_.size();
+				return token_;
+			}
+
+			if (startsWith("<!") || startsWith("<?")) {
+				skipMarkup();
+				continue;
+			}
+
+			if (startsWith("</")) {
+				readEndElement();
+				return token_;
+			}
+
+			if (*position_ == '<') {
+				readStartElement();
+				return token_;
+			}
+
+			// Whitespace between tags is not reported
+			auto end = std::find(position_, end_, '<');
+			auto text = trim(decode(position_, end));
+			position_ = end;
+
+			if (!text.empty()) {
+				token_ = Token::Text;
+				text_ = text;
+				depth_ = openElements_.size();
+				return token_;
+			}
+		}
+	}
+
+	XmlReader::Token XmlReader::token() const noexcept { return token_; }
+
+	std::string_view XmlReader::name() const noexcept { return name_; }
+
+	std::string_view XmlReader::text() const noexcept { return text_; }
+
+	std::string_view XmlReader::attribute(std::string_view attributeName) const noexcept
+	{
+		for (auto const&[name, value] : attributes_) {
+			if (name == attributeName) {
+				return value;
+			}
+		}
+
+		return std::string_view();
+	}
+
+	size_t XmlReader::depth() const noexcept { return depth_; }
+
+	bool XmlReader::nextChild(size_t parentDepth)
+	{
+		for (;;) {
+			switch (next()) {
+			case Token::StartElement:
+				if (depth_ == parentDepth + 1) {
+					return true;
+				}
+				break;
+			case Token::EndElement:
+				if (depth_ == parentDepth) {
+					return false;
+				}
+				break;
+			case Token::EndOfDocument:
+				return false;
+			default:
+				break;
+			}
+		}
+	}
+
+	std::string_view XmlReader::readText()
+	{
+		auto depth = depth_;
+		std::string_view text;
+
+		while (next() != Token::EndElement || depth_ != depth) {
+			if (token_ == Token::Text && depth_ == depth && text.empty()) {
+				text = text_;
+			}
+		}
+
+		return text;
+	}
+
+	void XmlReader::skipElement()
+	{
+		auto depth = depth_;
+		while (next() != Token::EndElement || depth_ != depth) {
+		}
+	}
+
+	void XmlReader::readStartElement()
+	{
+		++position_;
+		name_ = readName();
+		readAttributes();
+
+		if (startsWith("/>")) {
+			position_ += 2;
+			isEmptyElement_ = true;
+		} else {
+			expect('>');
+		}
+
+		if (openElements_.size() == MaxDepth) {
+			throw GpReaderError("Malformed XML: elements are nested too deeply");
+		}
+
+		openElements_.push_back(name_);
+		token_ = Token::StartElement;
+		depth_ = openElements_.size();
+	}
+
+	void XmlReader::readEndElement()
+	{
+		position_ += 2;
+		name_ = readName();
+		skipWhitespace();
+		expect('>');
+
+		if (openElements_.empty() || openElements_.back() != name_) {
+			throw GpReaderError("Malformed XML: unexpected closing tag for " + std::string(name_));
+		}
+
+		token_ = Token::EndElement;
+		depth_ = openElements_.size();
+		openElements_.pop_back();
+	}
+
+	void XmlReader::readAttributes()
+	{
+		attributes_.clear();
+
+		for (;;) {
+			skipWhitespace();
+			if (position_ == end_ || *position_ == '/' || *position_ == '>') {
+				return;
+			}
+
+			auto name = readName();
+			skipWhitespace();
+			expect('=');
+			skipWhitespace();
+
+			if (position_ == end_ || (*position_ != '"' && *position_ != '\'')) {
+				throw GpReaderError("Malformed XML: unquoted attribute value");
+			}
+
+			auto quote = std::string_view(position_++, 1);
+			auto valueEnd = find(quote);
+			attributes_.emplace_back(name, decode(position_, valueEnd));
+			position_ = valueEnd + 1;
+		}
+	}
+
+	// Skips a comment, declaration or processing instruction
+	void XmlReader::skipMarkup()
+	{
+		auto terminator = startsWith("<!--") ? "-->" : ">";
+		position_ = find(terminator) + std::string_view(terminator).size();
+	}
+
+	std::string_view XmlReader::readName()
+	{
+		auto begin = position_;
+		while (position_ != end_ && !isNameEnd(*position_)) {
+			++position_;
+		}
+
+		if (position_ == begin) {
+			throw GpReaderError("Malformed XML: expected a name");
+		}
+
+		return std::string_view(begin, position_ - begin);
+	}
+
+	// Replaces entity and character references in place. Decoded text is never
+	// longer than its encoding, so it always fits over it.
+	std::string_view XmlReader::decode(char* begin, char* end) const
+	{
+		auto out = std::find(begin, end, '&');
+		auto in = out;
+
+		while (in != end) {
+			if (*in != '&') {
+				*out++ = *in++;
+				continue;
+			}
+
+			auto semicolon = std::find(in, end, ';');
+			if (semicolon == end) {
+				throw GpReaderError("Malformed XML: unterminated entity reference");
+			}
+
+			auto entity = std::string_view(in + 1, semicolon - in - 1);
+			if (entity == "lt") {
+				*out++ = '<';
+			} else if (entity == "gt") {
+				*out++ = '>';
+			} else if (entity == "amp") {
+				*out++ = '&';
+			} else if (entity == "quot") {
+				*out++ = '"';
+			} else if (entity == "apos") {
+				*out++ = '\'';
+			} else if (entity.size() > 1 && entity[0] == '#') {
+				auto isHex = entity[1] == 'x' || entity[1] == 'X';
+				auto digits = std::string(entity.substr(isHex ? 2 : 1));
+				auto codePoint = std::strtoul(digits.c_str(), nullptr, isHex ? 16 : 10);
+				if (codePoint == 0 || codePoint > 0x10FFFF) {
+					throw GpReaderError("Malformed XML: invalid character reference");
+				}
+
+				out = writeUtf8(static_cast<uint32_t>(codePoint), out);
+			} else {
+				throw GpReaderError("Malformed XML: unknown entity " + std::string(entity));
+			}
+
+			in = semicolon + 1;
+		}
+
+		return std::string_view(begin, out - begin);
+	}
+
+	void XmlReader::skipWhitespace() noexcept
+	{
+		while (position_ != end_ && isWhitespace(*position_)) {
+			++position_;
+		}
+	}
+
+	bool XmlReader::startsWith(std::string_view text) const noexcept
+	{
+		return static_cast<size_t>(end_ - position_) >= text.size()
+			&& std::string_view(position_, text.size()) == text;
+	}
+
+	// Returns the start of the next occurrence of the text
+	char* XmlReader::find(std::string_view text) const
+	{
+		auto it = std::search(position_, end_, text.begin(), text.end());
+		if (it == end_) {
+			throw GpReaderError("Malformed XML: expected " + std::string(text));
+		}
+
+		return it;
+	}
+
+	void XmlReader::expect(char c)
+	{
+		if (position_ == end_ || *position_ != c) {
+			throw GpReaderError(std::string("Malformed XML: expected ") + c);
+		}
+
+		++position_;
+	}
+}
@@ -0,0 +1,78 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace libgp
+{
+	// A forward-only XML tokenizer for the documents embedded in Guitar Pro
+	// files. Nothing is built up as the document is read: each call moves to the
+	// next start tag, end tag or run of text, and only the tags currently open
+	// are remembered.
+	//
+	// The buffer is tokenized in place: entity references are decoded over the
+	// encoded text, so the buffer must outlive the reader and any view taken from
+	// it. Namespaces, DTDs and encodings other than UTF-8 are not supported.
+	class XmlReader
+	{
+	public:
+		enum class Token : uint8_t
+		{
+			StartElement = 0,
+			EndElement = 1,
+			Text = 2,
+			EndOfDocument = 3
+		};
+
+		XmlReader(char* data, size_t size);
+
+		Token next();
+
+		Token token() const noexcept;
+		// The name of the element that was started or ended
+		std::string_view name() const noexcept;
+		// The character data, or the contents of a CDATA section
+		std::string_view text() const noexcept;
+		// The value of an attribute of the element that was just started, or an
+		// empty view
+		std::string_view attribute(std::string_view attributeName) const noexcept;
+		// How many elements are open, counting the one that was started or ended
+		size_t depth() const noexcept;
+
+		// Moves to the next element directly inside the one open at parentDepth,
+		// passing over anything nested deeper. Returns false once that element ends.
+		bool nextChild(size_t parentDepth);
+		// Reads the text of the element that was just started and moves past its end
+		std::string_view readText();
+		// Moves past the end of the element that was just started
+		void skipElement();
+
+	private:
+		static constexpr size_t MaxDepth = 256;
+
+		char* position_;
+		char* end_;
+		Token token_;
+		std::string_view name_;
+		std::string_view text_;
+		std::vector<std::pair<std::string_view, std::string_view>> attributes_;
+		std::vector<std::string_view> openElements_;
+		size_t depth_;
+		bool isEmptyElement_;
+
+		void readStartElement();
+		void readEndElement();
+		void readAttributes();
+		void skipMarkup();
+
+		std::string_view readName();
+		std::string_view decode(char* begin, char* end) const;
+		void skipWhitespace() noexcept;
+		bool startsWith(std::string_view text) const noexcept;
+		char* find(std::string_view text) const;
+		void expect(char c);
+	};
+}
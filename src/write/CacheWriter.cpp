@@ -0,0 +1,155 @@
+#include "CacheWriter.h"
+#include "GpWriterError.h"
+#include "StreamWriter.h"
+#include "../cache/CacheFormat.h"
+#include <array>
+#include <cstring>
+#include <fstream>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <type_traits>
+
+namespace libgp
+{
+	namespace
+	{
+		class CacheOutput
+		{
+		public:
+			explicit CacheOutput(StreamWriter& writer) :
+				writer_(writer)
+			{
+			}
+
+			template<typename... T>
+			void operator()(const T&... values) { (write(values), ...); }
+
+			void write(const std::string& text) { writer_.writeIntSizedString(text); }
+
+			template<typename T>
+			void write(const ArenaVector<T>& values)
+			{
+				writer_.writeUnsignedInt(static_cast<uint32_t>(values.size()));
+				for (const auto& value : values) {
+					write(value);
+				}
+			}
+
+			template<typename T, size_t Size>
+			void write(const std::array<T, Size>& values)
+			{
+				for (const auto& value : values) {
+					write(value);
+				}
+			}
+
+			template<typename T>
+			void write(const std::optional<T>& value)
+			{
+				writer_.writeBoolean(value.has_value());
+				if (value) {
+					write(*value);
+				}
+			}
+
+			template<typename T>
+			void write(const T& value)
+			{
+				if constexpr (std::is_same<T, bool>::value) {
+					writer_.writeBoolean(value);
+				} else if constexpr (std::is_enum<T>::value) {
+					writer_.writeRaw(static_cast<std::underlying_type_t<T>>(value));
+				} else if constexpr (std::is_arithmetic<T>::value) {
+					writer_.writeRaw(value);
+				} else {
+					describe(*this, value);
+				}
+			}
+
+		private:
+			StreamWriter& writer_;
+		};
+
+		// Reserves a table of offsets to fill in as the blocks it points to are written
+		size_t writeOffsetTable(size_t numEntries, StreamWriter& writer)
+		{
+			auto position = writer.position();
+			for (size_t i = 0; i < numEntries; ++i) {
+				writer.writeRaw<uint64_t>(0);
+			}
+
+			return position;
+		}
+
+		void patchOffset(size_t table, size_t index, StreamWriter& writer)
+		{
+			writer.patchRaw<uint64_t>(table + index * sizeof(uint64_t), writer.position());
+		}
+
+		void writeMeasures(const Song& song, const Track& track, StreamWriter& writer)
+		{
+			CacheOutput output(writer);
+
+			writer.writeUnsignedInt(static_cast<uint32_t>(track.measures.size()));
+			auto table = writeOffsetTable(track.measures.size() + 1, writer);
+
+			for (size_t i = 0; i < track.measures.size(); ++i) {
+				patchOffset(table, i, writer);
+
+				auto& measure = track.measures[i];
+				auto headerIndex = &measure.header - song.measureHeaders.data();
+				if (headerIndex < 0 || static_cast<size_t>(headerIndex) >= song.measureHeaders.size()) {
+					throw GpWriterError("Measure header does not belong to the song");
+				}
+
+				writer.writeUnsignedInt(static_cast<uint32_t>(headerIndex));
+				output(measure.clef, measure.lineBreak);
+
+				writer.writeUnsignedInt(static_cast<uint32_t>(measure.voices.size()));
+				for (auto& voice : measure.voices) {
+					output(voice.direction, voice.beats);
+				}
+			}
+
+			patchOffset(table, track.measures.size(), writer);
+		}
+	}
+
+	std::vector<std::byte> CacheWriter::write(const Song& song) const
+	{
+		StreamWriter writer;
+		CacheOutput output(writer);
+
+		std::string_view version = cache::Version;
+		writer.writeUnsignedByte(static_cast<uint8_t>(version.size()));
+		writer.writeString(version);
+		writer.writePadding(30 - version.size());
+
+		output(static_cast<const SongInfo&>(song), song.masterEffect, song.measureHeaders, song.tracks);
+
+		auto table = writeOffsetTable(song.tracks.size() + 1, writer);
+		for (size_t i = 0; i < song.tracks.size(); ++i) {
+			patchOffset(table, i, writer);
+			writeMeasures(song, song.tracks[i], writer);
+		}
+
+		patchOffset(table, song.tracks.size(), writer);
+		return writer.release();
+	}
+
+	void CacheWriter::writeToFile(const Song& song, const std::string& path) const
+	{
+		auto data = write(song);
+
+		std::ofstream file(path, std::ios::binary | std::ios::trunc);
+		if (!file) {
+			throw GpWriterError("Unable to open file: " + path);
+		}
+
+		file.write(reinterpret_cast<const char*>(data.data()), data.size());
+		if (!file) {
+			throw GpWriterError("Unable to write file: " + path);
+		}
+	}
+}
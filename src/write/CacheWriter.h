@@ -0,0 +1,19 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+namespace libgp
+{
+	struct Song;
+
+	// Writes songs in libgp's cache format, described in CacheFormat.h, for
+	// CacheReader to load back without parsing the original file again
+	class CacheWriter
+	{
+	public:
+		std::vector<std::byte> write(const Song& song) const;
+		void writeToFile(const Song& song, const std::string& path) const;
+	};
+}
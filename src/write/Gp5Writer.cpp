@@ -0,0 +1,963 @@
+#include "Gp5Writer.h"
+#include "GpWriterError.h"
+#include "StreamWriter.h"
+#include "../Model.h"
+#include <array>
+#include <cmath>
+#include <fstream>
+#include <string_view>
+
+namespace libgp
+{
+	namespace
+	{
+		const std::string_view DirectionSigns[] = {
+			"Coda",
+			"Double Coda",
+			"Segno",
+			"Segno Segno",
+			"Fine"
+		};
+
+		const std::string_view FromDirectionSigns[] = {
+			"Da Capo",
+			"Da Capo al Coda",
+			"Da Capo al Double Coda",
+			"Da Capo al Fine",
+			"Da Segno",
+			"Da Segno al Coda",
+			"Da Segno al Double Coda",
+			"Da Segno al Fine",
+			"Da Segno Segno",
+			"Da Segno Segno al Coda",
+			"Da Segno Segno al Double Coda",
+			"Da Segno Segno al Fine",
+			"Da Coda",
+			"Da Double Coda"
+		};
+
+		// The exponent of a power of two, for the durations stored as one
+		int8_t log2(uint32_t value) noexcept
+		{
+			int8_t exponent = 0;
+			while (value > 1) {
+				value >>= 1;
+				++exponent;
+			}
+
+			return exponent;
+		}
+
+		// The inverses of GpReaderBase::byteToChannelShort and unpackVelocity
+		int8_t channelShortToByte(int16_t value) noexcept
+		{
+			return static_cast<int8_t>(std::max<int16_t>(value, 0) >> 3);
+		}
+
+		int8_t packVelocity(uint8_t velocity) noexcept
+		{
+			return static_cast<int8_t>((velocity + 1) / 16);
+		}
+
+		// The number of the measure the sign is set on, or -1 if it is not used
+		int16_t findSign(const Song& song, std::string_view sign, std::string MeasureHeader::* field)
+		{
+			for (size_t i = 0; i < song.measureHeaders.size(); ++i) {
+				if (song.measureHeaders[i].*field == sign) {
+					return static_cast<int16_t>(i + 1);
+				}
+			}
+
+			return -1;
+		}
+	}
+
+	Gp5Writer::Gp5Writer() :
+		Gp5Writer(GpVersion::parse("FICHIER GUITAR PRO v5.10"))
+	{
+
+	}
+
+	Gp5Writer::Gp5Writer(GpVersion version) :
+		version_(std::move(version)),
+		isVersion500_(version_.major() == 5 && version_.minor() == 0)
+	{
+		if (version_.major() != 5 || (version_.minor() != 0 && version_.minor() != 10)) {
+			throw GpWriterError("Unsupported version: " + version_.full());
+		}
+	}
+
+	const GpVersion& Gp5Writer::version() const noexcept { return version_; }
+
+	std::vector<std::byte> Gp5Writer::write(const Song& song) const
+	{
+		StreamWriter writer;
+		writer.reserve(4096 + song.measureHeaders.size() * song.tracks.size() * 64);
+
+		writeVersion(writer);
+		writeSongInfo(song, writer);
+		writeLyrics(song.lyrics, writer);
+		writeMasterEffect(song.masterEffect, writer);
+		writePageSetup(song.pageSetup, writer);
+		writeTempo(song.tempo, writer);
+		writer.writeSignedByte(static_cast<int8_t>(song.keySignature));
+		writer.writeUnsignedInt(song.octave);
+
+		writeMidiChannels(song, writer);
+		writeDirectionSigns(song, writer);
+		writer.writeUnsignedInt(song.masterEffect.reverb);
+
+		writer.writeUnsignedInt(static_cast<uint32_t>(song.measureHeaders.size()));
+		writer.writeUnsignedInt(static_cast<uint32_t>(song.tracks.size()));
+		writeMeasureHeaders(song, writer);
+		writeTracks(song, writer);
+		writeMeasures(song, writer);
+
+		return writer.release();
+	}
+
+	void Gp5Writer::writeToFile(const Song& song, const std::string& path) const
+	{
+		auto data = write(song);
+
+		std::ofstream file(path, std::ios::binary | std::ios::trunc);
+		if (!file) {
+			throw GpWriterError("Unable to open file: " + path);
+		}
+
+		file.write(reinterpret_cast<const char*>(data.data()), data.size());
+		if (!file) {
+			throw GpWriterError("Unable to write file: " + path);
+		}
+	}
+
+	void Gp5Writer::writeVersion(StreamWriter& writer) const
+	{
+		writer.writeByteSizedString(version_.full(), 30);
+	}
+
+	void Gp5Writer::writeSongInfo(const SongInfo& info, StreamWriter& writer) const
+	{
+		writer.writeIntByteSizedString(info.title);
+		writer.writeIntByteSizedString(info.subtitle);
+		writer.writeIntByteSizedString(info.artist);
+		writer.writeIntByteSizedString(info.album);
+		writer.writeIntByteSizedString(info.lyricsWriter);
+		writer.writeIntByteSizedString(info.musicWriter);
+		writer.writeIntByteSizedString(info.copyright);
+		writer.writeIntByteSizedString(info.tabAuthor);
+		writer.writeIntByteSizedString(info.instructions);
+
+		writer.writeUnsignedInt(static_cast<uint32_t>(info.comments.size()));
+		for (auto comment : info.comments) {
+			writer.writeIntByteSizedString(comment);
+		}
+	}
+
+	void Gp5Writer::writeLyrics(const Lyrics& lyrics, StreamWriter& writer) const
+	{
+		writer.writeUnsignedInt(lyrics.trackNumber);
+
+		for (size_t i = 0; i < 5; ++i) {
+			auto line = i < lyrics.lines.size() ? lyrics.lines[i] : LyricLine();
+			writer.writeUnsignedInt(line.startingMeasure);
+			writer.writeIntSizedString(line.lyrics);
+		}
+	}
+
+	// The 19 bytes the reader passes over: the master volume, an unknown int and
+	// the master equalizer
+	// Only 5.10 has the master effect in the song header
+	void Gp5Writer::writeMasterEffect(const RSEMasterEffect& effect, StreamWriter& writer) const
+	{
+		if (isVersion500_) {
+			return;
+		}
+
+		writer.writeUnsignedInt(effect.volume);
+		writer.writePadding(4);
+		writeRSEEqualizer(effect.equalizer, 11, writer);
+	}
+
+	void Gp5Writer::writePageSetup(const PageSetup& pageSetup, StreamWriter& writer) const
+	{
+		writer.writeUnsignedInt(pageSetup.sizeX);
+		writer.writeUnsignedInt(pageSetup.sizeY);
+		writer.writeUnsignedInt(pageSetup.marginLeft);
+		writer.writeUnsignedInt(pageSetup.marginRight);
+		writer.writeUnsignedInt(pageSetup.marginTop);
+		writer.writeUnsignedInt(pageSetup.marginBottom);
+		writer.writeUnsignedInt(static_cast<uint32_t>(std::lround(pageSetup.scoreSizeProportion * 100)));
+		writer.writeUnsignedShort(static_cast<uint16_t>(pageSetup.headerAndFooter));
+		writer.writeIntByteSizedString(pageSetup.title);
+		writer.writeIntByteSizedString(pageSetup.subtitle);
+		writer.writeIntByteSizedString(pageSetup.artist);
+		writer.writeIntByteSizedString(pageSetup.album);
+		writer.writeIntByteSizedString(pageSetup.wordsBy);
+		writer.writeIntByteSizedString(pageSetup.musicBy);
+		writer.writeIntByteSizedString(pageSetup.wordsAndMusicBy);
+
+		// The reader joins the two copyright lines with a line break
+		std::string_view copyright = pageSetup.copyright;
+		auto lineBreak = copyright.find('\n');
+		writer.writeIntByteSizedString(copyright.substr(0, lineBreak));
+		writer.writeIntByteSizedString(lineBreak != std::string_view::npos ? copyright.substr(lineBreak + 1) : std::string_view());
+
+		writer.writeIntByteSizedString(pageSetup.pageNumber);
+	}
+
+	void Gp5Writer::writeTempo(const Tempo& tempo, StreamWriter& writer) const
+	{
+		writer.writeIntByteSizedString(tempo.name);
+		writer.writeUnsignedInt(tempo.value);
+
+		if (!isVersion500_) {
+			writer.writeBoolean(tempo.isHidden);
+		}
+	}
+
+	// The song keeps the channels its tracks play on; the rest of the table is
+	// filled with the channel Guitar Pro creates for a new song
+	void Gp5Writer::writeMidiChannels(const Song& song, StreamWriter& writer) const
+	{
+		std::array<MidiChannel, 64> channels;
+		for (uint8_t i = 0; i < channels.size(); ++i) {
+			auto& channel = channels[i];
+			channel = MidiChannel();
+			channel.channel = i;
+			channel.effectChannel = i;
+			channel.instrument = channel.isPercussionChannel() ? 0 : 25;
+			channel.volume = 104;
+			channel.balance = 64;
+		}
+
+		for (auto& track : song.tracks) {
+			if (track.channel && track.channel->channel < channels.size()) {
+				channels[track.channel->channel] = *track.channel;
+			}
+		}
+
+		for (auto& channel : channels) {
+			writer.writeSignedInt(channel.instrument);
+			writer.writeSignedByte(channelShortToByte(channel.volume));
+			writer.writeSignedByte(channelShortToByte(channel.balance));
+			writer.writeSignedByte(channelShortToByte(channel.chorus));
+			writer.writeSignedByte(channelShortToByte(channel.reverb));
+			writer.writeSignedByte(channelShortToByte(channel.phaser));
+			writer.writeSignedByte(channelShortToByte(channel.tremolo));
+
+			// Backwards compatibility with GP3
+			writer.writePadding(2);
+		}
+	}
+
+	void Gp5Writer::writeDirectionSigns(const Song& song, StreamWriter& writer) const
+	{
+		for (auto sign : DirectionSigns) {
+			writer.writeSignedShort(findSign(song, sign, &MeasureHeader::direction));
+		}
+
+		for (auto sign : FromDirectionSigns) {
+			writer.writeSignedShort(findSign(song, sign, &MeasureHeader::fromDirection));
+		}
+	}
+
+	void Gp5Writer::writeMeasureHeaders(const Song& song, StreamWriter& writer) const
+	{
+		const MeasureHeader* previous = nullptr;
+		for (auto& header : song.measureHeaders) {
+			writeMeasureHeader(header, previous, writer);
+			previous = &header;
+		}
+	}
+
+	void Gp5Writer::writeMeasureHeader(const MeasureHeader& header, const MeasureHeader* previous, StreamWriter& writer) const
+	{
+		if (previous != nullptr) {
+			writer.writePadding(1);
+		}
+
+		auto& timeSignature = header.timeSignature;
+
+		// The beams are only stored along with a time signature
+		uint8_t flags = 0;
+		if (previous == nullptr
+			|| timeSignature.numerator != previous->timeSignature.numerator
+			|| timeSignature.beams != previous->timeSignature.beams) {
+			flags |= 0x01;
+		}
+
+		if (previous == nullptr || timeSignature.denominator.value != previous->timeSignature.denominator.value) {
+			flags |= 0x02;
+		}
+
+		if (header.isRepeatOpen) {
+			flags |= 0x04;
+		}
+
+		if (header.repeatClose > -1) {
+			flags |= 0x08;
+		}
+
+		if (header.repeatAlternative != 0) {
+			flags |= 0x10;
+		}
+
+		if (!header.marker.title.empty()) {
+			flags |= 0x20;
+		}
+
+		auto previousKey = previous != nullptr ? previous->keySignature : KeySignature::CMajor;
+		if (header.keySignature != previousKey) {
+			flags |= 0x40;
+		}
+
+		if (header.hasDoubleBar) {
+			flags |= 0x80;
+		}
+
+		writer.writeUnsignedByte(flags);
+
+		if (flags & 0x01) {
+			writer.writeSignedByte(timeSignature.numerator);
+		}
+
+		if (flags & 0x02) {
+			writer.writeSignedByte(static_cast<int8_t>(timeSignature.denominator.value));
+		}
+
+		// The reader counts the repeats after the first time through
+		if (flags & 0x08) {
+			writer.writeSignedByte(static_cast<int8_t>(header.repeatClose + 1));
+		}
+
+		if (flags & 0x10) {
+			writer.writeUnsignedByte(header.repeatAlternative);
+		}
+
+		if (flags & 0x20) {
+			writeMarker(header.marker, writer);
+		}
+
+		// The root, then whether the key is minor
+		if (flags & 0x40) {
+			writer.writeSignedByte(static_cast<int8_t>(header.keySignature));
+			writer.writeSignedByte(0);
+		}
+
+		if (flags & 0x03) {
+			for (auto beam : timeSignature.beams) {
+				writer.writeUnsignedByte(beam);
+			}
+		}
+
+		if (!(flags & 0x10)) {
+			writer.writePadding(1);
+		}
+
+		writer.writeUnsignedByte(static_cast<uint8_t>(header.tripletFeel));
+	}
+
+	void Gp5Writer::writeMarker(const Marker& marker, StreamWriter& writer) const
+	{
+		writer.writeIntByteSizedString(marker.title);
+		writeColor(marker.color, writer);
+	}
+
+	void Gp5Writer::writeColor(const Color& color, StreamWriter& writer) const
+	{
+		writer.writeUnsignedByte(color.red);
+		writer.writeUnsignedByte(color.green);
+		writer.writeUnsignedByte(color.blue);
+		writer.writePadding(1);
+	}
+
+	void Gp5Writer::writeTracks(const Song& song, StreamWriter& writer) const
+	{
+		for (size_t i = 0; i < song.tracks.size(); ++i) {
+			writeTrack(song.tracks[i], static_cast<uint32_t>(i + 1), writer);
+		}
+
+		writer.writePadding(isVersion500_ ? 2 : 1);
+	}
+
+	void Gp5Writer::writeTrack(const Track& track, uint32_t number, StreamWriter& writer) const
+	{
+		if (track.strings.size() > 7) {
+			throw GpWriterError("Track " + std::to_string(number) + " has more than 7 strings");
+		}
+
+		if (number == 1 || isVersion500_) {
+			writer.writePadding(1);
+		}
+
+		uint8_t flags1 = 0;
+		flags1 |= track.isPercussionTrack ? 0x01 : 0;
+		flags1 |= track.is12StringGuitarTrack ? 0x02 : 0;
+		flags1 |= track.isBanjoTrack ? 0x04 : 0;
+		flags1 |= track.isVisible ? 0x08 : 0;
+		flags1 |= track.isSolo ? 0x10 : 0;
+		flags1 |= track.isMute ? 0x20 : 0;
+		flags1 |= track.useRSE ? 0x40 : 0;
+		flags1 |= track.indicateTuning ? 0x80 : 0;
+		writer.writeUnsignedByte(flags1);
+		writer.writeByteSizedString(track.name, 40);
+
+		writer.writeUnsignedInt(static_cast<uint32_t>(track.strings.size()));
+		for (size_t i = 0; i < 7; ++i) {
+			writer.writeUnsignedInt(i < track.strings.size() ? track.strings[i].value : 0);
+		}
+
+		writer.writeUnsignedInt(track.port);
+
+		// Channels are numbered from one, and zero stands for none
+		writer.writeUnsignedInt(track.channel ? track.channel->channel + 1 : 0);
+		writer.writeUnsignedInt(track.channel ? track.channel->effectChannel + 1 : 0);
+
+		writer.writeUnsignedInt(track.numFrets);
+		writer.writeUnsignedInt(track.offset);
+		writeColor(track.color, writer);
+
+		auto& settings = track.settings;
+		uint16_t flags2 = 0;
+		flags2 |= settings.showTablature ? 0x001 : 0;
+		flags2 |= settings.showNotation ? 0x002 : 0;
+		flags2 |= settings.diagramsAreBelow ? 0x004 : 0;
+		flags2 |= settings.showRhythm ? 0x008 : 0;
+		flags2 |= settings.forceHorizontal ? 0x010 : 0;
+		flags2 |= settings.forceChannels ? 0x020 : 0;
+		flags2 |= settings.showDiagramList ? 0x040 : 0;
+		flags2 |= settings.showDiagramsInScore ? 0x080 : 0;
+		flags2 |= settings.autoLetRing ? 0x200 : 0;
+		flags2 |= settings.autoBrush ? 0x400 : 0;
+		flags2 |= settings.extendRhythmic ? 0x800 : 0;
+		writer.writeUnsignedShort(flags2);
+
+		writer.writeUnsignedByte(static_cast<uint8_t>(track.rse.autoAccentuation));
+		writer.writeUnsignedByte(track.channel ? track.channel->bank : 0);
+
+		writeTrackRSE(track.rse, writer);
+	}
+
+	void Gp5Writer::writeTrackRSE(const TrackRSE& rse, StreamWriter& writer) const
+	{
+		writer.writeUnsignedByte(rse.humanize);
+		writer.writePadding(12 + 12);
+		writeRSEInstrument(rse.instrument, writer);
+
+		if (!isVersion500_) {
+			writeRSEEqualizer(rse.equalizer, 4, writer);
+			writer.writeIntByteSizedString(rse.instrument.effect);
+			writer.writeIntByteSizedString(rse.instrument.effectCategory);
+		}
+	}
+
+	void Gp5Writer::writeRSEInstrument(const RSEInstrument& instrument, StreamWriter& writer) const
+	{
+		writer.writeSignedInt(instrument.instrument);
+		writer.writeUnsignedInt(instrument.unknown);
+		writer.writeSignedInt(instrument.soundBank);
+
+		if (isVersion500_) {
+			writer.writeSignedShort(static_cast<int16_t>(instrument.effectNumber));
+			writer.writePadding(1);
+		} else {
+			writer.writeSignedInt(instrument.effectNumber);
+		}
+	}
+
+	// Knobs are stored in tenths of a decibel, negated; missing knobs are flat
+	void Gp5Writer::writeRSEEqualizer(const RSEEqualizer& equalizer, uint8_t numKnobs, StreamWriter& writer) const
+	{
+		for (size_t i = 0; i < numKnobs; ++i) {
+			auto knob = i < equalizer.knobs.size() ? equalizer.knobs[i] : 0.0f;
+			writer.writeSignedByte(static_cast<int8_t>(std::lround(-knob * 10)));
+		}
+	}
+
+	void Gp5Writer::writeMeasures(const Song& song, StreamWriter& writer) const
+	{
+		for (auto& track : song.tracks) {
+			if (track.measures.size() != song.measureHeaders.size()) {
+				throw GpWriterError("Track " + std::to_string(track.number) + " does not have a measure for every measure header");
+			}
+		}
+
+		for (size_t i = 0; i < song.measureHeaders.size(); ++i) {
+			for (auto& track : song.tracks) {
+				writeMeasure(track.measures[i], writer);
+			}
+		}
+	}
+
+	void Gp5Writer::writeMeasure(const Measure& measure, StreamWriter& writer) const
+	{
+		for (size_t i = 0; i < Measure::MaxVoices; ++i) {
+			if (i < measure.voices.size()) {
+				writeVoice(measure.voices[i], writer);
+			} else {
+				writer.writeUnsignedInt(0);
+			}
+		}
+
+		writer.writeUnsignedByte(static_cast<uint8_t>(measure.lineBreak));
+	}
+
+	void Gp5Writer::writeVoice(const Voice& voice, StreamWriter& writer) const
+	{
+		writer.writeUnsignedInt(static_cast<uint32_t>(voice.beats.size()));
+		for (auto& beat : voice.beats) {
+			writeBeat(beat, voice.measure.track, writer);
+		}
+	}
+
+	void Gp5Writer::writeBeat(const Beat& beat, const Track& track, StreamWriter& writer) const
+	{
+		auto& effect = beat.effect;
+		auto hasEffect = effect.vibrato != 0
+			|| effect.hasFadeIn
+			|| effect.slapEffect != SlapEffect::None
+			|| effect.tremoloBar.type != BendType::None
+			|| !effect.tremoloBar.points.empty()
+			|| effect.stroke.direction != BeatStrokeDirection::None
+			|| effect.hasRasgueado
+			|| effect.pickStroke != BeatStrokeDirection::None;
+
+		uint8_t flags = 0;
+		flags |= beat.duration.isDotted ? 0x01 : 0;
+		flags |= effect.chord ? 0x02 : 0;
+		flags |= !beat.text.empty() ? 0x04 : 0;
+		flags |= hasEffect ? 0x08 : 0;
+		flags |= effect.mixTableChange ? 0x10 : 0;
+		flags |= beat.duration.tuplet.enters != 1 ? 0x20 : 0;
+		flags |= beat.status != BeatStatus::Normal ? 0x40 : 0;
+		writer.writeUnsignedByte(flags);
+
+		if (flags & 0x40) {
+			writer.writeUnsignedByte(static_cast<uint8_t>(beat.status));
+		}
+
+		writeDuration(beat.duration, writer);
+
+		if (flags & 0x02) {
+			writeChord(*effect.chord, writer);
+		}
+
+		if (flags & 0x04) {
+			writer.writeIntByteSizedString(beat.text);
+		}
+
+		if (flags & 0x08) {
+			writeBeatEffect(effect, writer);
+		}
+
+		if (flags & 0x10) {
+			writeMixTableChange(*effect.mixTableChange, writer);
+		}
+
+		writeNotes(beat, track, writer);
+
+		auto& display = beat.display;
+		uint16_t flags2 = 0;
+		flags2 |= display.breakBeam ? 0x0001 : 0;
+		flags2 |= display.beamDirection == VoiceDirection::Down ? 0x0002 : 0;
+		flags2 |= display.forceBeam ? 0x0004 : 0;
+		flags2 |= display.beamDirection == VoiceDirection::Up ? 0x0008 : 0;
+		flags2 |= beat.octave == Octave::Ottava ? 0x0010 : 0;
+		flags2 |= beat.octave == Octave::OttavaBassa ? 0x0020 : 0;
+		flags2 |= beat.octave == Octave::Quindicesima ? 0x0040 : 0;
+		flags2 |= beat.octave == Octave::QuindicesimaBassa ? 0x0100 : 0;
+		flags2 |= display.tupletBracket == TupletBracket::Start ? 0x0200 : 0;
+		flags2 |= display.tupletBracket == TupletBracket::End ? 0x0400 : 0;
+		flags2 |= display.breakSecondary != 0 ? 0x0800 : 0;
+		flags2 |= display.breakSecondaryTuplet ? 0x1000 : 0;
+		flags2 |= display.forceBracket ? 0x2000 : 0;
+		writer.writeUnsignedShort(flags2);
+
+		if (flags2 & 0x0800) {
+			writer.writeUnsignedByte(display.breakSecondary);
+		}
+	}
+
+	void Gp5Writer::writeDuration(const Duration& duration, StreamWriter& writer) const
+	{
+		// A whole note is -2, a half note -1, a quarter note 0 and so on
+		writer.writeSignedByte(static_cast<int8_t>(log2(duration.value) - 2));
+
+		if (duration.tuplet.enters != 1) {
+			writer.writeUnsignedInt(duration.tuplet.enters);
+		}
+	}
+
+	void Gp5Writer::writeChord(const Chord& chord, StreamWriter& writer) const
+	{
+		writer.writeBoolean(chord.isNewFormat);
+		if (!chord.isNewFormat) {
+			writeOldChord(chord, writer);
+		} else {
+			writeNewChord(chord, writer);
+		}
+	}
+
+	void Gp5Writer::writeOldChord(const Chord& chord, StreamWriter& writer) const
+	{
+		writer.writeIntByteSizedString(chord.name);
+		writer.writeUnsignedInt(chord.firstFret);
+		if (chord.firstFret) {
+			for (size_t i = 0; i < 6; ++i) {
+				writer.writeSignedInt(i < chord.strings.size() ? chord.strings[i] : -1);
+			}
+		}
+	}
+
+	void Gp5Writer::writeNewChord(const Chord& chord, StreamWriter& writer) const
+	{
+		writer.writeBoolean(chord.isSharp);
+		writer.writePadding(3);
+		writer.writeUnsignedByte(chord.root);
+		writer.writeUnsignedByte(static_cast<uint8_t>(chord.type));
+		writer.writeUnsignedByte(static_cast<uint8_t>(chord.extension));
+		writer.writeSignedInt(chord.bass);
+		writer.writeSignedInt(chord.tonality);
+		writer.writeUnsignedByte(chord.add);
+		writer.writeByteSizedString(chord.name, 22);
+		writer.writeUnsignedByte(chord.fifth);
+		writer.writeUnsignedByte(chord.ninth);
+		writer.writeUnsignedByte(chord.eleventh);
+		writer.writeUnsignedInt(chord.firstFret);
+
+		for (size_t i = 0; i < 7; ++i) {
+			writer.writeSignedInt(i < chord.strings.size() ? chord.strings[i] : -1);
+		}
+
+		auto numBarres = std::min<size_t>(chord.barres.size(), 5);
+		writer.writeUnsignedByte(static_cast<uint8_t>(numBarres));
+		for (size_t i = 0; i < 5; ++i) {
+			writer.writeUnsignedByte(i < numBarres ? chord.barres[i].fret : 0);
+		}
+
+		for (size_t i = 0; i < 5; ++i) {
+			writer.writeUnsignedByte(i < numBarres ? chord.barres[i].start : 0);
+		}
+
+		for (size_t i = 0; i < 5; ++i) {
+			writer.writeUnsignedByte(i < numBarres ? chord.barres[i].end : 0);
+		}
+
+		for (size_t i = 0; i < 7; ++i) {
+			writer.writeBoolean(i < chord.omissions.size() ? chord.omissions[i] : true);
+		}
+
+		writer.writePadding(1);
+
+		for (size_t i = 0; i < 7; ++i) {
+			auto fingering = i < chord.fingerings.size() ? chord.fingerings[i] : Fingering::Unknown;
+			writer.writeSignedByte(static_cast<int8_t>(fingering));
+		}
+
+		writer.writeUnsignedByte(chord.show);
+	}
+
+	void Gp5Writer::writeBeatEffect(const BeatEffect& effect, StreamWriter& writer) const
+	{
+		auto hasTremoloBar = effect.tremoloBar.type != BendType::None || !effect.tremoloBar.points.empty();
+
+		uint8_t flags1 = effect.vibrato & 0x03;
+		flags1 |= effect.hasFadeIn ? 0x10 : 0;
+		flags1 |= effect.slapEffect != SlapEffect::None ? 0x20 : 0;
+		flags1 |= effect.stroke.direction != BeatStrokeDirection::None ? 0x40 : 0;
+
+		uint8_t flags2 = 0;
+		flags2 |= effect.hasRasgueado ? 0x01 : 0;
+		flags2 |= effect.pickStroke != BeatStrokeDirection::None ? 0x02 : 0;
+		flags2 |= hasTremoloBar ? 0x04 : 0;
+
+		writer.writeUnsignedByte(flags1);
+		writer.writeUnsignedByte(flags2);
+
+		if (flags1 & 0x20) {
+			writer.writeUnsignedByte(static_cast<uint8_t>(effect.slapEffect));
+		}
+
+		if (flags2 & 0x04) {
+			writeBend(effect.tremoloBar, writer);
+		}
+
+		if (flags1 & 0x40) {
+			writeBeatStroke(effect.stroke, writer);
+		}
+
+		if (flags2 & 0x02) {
+			writer.writeUnsignedByte(static_cast<uint8_t>(effect.pickStroke));
+		}
+	}
+
+	void Gp5Writer::writeBeatStroke(const BeatStroke& stroke, StreamWriter& writer) const
+	{
+		// GP5 stores the up stroke first, the opposite of earlier versions
+		writer.writeUnsignedByte(stroke.direction == BeatStrokeDirection::Up ? stroke.value : 0);
+		writer.writeUnsignedByte(stroke.direction == BeatStrokeDirection::Down ? stroke.value : 0);
+	}
+
+	void Gp5Writer::writeBend(const Bend& bend, StreamWriter& writer) const
+	{
+		// Positions are stored in sixtieths of the note and values in
+		// twenty-fifths of a semitone
+		const int32_t PositionLength = 60;
+		const int32_t SemitoneLength = 25;
+
+		writer.writeSignedByte(static_cast<int8_t>(bend.type));
+		writer.writeSignedInt(bend.value);
+
+		writer.writeUnsignedInt(static_cast<uint32_t>(bend.points.size()));
+		for (auto& point : bend.points) {
+			writer.writeSignedInt(static_cast<int32_t>(std::lround(point.position * PositionLength / static_cast<double>(Bend::MaxPosition))));
+			writer.writeSignedInt(static_cast<int32_t>(std::lround(point.value * SemitoneLength / static_cast<double>(Bend::SemitoneLength))));
+			writer.writeBoolean(point.hasVibrato);
+		}
+	}
+
+	void Gp5Writer::writeMixTableChange(const MixTableChange& change, StreamWriter& writer) const
+	{
+		writer.writeSignedByte(change.instrument);
+		writeRSEInstrument(change.rse, writer);
+
+		if (isVersion500_) {
+			writer.writePadding(1);
+		}
+
+		const MixTableItem* items[] = {
+			&change.volume,
+			&change.balance,
+			&change.chorus,
+			&change.reverb,
+			&change.phaser,
+			&change.tremolo
+		};
+
+		for (auto item : items) {
+			writer.writeSignedByte(item->value);
+		}
+
+		writer.writeIntByteSizedString(change.tempoName);
+		writer.writeSignedInt(change.tempo);
+
+		for (auto item : items) {
+			if (item->value >= 0) {
+				writer.writeUnsignedByte(item->duration);
+			}
+		}
+
+		if (change.tempo >= 0) {
+			writer.writeUnsignedByte(change.tempoDuration);
+
+			if (!isVersion500_) {
+				writer.writeBoolean(change.hideTempo);
+			}
+		}
+
+		uint8_t flags = 0;
+		for (auto i = 0; i < 6; ++i) {
+			flags |= items[i]->allTracks ? 1 << i : 0;
+		}
+
+		flags |= change.useRSE ? 0x40 : 0;
+		flags |= change.wah.display ? 0x80 : 0;
+		writer.writeUnsignedByte(flags);
+		writer.writeSignedByte(change.wah.value);
+
+		if (!isVersion500_) {
+			writer.writeIntByteSizedString(change.rse.effect);
+			writer.writeIntByteSizedString(change.rse.effectCategory);
+		}
+	}
+
+	// Notes are read back in the order of the strings they are on, whatever
+	// order the beat has them in
+	void Gp5Writer::writeNotes(const Beat& beat, const Track& track, StreamWriter& writer) const
+	{
+		const Note* notes[7] = {};
+		uint8_t stringFlags = 0;
+
+		for (auto& note : beat.notes) {
+			for (size_t i = 0; i < track.strings.size(); ++i) {
+				if (track.strings[i].number == note.string) {
+					notes[i] = &note;
+					stringFlags |= 1 << (7 - note.string);
+				}
+			}
+		}
+
+		writer.writeUnsignedByte(stringFlags);
+		for (auto note : notes) {
+			if (note != nullptr) {
+				writeNote(*note, writer);
+			}
+		}
+	}
+
+	void Gp5Writer::writeNote(const Note& note, StreamWriter& writer) const
+	{
+		auto& effect = note.effect;
+		auto hasEffect = effect.bend.type != BendType::None
+			|| !effect.bend.points.empty()
+			|| effect.grace
+			|| effect.isHammer
+			|| effect.letRing
+			|| effect.isStaccato
+			|| effect.palmMute
+			|| effect.hasVibrato
+			|| effect.tremoloPicking
+			|| !effect.slides.empty()
+			|| effect.harmonic
+			|| effect.trill;
+
+		auto hasFingering = effect.leftHandFingering != Fingering::Open || effect.rightHandFingering != Fingering::Open;
+
+		// A note without its type and fret is read back as a rest on the first fret
+		uint8_t flags = 0;
+		flags |= note.durationPercent != 1.0 ? 0x01 : 0;
+		flags |= effect.isHeavyAccentuatedNote ? 0x02 : 0;
+		flags |= effect.isGhostNote ? 0x04 : 0;
+		flags |= hasEffect ? 0x08 : 0;
+		flags |= note.velocity != Note::DefaultVelocity ? 0x10 : 0;
+		flags |= note.type != NoteType::Rest || note.value != 0 ? 0x20 : 0;
+		flags |= effect.isAccentuated ? 0x40 : 0;
+		flags |= hasFingering ? 0x80 : 0;
+		writer.writeUnsignedByte(flags);
+
+		if (flags & 0x20) {
+			writer.writeUnsignedByte(static_cast<uint8_t>(note.type));
+		}
+
+		if (flags & 0x10) {
+			writer.writeSignedByte(packVelocity(note.velocity));
+		}
+
+		if (flags & 0x20) {
+			writer.writeSignedByte(static_cast<int8_t>(note.value));
+		}
+
+		if (flags & 0x80) {
+			writer.writeSignedByte(static_cast<int8_t>(effect.leftHandFingering));
+			writer.writeSignedByte(static_cast<int8_t>(effect.rightHandFingering));
+		}
+
+		if (flags & 0x01) {
+			writer.writeDouble(note.durationPercent);
+		}
+
+		writer.writeUnsignedByte(note.swapAccidentals ? 0x02 : 0);
+
+		if (flags & 0x08) {
+			writeNoteEffect(effect, writer);
+		}
+	}
+
+	void Gp5Writer::writeNoteEffect(const NoteEffect& effect, StreamWriter& writer) const
+	{
+		auto hasBend = effect.bend.type != BendType::None || !effect.bend.points.empty();
+
+		uint8_t flags1 = 0;
+		flags1 |= hasBend ? 0x01 : 0;
+		flags1 |= effect.isHammer ? 0x02 : 0;
+		flags1 |= effect.letRing ? 0x08 : 0;
+		flags1 |= effect.grace ? 0x10 : 0;
+
+		uint8_t flags2 = 0;
+		flags2 |= effect.isStaccato ? 0x01 : 0;
+		flags2 |= effect.palmMute ? 0x02 : 0;
+		flags2 |= effect.tremoloPicking ? 0x04 : 0;
+		flags2 |= !effect.slides.empty() ? 0x08 : 0;
+		flags2 |= effect.harmonic ? 0x10 : 0;
+		flags2 |= effect.trill ? 0x20 : 0;
+		flags2 |= effect.hasVibrato ? 0x40 : 0;
+
+		writer.writeUnsignedByte(flags1);
+		writer.writeUnsignedByte(flags2);
+
+		if (flags1 & 0x01) {
+			writeBend(effect.bend, writer);
+		}
+
+		if (flags1 & 0x10) {
+			writeGrace(*effect.grace, writer);
+		}
+
+		// 1, 2 and 3 stand for eighth, sixteenth and thirty-second notes
+		if (flags2 & 0x04) {
+			writer.writeSignedByte(static_cast<int8_t>(log2(effect.tremoloPicking->duration / Duration::Quarter)));
+		}
+
+		if (flags2 & 0x08) {
+			writeSlides(effect, writer);
+		}
+
+		if (flags2 & 0x10) {
+			writeHarmonic(*effect.harmonic, writer);
+		}
+
+		// 1, 2 and 3 stand for sixteenth, thirty-second and sixty-fourth notes
+		if (flags2 & 0x20) {
+			writer.writeSignedByte(static_cast<int8_t>(effect.trill->fret));
+			writer.writeSignedByte(static_cast<int8_t>(log2(effect.trill->duration / Duration::Eighth)));
+		}
+	}
+
+	void Gp5Writer::writeGrace(const Grace& grace, StreamWriter& writer) const
+	{
+		writer.writeUnsignedByte(grace.fret);
+		writer.writeSignedByte(packVelocity(grace.velocity));
+		writer.writeUnsignedByte(static_cast<uint8_t>(grace.transition));
+		writer.writeUnsignedByte(static_cast<uint8_t>(7 - log2(grace.duration)));
+
+		uint8_t flags = 0;
+		flags |= grace.isDead ? 0x01 : 0;
+		flags |= grace.isOnBeat ? 0x02 : 0;
+		writer.writeUnsignedByte(flags);
+	}
+
+	void Gp5Writer::writeSlides(const NoteEffect& effect, StreamWriter& writer) const
+	{
+		uint8_t flags = 0;
+		for (auto slide : effect.slides) {
+			switch (slide) {
+			case SlideType::ShiftSlideTo:
+				flags |= 0x01;
+				break;
+			case SlideType::LegatoSlideTo:
+				flags |= 0x02;
+				break;
+			case SlideType::OutDownwards:
+				flags |= 0x04;
+				break;
+			case SlideType::OutUpwards:
+				flags |= 0x08;
+				break;
+			case SlideType::IntoFromBelow:
+				flags |= 0x10;
+				break;
+			case SlideType::IntoFromAbove:
+				flags |= 0x20;
+				break;
+			default:
+				break;
+			}
+		}
+
+		writer.writeUnsignedByte(flags);
+	}
+
+	void Gp5Writer::writeHarmonic(const Harmonic& harmonic, StreamWriter& writer) const
+	{
+		writer.writeSignedByte(static_cast<int8_t>(harmonic.type));
+
+		if (harmonic.type == HarmonicType::Artificial) {
+			writer.writeUnsignedByte(harmonic.pitch);
+			writer.writeSignedByte(harmonic.accidental);
+			writer.writeUnsignedByte(harmonic.octave);
+		} else if (harmonic.type == HarmonicType::Tapped) {
+			writer.writeUnsignedByte(harmonic.fret);
+		}
+	}
+}
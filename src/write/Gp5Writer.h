@@ -0,0 +1,100 @@
+#pragma once
+
+#include "../GpVersion.h"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace libgp
+{
+	struct Song;
+	struct SongInfo;
+	struct Lyrics;
+	struct PageSetup;
+	struct Tempo;
+	struct RSEMasterEffect;
+	struct MeasureHeader;
+	struct Marker;
+	struct Color;
+	struct Track;
+	struct TrackRSE;
+	struct RSEInstrument;
+	struct RSEEqualizer;
+	struct Measure;
+	struct Voice;
+	struct Beat;
+	struct BeatEffect;
+	struct BeatStroke;
+	struct Bend;
+	struct MixTableChange;
+	struct Duration;
+	struct Chord;
+	struct Note;
+	struct NoteEffect;
+	struct Grace;
+	struct Harmonic;
+	class StreamWriter;
+
+	// Writes songs as Guitar Pro 5 (.gp5) files, field for field in the order
+	// Gp5Reader reads them. The whole file is built in one growing buffer and
+	// handed over, or written to disk, in a single call.
+	//
+	// Reading a written file back gives the same song, and writing that song
+	// again gives the same bytes. What the reader does not keep is written the
+	// way Guitar Pro writes it for a new song: the settings of MIDI channels no
+	// track plays on, the key's minor flag and the RSE fields the reader skips.
+	class Gp5Writer
+	{
+	public:
+		// Writes version 5.10 files
+		Gp5Writer();
+		// Writes files of the given version, which must be 5.00 or 5.10
+		explicit Gp5Writer(GpVersion version);
+
+		const GpVersion& version() const noexcept;
+
+		std::vector<std::byte> write(const Song& song) const;
+		void writeToFile(const Song& song, const std::string& path) const;
+
+	private:
+		GpVersion version_;
+		bool isVersion500_;
+
+		void writeVersion(StreamWriter& writer) const;
+		void writeSongInfo(const SongInfo& info, StreamWriter& writer) const;
+		void writeLyrics(const Lyrics& lyrics, StreamWriter& writer) const;
+		void writeMasterEffect(const RSEMasterEffect& effect, StreamWriter& writer) const;
+		void writePageSetup(const PageSetup& pageSetup, StreamWriter& writer) const;
+		void writeTempo(const Tempo& tempo, StreamWriter& writer) const;
+		void writeMidiChannels(const Song& song, StreamWriter& writer) const;
+		void writeDirectionSigns(const Song& song, StreamWriter& writer) const;
+		void writeMeasureHeaders(const Song& song, StreamWriter& writer) const;
+		void writeMeasureHeader(const MeasureHeader& header, const MeasureHeader* previous, StreamWriter& writer) const;
+		void writeMarker(const Marker& marker, StreamWriter& writer) const;
+		void writeColor(const Color& color, StreamWriter& writer) const;
+		void writeTracks(const Song& song, StreamWriter& writer) const;
+		void writeTrack(const Track& track, uint32_t number, StreamWriter& writer) const;
+		void writeTrackRSE(const TrackRSE& rse, StreamWriter& writer) const;
+		void writeRSEInstrument(const RSEInstrument& instrument, StreamWriter& writer) const;
+		void writeRSEEqualizer(const RSEEqualizer& equalizer, uint8_t numKnobs, StreamWriter& writer) const;
+		void writeMeasures(const Song& song, StreamWriter& writer) const;
+		void writeMeasure(const Measure& measure, StreamWriter& writer) const;
+		void writeVoice(const Voice& voice, StreamWriter& writer) const;
+		void writeBeat(const Beat& beat, const Track& track, StreamWriter& writer) const;
+		void writeDuration(const Duration& duration, StreamWriter& writer) const;
+		void writeChord(const Chord& chord, StreamWriter& writer) const;
+		void writeOldChord(const Chord& chord, StreamWriter& writer) const;
+		void writeNewChord(const Chord& chord, StreamWriter& writer) const;
+		void writeBeatEffect(const BeatEffect& effect, StreamWriter& writer) const;
+		void writeBeatStroke(const BeatStroke& stroke, StreamWriter& writer) const;
+		void writeBend(const Bend& bend, StreamWriter& writer) const;
+		void writeMixTableChange(const MixTableChange& change, StreamWriter& writer) const;
+		void writeNotes(const Beat& beat, const Track& track, StreamWriter& writer) const;
+		void writeNote(const Note& note, StreamWriter& writer) const;
+		void writeNoteEffect(const NoteEffect& effect, StreamWriter& writer) const;
+		void writeGrace(const Grace& grace, StreamWriter& writer) const;
+		void writeSlides(const NoteEffect& effect, StreamWriter& writer) const;
+		void writeHarmonic(const Harmonic& harmonic, StreamWriter& writer) const;
+	};
+}
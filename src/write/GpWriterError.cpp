@@ -0,0 +1,14 @@
+#include "GpWriterError.h"
+
+namespace libgp
+{
+	GpWriterError::GpWriterError(const std::string& message) :
+		message_(message)
+	{
+	}
+
+	const char* GpWriterError::what() const noexcept
+	{
+		return message_.c_str();
+	}
+}
@@ -0,0 +1,18 @@
+#pragma once
+
+#include <exception>
+#include <string>
+
+namespace libgp
+{
+	class GpWriterError : public std::exception
+	{
+	public:
+		explicit GpWriterError(const std::string& message = "Guitar Pro writer error");
+
+		const char* what() const noexcept override;
+
+	private:
+		std::string message_;
+	};
+}
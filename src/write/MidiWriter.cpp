@@ -0,0 +1,485 @@
+#include "MidiWriter.h"
+#include "GpWriterError.h"
+#include "StreamWriter.h"
+#include "../Model.h"
+#include "../TempoMap.h"
+#include "../Timeline.h"
+#include <algorithm>
+#include <array>
+#include <fstream>
+#include <initializer_list>
+#include <limits>
+#include <string_view>
+
+namespace libgp
+{
+	namespace
+	{
+		const uint16_t TicksPerQuarter = Duration::QuarterTime;
+		const size_t MaxStrings = 7;
+
+		const uint8_t NoteOn = 0x90;
+		const uint8_t ControlChange = 0xB0;
+		const uint8_t ProgramChange = 0xC0;
+
+		const uint8_t BankSelect = 0x00;
+		const uint8_t Volume = 0x07;
+		const uint8_t Pan = 0x0A;
+		const uint8_t Reverb = 0x5B;
+		const uint8_t Chorus = 0x5D;
+
+		const uint8_t TrackName = 0x03;
+		const uint8_t EndOfTrack = 0x2F;
+		const uint8_t SetTempo = 0x51;
+		const uint8_t TimeSignatureEvent = 0x58;
+
+		void writeBigEndian(StreamWriter& writer, uint32_t value, size_t numBytes)
+		{
+			for (auto i = numBytes; i > 0; --i) {
+				writer.writeUnsignedByte(static_cast<uint8_t>(value >> ((i - 1) * 8)));
+			}
+		}
+
+		// Seven bits per byte, most significant first, with the top bit set on
+		// every byte but the last
+		void writeVariableLength(StreamWriter& writer, uint32_t value)
+		{
+			uint8_t bytes[5];
+			size_t size = 0;
+			do {
+				bytes[size++] = value & 0x7F;
+				value >>= 7;
+			} while (value > 0);
+
+			while (size > 1) {
+				writer.writeUnsignedByte(bytes[--size] | 0x80);
+			}
+
+			writer.writeUnsignedByte(bytes[0]);
+		}
+
+		uint8_t toDataByte(int32_t value) noexcept
+		{
+			return static_cast<uint8_t>(std::clamp(value, 0, 0x7F));
+		}
+
+		uint8_t log2(uint32_t value) noexcept
+		{
+			uint8_t exponent = 0;
+			while (value > 1) {
+				value >>= 1;
+				++exponent;
+			}
+
+			return exponent;
+		}
+
+		// Writes the events of one track chunk, given in order of their ticks,
+		// as delta times with running status. The length of the chunk is filled
+		// in when it is closed.
+		class TrackChunk
+		{
+		public:
+			explicit TrackChunk(StreamWriter& writer) :
+				writer_(writer),
+				tick_(0),
+				status_(0)
+			{
+				writer_.writeString("MTrk");
+				lengthPosition_ = writer_.position();
+				writer_.writeUnsignedInt(0);
+			}
+
+			uint32_t tick() const noexcept { return tick_; }
+
+			void writeEvent(uint32_t tick, uint8_t status, uint8_t data)
+			{
+				writeStatus(tick, status);
+				writer_.writeUnsignedByte(data);
+			}
+
+			void writeEvent(uint32_t tick, uint8_t status, uint8_t data1, uint8_t data2)
+			{
+				writeStatus(tick, status);
+				writer_.writeUnsignedByte(data1);
+				writer_.writeUnsignedByte(data2);
+			}
+
+			void writeMeta(uint32_t tick, uint8_t type, std::string_view data)
+			{
+				writeMetaHeader(tick, type, data.size());
+				writer_.writeString(data);
+			}
+
+			void writeMeta(uint32_t tick, uint8_t type, std::initializer_list<uint8_t> data)
+			{
+				writeMetaHeader(tick, type, data.size());
+				for (auto byte : data) {
+					writer_.writeUnsignedByte(byte);
+				}
+			}
+
+			void close(uint32_t tick)
+			{
+				writeMeta(std::max(tick, tick_), EndOfTrack, std::string_view());
+
+				auto length = static_cast<uint32_t>(writer_.position() - lengthPosition_ - 4);
+				std::array<uint8_t, 4> bytes = {
+					static_cast<uint8_t>(length >> 24),
+					static_cast<uint8_t>(length >> 16),
+					static_cast<uint8_t>(length >> 8),
+					static_cast<uint8_t>(length)
+				};
+				writer_.patchRaw(lengthPosition_, bytes);
+			}
+
+		private:
+			StreamWriter& writer_;
+			size_t lengthPosition_;
+			uint32_t tick_;
+			uint8_t status_;
+
+			void writeDelta(uint32_t tick)
+			{
+				writeVariableLength(writer_, tick - tick_);
+				tick_ = tick;
+			}
+
+			void writeStatus(uint32_t tick, uint8_t status)
+			{
+				writeDelta(tick);
+				if (status != status_) {
+					writer_.writeUnsignedByte(status);
+					status_ = status;
+				}
+			}
+
+			// Meta events cancel the running status
+			void writeMetaHeader(uint32_t tick, uint8_t type, size_t size)
+			{
+				writeDelta(tick);
+				writer_.writeUnsignedByte(0xFF);
+				writer_.writeUnsignedByte(type);
+				writeVariableLength(writer_, static_cast<uint32_t>(size));
+				status_ = 0;
+			}
+		};
+
+		// Steps through the beats of one voice of a track, measure after measure
+		// in the order of the song's timeline
+		class BeatCursor
+		{
+		public:
+			BeatCursor(const Track& track, const Timeline& timeline, size_t voice) :
+				measures_(track.measures),
+				entries_(timeline.entries),
+				voice_(voice),
+				entry_(0),
+				beat_(0)
+			{
+				settle();
+			}
+
+			const Beat* get() const noexcept
+			{
+				return entry_ < entries_.size()
+					? &measure().voices[voice_].beats[beat_]
+					: nullptr;
+			}
+
+			// The tick the beat is played at on the timeline
+			uint32_t start() const noexcept
+			{
+				auto& measure = this->measure();
+				return measure.voices[voice_].beats[beat_].start - measure.header.start + entries_[entry_].start;
+			}
+
+			void next()
+			{
+				++beat_;
+				settle();
+			}
+
+		private:
+			const ArenaVector<Measure>& measures_;
+			const std::vector<TimelineEntry>& entries_;
+			size_t voice_;
+			size_t entry_;
+			size_t beat_;
+
+			const Measure& measure() const noexcept { return measures_[entries_[entry_].measure]; }
+
+			void settle()
+			{
+				while (entry_ < entries_.size()
+					&& (entries_[entry_].measure >= measures_.size()
+						|| voice_ >= measure().voices.size()
+						|| beat_ >= measure().voices[voice_].beats.size())) {
+					++entry_;
+					beat_ = 0;
+				}
+			}
+		};
+
+		// The note sounding on a string of a voice, and the tick it stops at
+		struct PlayingNote
+		{
+			bool isPlaying = false;
+			uint8_t key = 0;
+			uint32_t end = 0;
+		};
+
+		uint32_t calcNoteLength(const Beat& beat, const Note& note)
+		{
+			auto length = static_cast<uint32_t>(beat.duration.calcTime() * note.durationPercent);
+
+			// Dead notes are muted right away
+			if (note.type == NoteType::Dead) {
+				length = std::min<uint32_t>(length, TicksPerQuarter / 16);
+			}
+
+			return std::max<uint32_t>(length, 1);
+		}
+
+		size_t countNotes(const Track& track)
+		{
+			size_t numNotes = 0;
+			for (auto& measure : track.measures) {
+				for (auto& voice : measure.voices) {
+					for (auto& beat : voice.beats) {
+						numNotes += beat.notes.size();
+					}
+				}
+			}
+
+			return numNotes;
+		}
+	}
+
+	std::vector<std::byte> MidiWriter::write(const Song& song) const
+	{
+		// A note takes two events of four bytes at most, and running status
+		// mostly saves one of them
+		size_t numNotes = 0;
+		for (auto& track : song.tracks) {
+			numNotes += countNotes(track);
+		}
+
+		StreamWriter writer;
+		writer.reserve(64 + song.tracks.size() * 64 + song.measureHeaders.size() * 16 + numNotes * 8);
+
+		writer.writeString("MThd");
+		writeBigEndian(writer, 6, 4);
+		writeBigEndian(writer, 1, 2);
+		writeBigEndian(writer, static_cast<uint32_t>(song.tracks.size() + 1), 2);
+		writeBigEndian(writer, TicksPerQuarter, 2);
+
+		writeTempoTrack(song, writer);
+		for (auto& track : song.tracks) {
+			writeTrack(song, track, writer);
+		}
+
+		return writer.release();
+	}
+
+	void MidiWriter::writeToFile(const Song& song, const std::string& path) const
+	{
+		auto data = write(song);
+
+		std::ofstream file(path, std::ios::binary | std::ios::trunc);
+		if (!file) {
+			throw GpWriterError("Unable to open file: " + path);
+		}
+
+		file.write(reinterpret_cast<const char*>(data.data()), data.size());
+		if (!file) {
+			throw GpWriterError("Unable to write file: " + path);
+		}
+	}
+
+	// Ticks count from the start of the first measure. The time signature is
+	// set where a measure changes it, and the tempo where the tempo map has a
+	// segment, which takes in the changes of the mix tables within measures.
+	void MidiWriter::writeTempoTrack(const Song& song, StreamWriter& writer) const
+	{
+		TrackChunk chunk(writer);
+		if (!song.title.empty()) {
+			chunk.writeMeta(0, TrackName, song.title);
+		}
+
+		auto songStart = !song.measureHeaders.empty() ? song.measureHeaders[0].start : 0;
+		auto& timeline = song.timeline();
+		auto tempoMap = TempoMap::fromSong(song);
+
+		// Writes the tempo of the segments that start before the tick
+		size_t segment = 0;
+		auto writeTempos = [&](uint32_t tick) {
+			for (; segment < tempoMap.size() && tempoMap.segmentStart(segment) < tick; ++segment) {
+				auto tempo = tempoMap.microsecondsPerQuarter(segment);
+				chunk.writeMeta(std::max(tempoMap.segmentStart(segment), songStart) - songStart, SetTempo, {
+					static_cast<uint8_t>(tempo >> 16),
+					static_cast<uint8_t>(tempo >> 8),
+					static_cast<uint8_t>(tempo)
+				});
+			}
+		};
+
+		const MeasureHeader* previous = nullptr;
+		for (auto& entry : timeline.entries) {
+			auto& header = song.measureHeaders[entry.measure];
+			auto& timeSignature = header.timeSignature;
+
+			if (previous == nullptr
+				|| timeSignature.numerator != previous->timeSignature.numerator
+				|| timeSignature.denominator.value != previous->timeSignature.denominator.value) {
+				writeTempos(entry.start);
+				chunk.writeMeta(entry.start - songStart, TimeSignatureEvent, {
+					static_cast<uint8_t>(timeSignature.numerator),
+					log2(timeSignature.denominator.value),
+					24,
+					8
+				});
+			}
+
+			previous = &header;
+		}
+
+		writeTempos(std::numeric_limits<uint32_t>::max());
+		chunk.close(timeline.end - songStart);
+	}
+
+	// The voices of the track are merged as they are written: at each step the
+	// beats that start first are played, after the notes that stop by then are
+	// released, so no list of events is built or sorted. Notes are released
+	// with a note on of no velocity, which running status covers as well.
+	void MidiWriter::writeTrack(const Song& song, const Track& track, StreamWriter& writer) const
+	{
+		TrackChunk chunk(writer);
+		chunk.writeMeta(0, TrackName, track.name);
+
+		uint8_t channel = track.isPercussionTrack ? 9 : 0;
+		if (track.channel) {
+			auto& midiChannel = *track.channel;
+			channel = midiChannel.channel & 0x0F;
+			chunk.writeEvent(0, ControlChange | channel, BankSelect, toDataByte(midiChannel.bank));
+			chunk.writeEvent(0, ProgramChange | channel, toDataByte(midiChannel.instrument));
+			chunk.writeEvent(0, ControlChange | channel, Volume, toDataByte(midiChannel.volume));
+			chunk.writeEvent(0, ControlChange | channel, Pan, toDataByte(midiChannel.balance));
+			chunk.writeEvent(0, ControlChange | channel, Reverb, toDataByte(midiChannel.reverb));
+			chunk.writeEvent(0, ControlChange | channel, Chorus, toDataByte(midiChannel.chorus));
+		}
+
+		auto songStart = !song.measureHeaders.empty() ? song.measureHeaders[0].start : 0;
+		auto transpose = track.isPercussionTrack ? 0 : static_cast<int32_t>(track.offset);
+
+		auto& timeline = song.timeline();
+		BeatCursor cursors[Measure::MaxVoices] = { BeatCursor(track, timeline, 0), BeatCursor(track, timeline, 1) };
+		PlayingNote playing[Measure::MaxVoices][MaxStrings] = {};
+
+		auto releaseNotes = [&](uint32_t until) {
+			while (true) {
+				PlayingNote* first = nullptr;
+				for (auto& voice : playing) {
+					for (auto& note : voice) {
+						if (note.isPlaying && note.end <= until && (first == nullptr || note.end < first->end)) {
+							first = &note;
+						}
+					}
+				}
+
+				if (first == nullptr) {
+					return;
+				}
+
+				chunk.writeEvent(std::max(first->end, chunk.tick()), NoteOn | channel, first->key, 0);
+				first->isPlaying = false;
+			}
+		};
+
+		auto findString = [&](uint8_t number) -> const GuitarString* {
+			for (auto& string : track.strings) {
+				if (string.number == number) {
+					return &string;
+				}
+			}
+
+			return nullptr;
+		};
+
+		while (true) {
+			const Beat* beats[Measure::MaxVoices];
+			uint32_t starts[Measure::MaxVoices];
+			uint32_t start = std::numeric_limits<uint32_t>::max();
+			for (size_t i = 0; i < Measure::MaxVoices; ++i) {
+				beats[i] = cursors[i].get();
+				if (beats[i] != nullptr) {
+					starts[i] = cursors[i].start();
+					start = std::min(start, starts[i]);
+				}
+			}
+
+			if (start == std::numeric_limits<uint32_t>::max()) {
+				break;
+			}
+
+			for (size_t i = 0; i < Measure::MaxVoices; ++i) {
+				if (beats[i] != nullptr && starts[i] != start) {
+					beats[i] = nullptr;
+				}
+			}
+
+			auto tick = start >= songStart ? start - songStart : 0;
+
+			// Tied notes keep the note they continue sounding
+			for (size_t i = 0; i < Measure::MaxVoices; ++i) {
+				if (beats[i] == nullptr) {
+					continue;
+				}
+
+				for (auto& note : beats[i]->notes) {
+					if (note.type == NoteType::Tie && note.string >= 1 && note.string <= MaxStrings) {
+						auto& tied = playing[i][note.string - 1];
+						if (tied.isPlaying) {
+							tied.end = std::max(tied.end, tick + calcNoteLength(*beats[i], note));
+						}
+					}
+				}
+			}
+
+			releaseNotes(tick);
+
+			for (size_t i = 0; i < Measure::MaxVoices; ++i) {
+				if (beats[i] == nullptr) {
+					continue;
+				}
+
+				for (auto& note : beats[i]->notes) {
+					auto string = findString(note.string);
+					if (note.type == NoteType::Rest || string == nullptr || note.string > MaxStrings) {
+						continue;
+					}
+
+					auto& slot = playing[i][note.string - 1];
+					if (note.type == NoteType::Tie && slot.isPlaying) {
+						continue;
+					}
+
+					// A note cut short by the next one on its string
+					if (slot.isPlaying) {
+						chunk.writeEvent(tick, NoteOn | channel, slot.key, 0);
+					}
+
+					slot.isPlaying = true;
+					slot.key = toDataByte(string->value + note.value + transpose);
+					slot.end = tick + calcNoteLength(*beats[i], note);
+					chunk.writeEvent(tick, NoteOn | channel, slot.key, std::clamp<uint8_t>(note.velocity, 1, 0x7F));
+				}
+
+				cursors[i].next();
+			}
+		}
+
+		releaseNotes(std::numeric_limits<uint32_t>::max());
+		chunk.close(chunk.tick());
+	}
+}
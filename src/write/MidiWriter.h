@@ -0,0 +1,31 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+namespace libgp
+{
+	struct Song;
+	struct Track;
+	class StreamWriter;
+
+	// Writes songs as multi-track (format 1) Standard MIDI Files. The first
+	// track carries the time signatures of the measure headers and the tempo
+	// changes of the song's TempoMap, including those of mix tables within a
+	// measure. Each track of the song follows as a track of its own, played on
+	// its MIDI channel at Duration::QuarterTime ticks per quarter note.
+	//
+	// Measures are played in the order of the song's timeline, with repeats
+	// and jumps unrolled.
+	class MidiWriter
+	{
+	public:
+		std::vector<std::byte> write(const Song& song) const;
+		void writeToFile(const Song& song, const std::string& path) const;
+
+	private:
+		void writeTempoTrack(const Song& song, StreamWriter& writer) const;
+		void writeTrack(const Song& song, const Track& track, StreamWriter& writer) const;
+	};
+}
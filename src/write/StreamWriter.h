@@ -0,0 +1,101 @@
+#pragma once
+
+#include "../ByteOrder.h"
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace libgp
+{
+	// Appends little-endian primitives to a growing block of memory; the writing
+	// counterpart of StreamReader
+	class StreamWriter
+	{
+	public:
+		const std::vector<std::byte>& data() const noexcept { return data_; }
+		std::vector<std::byte> release() noexcept { return std::move(data_); }
+		size_t position() const noexcept { return data_.size(); }
+
+		void reserve(size_t size) { data_.reserve(size); }
+
+		void writeSignedByte(int8_t value) { write(value); }
+		void writeUnsignedByte(uint8_t value) { write(value); }
+
+		void writeSignedShort(int16_t value) { write(value); }
+		void writeUnsignedShort(uint16_t value) { write(value); }
+
+		void writeSignedInt(int32_t value) { write(value); }
+		void writeUnsignedInt(uint32_t value) { write(value); }
+
+		void writeDouble(double value) { write(value); }
+
+		void writeBoolean(bool value) { writeUnsignedByte(value ? 1 : 0); }
+
+		// Writes any trivially copyable value as it is laid out in memory, with
+		// numbers little-endian
+		template<typename T>
+		void writeRaw(const T& value)
+		{
+			static_assert(std::is_trivially_copyable<T>::value, "Raw writes need trivially copyable types");
+			write(value);
+		}
+
+		// Overwrites a value written earlier, for offsets only known later on
+		template<typename T>
+		void patchRaw(size_t position, const T& value)
+		{
+			static_assert(std::is_trivially_copyable<T>::value, "Raw writes need trivially copyable types");
+			auto ordered = toLittleEndian(value);
+			std::memcpy(data_.data() + position, &ordered, sizeof(T));
+		}
+
+		void writeString(std::string_view text)
+		{
+			auto bytes = reinterpret_cast<const std::byte*>(text.data());
+			data_.insert(data_.end(), bytes, bytes + text.size());
+		}
+
+		void writeIntSizedString(std::string_view text)
+		{
+			writeUnsignedInt(static_cast<uint32_t>(text.size()));
+			writeString(text);
+		}
+
+		// Writes a length byte followed by a field of the given size, as
+		// StreamReader::readByteSizedString reads it back
+		void writeByteSizedString(std::string_view text, size_t size)
+		{
+			text = text.substr(0, std::min<size_t>(size, 255));
+			writeUnsignedByte(static_cast<uint8_t>(text.size()));
+			writeString(text);
+			writePadding(size - text.size());
+		}
+
+		// Writes the size of what follows as an int, then the string with its length byte
+		void writeIntByteSizedString(std::string_view text)
+		{
+			text = text.substr(0, 255);
+			writeUnsignedInt(static_cast<uint32_t>(text.size() + 1));
+			writeUnsignedByte(static_cast<uint8_t>(text.size()));
+			writeString(text);
+		}
+
+		void writePadding(size_t numBytes) { data_.insert(data_.end(), numBytes, std::byte(0)); }
+
+	private:
+		std::vector<std::byte> data_;
+
+		template<typename T>
+		void write(const T& value)
+		{
+			auto ordered = toLittleEndian(value);
+			auto bytes = reinterpret_cast<const std::byte*>(&ordered);
+			data_.insert(data_.end(), bytes, bytes + sizeof(T));
+		}
+	};
+}
@@ -1,13 +1,57 @@
 #include "catch2/catch.hpp"
+#include "../src/read/Gp3Reader.h"
+#include "../src/read/Gp4Reader.h"
 #include "../src/read/Gp5Reader.h"
+#include "../src/read/Gp5PushReader.h"
+#include "../src/read/GpxReader.h"
 #include "../src/Model.h"
+#include "../src/NoteColumns.h"
+#include "../src/NoteIndex.h"
 #include "../src/GpVersion.h"
+#include "../src/TempoMap.h"
+#include "../src/ThreadPool.h"
+#include "../src/Timeline.h"
+#include "../src/read/BatchReader.h"
+#include "../src/read/LazySong.h"
+#include "../src/read/CacheReader.h"
+#include "../src/write/CacheWriter.h"
+#include "../src/write/Gp5Writer.h"
+#include "../src/write/MidiWriter.h"
+#include "../src/write/GpWriterError.h"
+#include "../src/write/StreamWriter.h"
+#include "../src/read/StreamReader.h"
+#include "../src/read/GpReaderError.h"
+#include "../src/read/MappedFile.h"
+#include "../src/read/ParseObserver.h"
+#include "../src/read/ReaderRegistry.h"
+#include "../src/read/XmlReader.h"
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstring>
 #include <fstream>
 #include <memory>
+#include <string>
+#include <utility>
+#include <vector>
 
 using namespace libgp;
 
 std::unique_ptr<Song> createExpectedSong();
+std::vector<std::byte> createOldVersionFile(uint8_t major);
+std::vector<std::byte> createVersion500File();
+std::unique_ptr<Song> createMeasureHeaders(size_t numMeasures);
+size_t directionSignsOffset(const MappedFile& file);
+size_t trackCountOffset(const MappedFile& file);
+size_t firstMeasureHeaderOffset(const MappedFile& file);
+
+// Keeps the stats of every phase it is told about, in order
+struct RecordingObserver : ParseObserver
+{
+	std::vector<ParsePhaseStats> phases;
+
+	void onPhase(const ParsePhaseStats& stats) override { phases.push_back(stats); }
+};
 
 SCENARIO("Can parse a Guitar Pro version string")
 {
@@ -42,6 +86,123 @@ SCENARIO("Can parse a Guitar Pro version string")
 	}
 }
 
+SCENARIO("Can read primitives from a byte buffer")
+{
+	GIVEN("A buffer holding an int, a short and a byte-sized string")
+	{
+		const std::byte data[] = {
+			std::byte(0x2A), std::byte(0x00), std::byte(0x00), std::byte(0x00),
+			std::byte(0xFF), std::byte(0xFF),
+			std::byte(0x02), std::byte('g'), std::byte('p')
+		};
+
+		StreamReader reader(data, sizeof(data));
+
+		WHEN("The values are read")
+		{
+			auto intValue = reader.readUnsignedInt();
+			auto shortValue = reader.readSignedShort();
+			auto strValue = reader.readByteSizedString();
+
+			THEN("The values are correct and the buffer is consumed")
+			{
+				REQUIRE(intValue == 42);
+				REQUIRE(shortValue == -1);
+				REQUIRE(strValue == "gp");
+				REQUIRE(reader.remaining() == 0);
+			}
+
+			THEN("Reading past the end fails the reader, which then only reads zeros")
+			{
+				REQUIRE_FALSE(reader.failed());
+				REQUIRE(reader.readUnsignedByte() == 0);
+				REQUIRE(reader.failed());
+				REQUIRE(reader.error().code == ParseErrorCode::UnexpectedEnd);
+				REQUIRE(reader.error().offset == 9);
+
+				reader.skip(1);
+				REQUIRE(reader.readUnsignedInt() == 0);
+				REQUIRE(reader.readByteSizedString().empty());
+				REQUIRE(reader.error().offset == 9);
+			}
+		}
+	}
+}
+
+SCENARIO("Can tokenize an XML document")
+{
+	GIVEN("A document with attributes, entities, CDATA and an empty element")
+	{
+		std::string document = "<?xml version=\"1.0\"?><Score id=\"3\"><Title><![CDATA[a < b]]></Title>"
+			"<Empty/><Text>x &amp; y</Text><Deep><Inner>z</Inner></Deep></Score>";
+		XmlReader xml(document.data(), document.size());
+
+		WHEN("The children of the root are read")
+		{
+			REQUIRE(xml.nextChild(0));
+			REQUIRE(xml.name() == "Score");
+			REQUIRE(xml.attribute("id") == "3");
+
+			std::vector<std::pair<std::string_view, std::string_view>> children;
+			while (xml.nextChild(1)) {
+				auto name = xml.name();
+				children.emplace_back(name, name != "Deep" ? xml.readText() : std::string_view());
+			}
+
+			THEN("Each child and its text is reported once, with entities decoded")
+			{
+				REQUIRE(children.size() == 4);
+				REQUIRE(children[0].second == "a < b");
+				REQUIRE(children[1].first == "Empty");
+				REQUIRE(children[1].second.empty());
+				REQUIRE(children[2].second == "x & y");
+				REQUIRE(children[3].first == "Deep");
+				REQUIRE(xml.next() == XmlReader::Token::EndOfDocument);
+			}
+		}
+	}
+
+	GIVEN("A document with mismatched tags")
+	{
+		std::string document = "<a><b></a></b>";
+		XmlReader xml(document.data(), document.size());
+
+		THEN("An exception is thrown")
+		{
+			REQUIRE_THROWS_AS(xml.skipElement(), GpReaderError);
+		}
+	}
+}
+
+SCENARIO("Can memory-map a file")
+{
+	GIVEN("A .gp5 file")
+	{
+		WHEN("The file is mapped")
+		{
+			MappedFile file("./resources/test.gp5");
+
+			THEN("The mapping covers the whole file")
+			{
+				std::ifstream fileStream("./resources/test.gp5", std::ios::binary | std::ios::ate);
+				REQUIRE(file.size() == static_cast<size_t>(fileStream.tellg()));
+				REQUIRE(file.data()[0] == std::byte(24));
+			}
+		}
+	}
+
+	GIVEN("A missing file")
+	{
+		WHEN("The file is mapped")
+		{
+			THEN("An exception is thrown")
+			{
+				REQUIRE_THROWS_AS(MappedFile("./resources/missing.gp5"), GpReaderError);
+			}
+		}
+	}
+}
+
 SCENARIO("Can read a Guitar Pro 5 file")
 {
 	GIVEN("A .gp5 file")
@@ -98,48 +259,2068 @@ SCENARIO("Can read a Guitar Pro 5 file")
 			{
 				REQUIRE(song->measureHeaders == expectedSong->measureHeaders);
 			}
+
+			THEN("The tracks are correct")
+			{
+				REQUIRE(song->tracks.size() == 2);
+				REQUIRE(song->tracks[0].name == "Steel Guitar");
+				REQUIRE(song->tracks[0].strings.size() == 6);
+				REQUIRE(song->tracks[1].name == "Drumkit");
+				REQUIRE(song->tracks[1].isPercussionTrack);
+			}
+
+			THEN("The measures are correct")
+			{
+				auto& measure = song->tracks[0].measures.at(0);
+				auto& beats = measure.voices[0].beats;
+				REQUIRE(beats.size() == 4);
+
+				for (auto i = 0; i < 4; ++i) {
+					REQUIRE(beats[i].start == Duration::QuarterTime * (i + 1));
+					REQUIRE(beats[i].duration.value == 4);
+					REQUIRE(beats[i].notes.size() == 1);
+					REQUIRE(beats[i].notes[0].string == 6);
+					REQUIRE(beats[i].notes[0].value == i);
+				}
+
+				REQUIRE(measure.voices[1].beats.at(0).status == BeatStatus::Empty);
+			}
+
+			THEN("The notes can be laid out in columns")
+			{
+				auto columns = NoteColumns::fromTrack(song->tracks[0]);
+				REQUIRE(columns.size() == 4);
+
+				for (uint32_t i = 0; i < 4; ++i) {
+					REQUIRE(columns.start[i] == Duration::QuarterTime * (i + 1));
+					REQUIRE(columns.duration[i] == 960);
+					REQUIRE(columns.measure[i] == 0);
+					REQUIRE(columns.voice[i] == 0);
+					REQUIRE(columns.string[i] == 6);
+					REQUIRE(columns.value[i] == i);
+					REQUIRE(columns.flags[i] == 0);
+				}
+
+				REQUIRE(columns.bends.find(0) == nullptr);
+			}
+
+			THEN("The song is allocated from its own arena")
+			{
+				auto arena = &song->storage->arena();
+				REQUIRE(song->tracks.get_allocator().arena() == arena);
+				REQUIRE(song->tracks[0].measures[0].voices[0].beats.get_allocator().arena() == arena);
+				REQUIRE(Arena::current() == nullptr);
+
+				auto copy = song->tracks[0].strings;
+				REQUIRE(copy.get_allocator().arena() == nullptr);
+
+				// A song built by hand has no storage and uses the heap
+				auto builtSong = createExpectedSong();
+				REQUIRE(builtSong->storage == nullptr);
+				REQUIRE(builtSong->tracks.get_allocator().arena() == nullptr);
+			}
+		}
+
+		WHEN("The file is read one track per task")
+		{
+			ThreadPool pool(2);
+			Gp5Reader reader;
+			reader.setThreadPool(&pool);
+			auto song = reader.readSong(fileStream);
+
+			Gp5Reader sequentialReader;
+			auto expectedSong = sequentialReader.readSongFromFile("./resources/test.gp5");
+
+			THEN("The measures match a sequential read")
+			{
+				REQUIRE(song->measureHeaders == expectedSong->measureHeaders);
+				for (size_t i = 0; i < song->tracks.size(); ++i) {
+					auto columns = NoteColumns::fromTrack(song->tracks[i]);
+					auto expectedColumns = NoteColumns::fromTrack(expectedSong->tracks[i]);
+					REQUIRE(columns.start == expectedColumns.start);
+					REQUIRE(columns.value == expectedColumns.value);
+					REQUIRE(song->tracks[i].measures[0].voices[1].beats.size() == expectedSong->tracks[i].measures[0].voices[1].beats.size());
+				}
+			}
+		}
+
+		WHEN("The file is read lazily")
+		{
+			Gp5Reader reader;
+			auto lazySong = reader.readLazySong(fileStream);
+			auto expectedSong = createExpectedSong();
+
+			THEN("Only the tracks asked for are decoded")
+			{
+				REQUIRE(lazySong->song().title == "title");
+				REQUIRE(lazySong->song().measureHeaders == expectedSong->measureHeaders);
+				REQUIRE(lazySong->numTracks() == 2);
+				REQUIRE_FALSE(lazySong->isLoaded(0));
+				REQUIRE(lazySong->song().tracks[0].measures.empty());
+
+				auto& track = lazySong->track(0);
+				REQUIRE(lazySong->isLoaded(0));
+				REQUIRE_FALSE(lazySong->isLoaded(1));
+				REQUIRE(track.measures.at(0).voices[0].beats.size() == 4);
+				REQUIRE(track.measures[0].voices[0].beats[3].notes[0].value == 3);
+
+				auto song = lazySong->release();
+				REQUIRE(song->tracks[1].measures.size() == 1);
+			}
+		}
+
+		WHEN("The measures are indexed")
+		{
+			MappedFile file("./resources/test.gp5");
+			Gp5Reader reader;
+			auto index = reader.indexMeasures(file.data(), file.size());
+
+			THEN("The blocks are contiguous and end with the file")
+			{
+				REQUIRE(index.numTracks == 2);
+				REQUIRE(index.numMeasures() == 1);
+				REQUIRE(index.begin(0, 0) < index.end(0, 0));
+				REQUIRE(index.end(0, 0) == index.begin(0, 1));
+				REQUIRE(index.end(0, 1) == file.size());
+			}
+		}
+
+		WHEN("Only the header is read")
+		{
+			Gp5Reader reader;
+			auto info = reader.readHeader(fileStream);
+			auto expectedSong = createExpectedSong();
+
+			THEN("The song info is correct")
+			{
+				REQUIRE(info.title == expectedSong->title);
+				REQUIRE(info.artist == expectedSong->artist);
+				REQUIRE(info.lyrics == expectedSong->lyrics);
+				REQUIRE(info.pageSetup == expectedSong->pageSetup);
+				REQUIRE(info.tempo == expectedSong->tempo);
+				REQUIRE(info.keySignature == expectedSong->keySignature);
+				REQUIRE(info.octave == expectedSong->octave);
+			}
+		}
+
+		WHEN("Only the header of a truncated file is read")
+		{
+			// The header of the test file ends where the MIDI channel table starts
+			std::vector<std::byte> data(499);
+			fileStream.read(reinterpret_cast<char*>(data.data()), data.size());
+
+			Gp5Reader reader;
+
+			THEN("The header can be read but the song cannot")
+			{
+				REQUIRE(reader.readHeader(data.data(), data.size()).title == "title");
+				REQUIRE_THROWS_AS(reader.readSong(data.data(), data.size()), GpReaderError);
+			}
+		}
+
+		WHEN("The header text is read without copying it")
+		{
+			SongInfoView view;
+			{
+				Gp5Reader reader;
+				view = reader.readHeaderViewFromFile("./resources/test.gp5");
+			}
+
+			auto song = Gp5Reader().readSongFromFile("./resources/test.gp5");
+
+			THEN("The views outlive the reader and match the song")
+			{
+				REQUIRE(view.title == "title");
+				REQUIRE(view.title == song->title);
+				REQUIRE(view.artist == song->artist);
+				REQUIRE(view.comments.size() == song->comments.size());
+				REQUIRE(std::equal(view.comments.begin(), view.comments.end(), song->comments.begin()));
+			}
+		}
+	}
+}
+
+SCENARIO("Can read a Guitar Pro 6 file")
+{
+	GIVEN("A .gpx file")
+	{
+		std::ifstream fileStream;
+		fileStream.open("./resources/test.gpx", std::ios::binary);
+
+		WHEN("The file is read")
+		{
+			GpxReader reader;
+			auto song = reader.readSong(fileStream);
+			auto expectedSong = createExpectedSong();
+
+			THEN("The song info is correct")
+			{
+				REQUIRE(song->title == expectedSong->title);
+				REQUIRE(song->subtitle == expectedSong->subtitle);
+				REQUIRE(song->artist == expectedSong->artist);
+				REQUIRE(song->album == expectedSong->album);
+				REQUIRE(song->lyricsWriter == expectedSong->lyricsWriter);
+				REQUIRE(song->musicWriter == expectedSong->musicWriter);
+				REQUIRE(song->copyright == expectedSong->copyright);
+				REQUIRE(song->tabAuthor == expectedSong->tabAuthor);
+				REQUIRE(song->instructions == expectedSong->instructions);
+				REQUIRE(song->comments.size() == 1);
+				REQUIRE(song->comments[0] == "remarks");
+				REQUIRE(reader.version().major() == 6);
+			}
+
+			THEN("The lyrics are correct")
+			{
+				REQUIRE(song->lyrics.trackNumber == 1);
+				REQUIRE(song->lyrics.lines.size() == 5);
+				REQUIRE(song->lyrics.lines[0].startingMeasure == 1);
+				REQUIRE(song->lyrics.lines[0].lyrics == "these are the lyrics");
+			}
+
+			THEN("The page setup info is correct")
+			{
+				REQUIRE(song->pageSetup == expectedSong->pageSetup);
+			}
+
+			THEN("The tempo is correct")
+			{
+				REQUIRE(song->tempo == expectedSong->tempo);
+			}
+
+			THEN("The measure headers are correct")
+			{
+				REQUIRE(song->measureHeaders == expectedSong->measureHeaders);
+			}
+
+			THEN("The tracks are correct")
+			{
+				REQUIRE(song->tracks.size() == 2);
+				REQUIRE(song->tracks[0].name == "Steel Guitar");
+				REQUIRE(song->tracks[0].strings.size() == 6);
+				REQUIRE(song->tracks[0].strings[0].value == 64);
+				REQUIRE(song->tracks[0].strings[5].value == 40);
+				REQUIRE(song->tracks[0].channel->channel == 0);
+				REQUIRE(song->tracks[0].channel->instrument == 25);
+				REQUIRE(song->tracks[1].name == "Drumkit");
+				REQUIRE(song->tracks[1].isPercussionTrack);
+				REQUIRE(song->tracks[1].channel->isPercussionChannel());
+			}
+
+			THEN("The measures are correct")
+			{
+				auto& measure = song->tracks[0].measures.at(0);
+				auto& beats = measure.voices[0].beats;
+				REQUIRE(beats.size() == 4);
+
+				for (size_t i = 0; i < beats.size(); ++i) {
+					REQUIRE(beats[i].start == 960 * (i + 1));
+					REQUIRE(beats[i].duration.value == 4);
+					REQUIRE(beats[i].notes.size() == 1);
+					REQUIRE(beats[i].notes[0].string == 6);
+					REQUIRE(beats[i].notes[0].value == i);
+					REQUIRE(beats[i].notes[0].type == NoteType::Normal);
+				}
+
+				REQUIRE(measure.voices[1].beats.empty());
+
+				auto& drums = song->tracks[1].measures.at(0).voices[0].beats;
+				REQUIRE(drums.size() == 4);
+				REQUIRE(drums[0].notes.at(0).value == 35);
+				REQUIRE(drums[3].notes.at(0).value == 38);
+				REQUIRE(drums[3].start == 960 * 4);
+			}
+		}
+
+		WHEN("Only the header is read")
+		{
+			GpxReader reader;
+			auto info = reader.readHeaderFromFile("./resources/test.gpx");
+
+			THEN("The song info is correct")
+			{
+				REQUIRE(info.title == "title");
+				REQUIRE(info.keySignature == KeySignature::GMajor);
+				REQUIRE(info.tempo.value == 120);
+			}
+		}
+
+		WHEN("The header text is read as views")
+		{
+			SongInfoView view;
+			{
+				GpxReader reader;
+				view = reader.readHeaderViewFromFile("./resources/test.gpx");
+			}
+
+			THEN("The views point into a decoded copy that outlives the reader")
+			{
+				REQUIRE(view.title == "title");
+				REQUIRE(view.source != nullptr);
+			}
+		}
+
+		WHEN("A truncated file is read")
+		{
+			MappedFile file("./resources/test.gpx");
+			GpxReader reader;
+
+			THEN("An exception is thrown")
+			{
+				REQUIRE_THROWS_AS(reader.readSong(file.data(), file.size() / 2), GpReaderError);
+				REQUIRE_THROWS_AS(reader.readSong(file.data(), 3), GpReaderError);
+			}
+		}
+
+		WHEN("A Guitar Pro 5 file is read")
+		{
+			GpxReader reader;
+
+			THEN("An exception is thrown")
+			{
+				REQUIRE_THROWS_AS(reader.readSongFromFile("./resources/test.gp5"), GpReaderError);
+			}
 		}
 	}
 }
 
-std::unique_ptr<Song> createExpectedSong()
+SCENARIO("Can run tasks on a thread pool")
 {
-	auto song = std::make_unique<Song>();
+	GIVEN("A pool with several threads")
+	{
+		ThreadPool pool(4);
 
-	song->title = "title";
-	song->subtitle = "subtitle";
-	song->artist = "artist";
-	song->album = "album";
-	song->lyricsWriter = "lyrics";
-	song->musicWriter = "music";
-	song->copyright = "copyright";
-	song->tabAuthor = "tab";
-	song->instructions = "instructions";
+		WHEN("Many tasks are run")
+		{
+			std::vector<std::atomic<int>> runs(1000);
+			pool.parallelFor(runs.size(), [&runs](size_t i) { ++runs[i]; });
 
-	song->lyrics.trackNumber = 1;
-	song->lyrics.lines = {
-		LyricLine(1, "these are the lyrics "),
-		LyricLine(1, ""),
-		LyricLine(1, ""),
-		LyricLine(1, ""),
-		LyricLine(1, "")
-	};
+			THEN("Every task runs exactly once")
+			{
+				for (auto& count : runs) {
+					REQUIRE(count == 1);
+				}
+			}
+		}
 
-	song->tempo.name = "";
-	song->tempo.value = 120;
-	song->tempo.isHidden = false;
+		WHEN("A task throws")
+		{
+			THEN("The exception reaches the caller")
+			{
+				REQUIRE_THROWS_AS(pool.parallelFor(8, [](size_t i) { if (i == 5) throw GpReaderError(); }), GpReaderError);
+			}
+		}
+	}
+}
 
-	song->keySignature = KeySignature::CMajor;
-	song->octave = 0;
+SCENARIO("Can read a batch of Guitar Pro files")
+{
+	GIVEN("A list of readable and missing files in different formats")
+	{
+		std::vector<std::string> paths(8, "./resources/test.gp5");
+		paths[3] = "./resources/missing.gp5";
+		paths[5] = "./resources/test.gpx";
 
-	MeasureHeader header;
-	header.number = 1;
-	header.start = 0;
-	header.tempo = song->tempo.value;
-	header.timeSignature.numerator = 4;
-	header.timeSignature.denominator = 4;
-	header.keySignature = KeySignature::GMajor;
-	song->measureHeaders.push_back(header);
+		WHEN("The files are read in parallel")
+		{
+			BatchReader reader(4);
+			auto results = reader.readFiles(paths);
 
-	return song;
-}
\ No newline at end of file
+			THEN("Each file has either a song or an error")
+			{
+				REQUIRE(results.size() == paths.size());
+				for (size_t i = 0; i < results.size(); ++i) {
+					if (i == 3) {
+						REQUIRE(results[i].song == nullptr);
+						REQUIRE(results[i].error.has_value());
+					} else {
+						REQUIRE(results[i].song->title == "title");
+						REQUIRE(results[i].song->tracks[0].measures[0].voices[0].beats.size() == 4);
+						REQUIRE_FALSE(results[i].error.has_value());
+					}
+				}
+			}
+		}
+	}
+}
+
+SCENARIO("Can read Guitar Pro 5.00 files")
+{
+	GIVEN("A small file laid out as version 5.00, without the fields 5.10 added")
+	{
+		auto file = createVersion500File();
+		Gp5Reader reader;
+
+		WHEN("The file is read")
+		{
+			auto song = reader.readSong(file.data(), file.size());
+
+			THEN("Every part after the lyrics is read from where 5.00 puts it")
+			{
+				REQUIRE(reader.version().full() == "FICHIER GUITAR PRO v5.00");
+				REQUIRE(song->title == "title");
+				REQUIRE(song->musicWriter == "music");
+				REQUIRE(song->comments.size() == 1);
+				REQUIRE(song->lyrics.lines.at(0).lyrics == "la");
+				REQUIRE(song->pageSetup.sizeX == 210);
+				REQUIRE(song->pageSetup.pageNumber == "Page %N%");
+				REQUIRE(song->tempo.name == "Moderate");
+				REQUIRE(song->tempo.value == 120);
+				REQUIRE_FALSE(song->tempo.isHidden);
+				REQUIRE(song->keySignature == KeySignature::GMajor);
+
+				REQUIRE(song->measureHeaders.size() == 2);
+				REQUIRE(song->measureHeaders[1].timeSignature.numerator == 4);
+
+				auto& track = song->tracks.at(0);
+				REQUIRE(track.name == "Guitar");
+				REQUIRE(track.strings.size() == 6);
+				REQUIRE(track.channel->instrument == 25);
+				REQUIRE(track.measures.size() == 2);
+
+				auto& beats = track.measures[0].voices[0].beats;
+				REQUIRE(beats.size() == 1);
+				REQUIRE(beats[0].notes.at(0).value == 3);
+				REQUIRE(track.measures[1].voices[0].beats.at(0).status == BeatStatus::Rest);
+			}
+		}
+
+		WHEN("The file is pushed a few bytes at a time")
+		{
+			Gp5PushReader pushReader(nullptr);
+			for (size_t i = 0; i < file.size(); i += 5) {
+				pushReader.feed(file.data() + i, std::min<size_t>(5, file.size() - i));
+			}
+
+			pushReader.finish();
+
+			THEN("The song matches one read whole")
+			{
+				auto song = reader.readSong(file.data(), file.size());
+				REQUIRE(pushReader.song()->tempo.name == song->tempo.name);
+				REQUIRE(pushReader.song()->measureHeaders == song->measureHeaders);
+				REQUIRE(pushReader.song()->tracks.at(0).measures.size() == 2);
+			}
+		}
+
+		WHEN("The song is written back as version 5.00")
+		{
+			auto song = reader.readSong(file.data(), file.size());
+			auto data = Gp5Writer(reader.version()).write(*song);
+
+			THEN("The song header is written as 5.00 lays it out, with no master effect")
+			{
+				// The header ends with the tempo name, the tempo, the key and the octave
+				std::string_view text(reinterpret_cast<const char*>(file.data()), file.size());
+				auto headerSize = text.find("Moderate") + 8 + 4 + 1 + 4;
+
+				REQUIRE(data.size() > headerSize);
+				REQUIRE(std::equal(file.begin(), file.begin() + headerSize, data.begin()));
+				REQUIRE(reader.readSong(data.data(), data.size())->measureHeaders == song->measureHeaders);
+			}
+		}
+	}
+}
+
+SCENARIO("Can read Guitar Pro 3 and 4 files")
+{
+	GIVEN("A small file in each version")
+	{
+		auto gp3 = createOldVersionFile(3);
+		auto gp4 = createOldVersionFile(4);
+
+		WHEN("The files are read")
+		{
+			Gp3Reader gp3Reader;
+			Gp4Reader gp4Reader;
+			std::unique_ptr<Song> songs[] = {
+				gp3Reader.readSong(gp3.data(), gp3.size()),
+				gp4Reader.readSong(gp4.data(), gp4.size())
+			};
+
+			THEN("The song is read without the fields added in version 5")
+			{
+				for (auto& song : songs) {
+					REQUIRE(song->title == "title");
+					REQUIRE(song->artist == "artist");
+					REQUIRE(song->musicWriter == "words");
+					REQUIRE(song->comments.size() == 1);
+					REQUIRE(song->tempo.value == 120);
+					REQUIRE(song->keySignature == KeySignature::GMajor);
+
+					auto& headers = song->measureHeaders;
+					REQUIRE(headers.size() == 2);
+					REQUIRE(headers[0].timeSignature.numerator == 4);
+					REQUIRE(headers[0].isRepeatOpen);
+					REQUIRE(headers[1].repeatClose == 2);
+					REQUIRE(headers[1].repeatAlternative == 3);
+					REQUIRE(headers[1].tripletFeel == TripletFeel::Eighth);
+					REQUIRE(headers[1].tempo == 90);
+
+					auto& track = song->tracks.at(0);
+					REQUIRE(track.name == "Guitar");
+					REQUIRE(track.isVisible);
+					REQUIRE(track.strings.size() == 6);
+					REQUIRE(track.strings[0].value == 64);
+					REQUIRE(track.channel->instrument == 25);
+					REQUIRE(track.numFrets == 24);
+
+					auto& beats = track.measures.at(0).voices[0].beats;
+					REQUIRE(beats.size() == 2);
+					REQUIRE(track.measures[0].voices[1].beats.empty());
+					REQUIRE(beats[0].notes.at(0).value == 3);
+					REQUIRE(beats[1].start == beats[0].start + 960);
+					REQUIRE(beats[1].effect.mixTableChange->tempo == 90);
+
+					auto& note = beats[1].notes.at(0);
+					REQUIRE(note.string == 6);
+					REQUIRE(note.value == 5);
+					REQUIRE(note.effect.slides.at(0) == SlideType::ShiftSlideTo);
+					REQUIRE(note.effect.harmonic->type == HarmonicType::Natural);
+
+					REQUIRE(track.measures.at(1).voices[0].beats.at(0).status == BeatStatus::Rest);
+				}
+
+				REQUIRE(songs[0]->lyrics.lines.empty());
+				REQUIRE(songs[1]->lyrics.lines.at(0).lyrics == "la");
+			}
+
+			THEN("Each reader only accepts its own version")
+			{
+				REQUIRE(gp3Reader.version().full() == "FICHIER GUITAR PRO v3.00");
+				REQUIRE_THROWS_AS(gp3Reader.readSong(gp4.data(), gp4.size()), GpReaderError);
+				REQUIRE_THROWS_AS(gp4Reader.readSongFromFile("./resources/test.gp5"), GpReaderError);
+			}
+		}
+
+		WHEN("The files are read lazily through the registry")
+		{
+			ReaderRegistry registry;
+			auto gp3Song = registry.readSong(gp3.data(), gp3.size());
+			auto gp3LazySong = registry.readLazySong(gp3.data(), gp3.size());
+			auto gp3Format = registry.format();
+			auto gp4Song = registry.readSong(gp4.data(), gp4.size());
+			auto gp4LazySong = registry.readLazySong(gp4.data(), gp4.size());
+
+			THEN("The measures match a full read")
+			{
+				REQUIRE(gp3Format == FileFormat::Gp3);
+				REQUIRE(registry.format() == FileFormat::Gp4);
+
+				for (auto [song, lazySong] : { std::make_pair(gp3Song.get(), gp3LazySong.get()), std::make_pair(gp4Song.get(), gp4LazySong.get()) }) {
+					auto expectedColumns = NoteColumns::fromTrack(song->tracks[0]);
+					auto columns = NoteColumns::fromTrack(lazySong->track(0));
+					REQUIRE(columns.start == expectedColumns.start);
+					REQUIRE(columns.value == expectedColumns.value);
+					REQUIRE(columns.flags == expectedColumns.flags);
+					REQUIRE(lazySong->song().measureHeaders == song->measureHeaders);
+				}
+			}
+		}
+	}
+}
+
+SCENARIO("Can observe the phases of a parse")
+{
+	GIVEN("A .gp5 file and a reader with an observer")
+	{
+		MappedFile file("./resources/test.gp5");
+
+		RecordingObserver observer;
+		Gp5Reader reader;
+		reader.setParseObserver(&observer);
+
+		WHEN("The file is read")
+		{
+			auto song = reader.readSong(file.data(), file.size());
+
+			THEN("Every phase is reported once, in order, with what it decoded")
+			{
+				auto& phases = observer.phases;
+				REQUIRE(phases.size() == 6);
+
+				size_t bytes = 0;
+				for (size_t i = 0; i < phases.size(); ++i) {
+					REQUIRE(phases[i].phase == static_cast<ParsePhase>(i));
+					REQUIRE(phases[i].bytes > 0);
+					REQUIRE(phases[i].duration.count() >= 0);
+					bytes += phases[i].bytes;
+				}
+
+				REQUIRE(phases[0].bytes == 31);
+				REQUIRE(bytes == file.size());
+				REQUIRE(phases[3].measureHeaders == song->measureHeaders.size());
+				REQUIRE(phases[4].tracks == song->tracks.size());
+
+				auto& measures = phases[5];
+				REQUIRE(measures.measures == song->tracks.size() * song->measureHeaders.size());
+				REQUIRE(measures.beats > 0);
+				REQUIRE(measures.notes > 0);
+				REQUIRE(measures.measureHeaders == 0);
+			}
+		}
+
+		WHEN("Only the header is read")
+		{
+			reader.readHeader(file.data(), file.size());
+
+			THEN("Only the phases up to the song info are reported")
+			{
+				REQUIRE(observer.phases.size() == 2);
+				REQUIRE(observer.phases[1].phase == ParsePhase::SongInfo);
+			}
+		}
+
+		WHEN("The observer is removed")
+		{
+			reader.setParseObserver(nullptr);
+			reader.readSong(file.data(), file.size());
+
+			THEN("Nothing is reported")
+			{
+				REQUIRE(reader.parseObserver() == nullptr);
+				REQUIRE(observer.phases.empty());
+			}
+		}
+
+		WHEN("The file is read through a registry with the same options and a thread pool")
+		{
+			ThreadPool pool(2);
+			ReaderRegistry registry;
+			auto options = reader.options();
+			options.threadPool = &pool;
+			registry.setOptions(options);
+			auto song = registry.readSong(file.data(), file.size());
+
+			auto expectedSong = Gp5Reader().readSong(file.data(), file.size());
+
+			THEN("The reader it picked reports to the observer and reads on the pool")
+			{
+				REQUIRE(registry.parseObserver() == &observer);
+				REQUIRE(observer.phases.size() == 6);
+				REQUIRE(observer.phases[5].measures == song->tracks.size() * song->measureHeaders.size());
+				REQUIRE(song->measureHeaders == expectedSong->measureHeaders);
+				REQUIRE(song->tracks.size() == expectedSong->tracks.size());
+			}
+		}
+	}
+}
+
+SCENARIO("Can read a song without exceptions")
+{
+	GIVEN("A .gp5 file")
+	{
+		MappedFile file("./resources/test.gp5");
+		Gp5Reader reader;
+
+		WHEN("The whole file is read")
+		{
+			auto result = reader.tryReadSong(file.data(), file.size());
+
+			THEN("The song is returned")
+			{
+				REQUIRE(result);
+				REQUIRE(result.error().code == ParseErrorCode::None);
+				REQUIRE(result.value()->title == "title");
+			}
+		}
+
+		WHEN("The file is cut off in its measures")
+		{
+			auto size = file.size() - 10;
+			auto result = reader.tryReadSong(file.data(), size);
+
+			THEN("The error tells where the data ran out")
+			{
+				REQUIRE_FALSE(result);
+				REQUIRE(result.error().code == ParseErrorCode::UnexpectedEnd);
+				REQUIRE(result.error().phase == ParsePhase::Measures);
+				REQUIRE(result.error().offset <= size);
+				REQUIRE(result.error().offset + 8 > size);
+				REQUIRE_THROWS_AS(result.value(), GpReaderError);
+			}
+		}
+
+		WHEN("The file is cut off in its song info")
+		{
+			auto result = reader.tryReadSong(file.data(), 100);
+
+			THEN("The error is in that phase")
+			{
+				REQUIRE(result.error().code == ParseErrorCode::UnexpectedEnd);
+				REQUIRE(result.error().phase == ParsePhase::SongInfo);
+			}
+		}
+
+		WHEN("A direction sign is placed past the last measure")
+		{
+			// Each sign is stored as the number of its measure, in a little-endian short
+			auto sign = directionSignsOffset(file);
+			std::vector<std::byte> data(file.data(), file.data() + file.size());
+			data[sign] = std::byte{ 0x00 };
+			data[sign + 1] = std::byte{ 0x7f };
+
+			auto result = reader.tryReadSong(data.data(), data.size());
+
+			THEN("The data is reported as invalid")
+			{
+				REQUIRE(result.error().code == ParseErrorCode::InvalidData);
+				REQUIRE(result.error().phase == ParsePhase::MeasureHeaders);
+			}
+		}
+
+		WHEN("The same cut off file is read through the throwing API")
+		{
+			THEN("The exception carries the error")
+			{
+				try {
+					reader.readSong(file.data(), 100);
+					FAIL("No exception was thrown");
+				} catch (const GpReaderError& e) {
+					REQUIRE(e.error().code == ParseErrorCode::UnexpectedEnd);
+					REQUIRE(std::string(e.what()) == "Unexpected end of the stream");
+				}
+			}
+		}
+	}
+
+	GIVEN("Sources that are not Guitar Pro 5 files")
+	{
+		std::vector<std::byte> garbage(64, std::byte('x'));
+		auto gp4 = createOldVersionFile(4);
+		Gp5Reader reader;
+
+		THEN("Each fails with its own code")
+		{
+			auto invalid = reader.tryReadSong(garbage.data(), garbage.size());
+			REQUIRE(invalid.error().code == ParseErrorCode::InvalidVersion);
+			REQUIRE(invalid.error().phase == ParsePhase::Version);
+			REQUIRE(reader.tryReadSong(gp4.data(), gp4.size()).error().code == ParseErrorCode::UnsupportedVersion);
+			REQUIRE(reader.tryReadSongFromFile("./resources/missing.gp5").error().code == ParseErrorCode::FileError);
+			REQUIRE_FALSE(GpVersion::tryParse("FICHIER GUITAR PRO va.00"));
+		}
+
+		THEN("The registry reports the phase of the reader it picked")
+		{
+			ReaderRegistry registry;
+			auto data = std::vector<std::byte>(gp4.begin(), gp4.begin() + gp4.size() / 2);
+			auto result = registry.tryReadSong(data.data(), data.size());
+			REQUIRE(result.error().code == ParseErrorCode::UnexpectedEnd);
+			REQUIRE(result.error().phase != ParsePhase::Version);
+		}
+	}
+}
+
+SCENARIO("Can salvage what is left of a cut off file")
+{
+	GIVEN("A .gp5 file and where each of its phases ends")
+	{
+		MappedFile file("./resources/test.gp5");
+
+		RecordingObserver observer;
+		Gp5Reader reader;
+		reader.setParseObserver(&observer);
+		auto song = reader.readSong(file.data(), file.size());
+		reader.setParseObserver(nullptr);
+
+		std::vector<size_t> phaseEnds;
+		size_t end = 0;
+		for (auto& phase : observer.phases) {
+			end += phase.bytes;
+			phaseEnds.push_back(end);
+		}
+
+		WHEN("The whole file is salvaged")
+		{
+			auto salvaged = reader.salvageSong(file.data(), file.size());
+
+			THEN("The whole song is read")
+			{
+				REQUIRE_FALSE(salvaged.error);
+				REQUIRE(salvaged.song->measureHeaders == song->measureHeaders);
+				REQUIRE(NoteColumns::fromTrack(salvaged.song->tracks.at(0)).value == NoteColumns::fromTrack(song->tracks[0]).value);
+			}
+		}
+
+		WHEN("The file is cut off in its last measure")
+		{
+			auto salvaged = reader.salvageSong(file.data(), file.size() - 10);
+
+			THEN("The measures of the headers decoded for every track are kept")
+			{
+				REQUIRE(salvaged.error);
+				REQUIRE(salvaged.error->code == ParseErrorCode::UnexpectedEnd);
+				REQUIRE(salvaged.error->phase == ParsePhase::Measures);
+
+				auto& salvagedSong = *salvaged.song;
+				REQUIRE(salvagedSong.title == "title");
+				REQUIRE(salvagedSong.measureHeaders == song->measureHeaders);
+				REQUIRE(salvagedSong.tracks.size() == song->tracks.size());
+
+				auto numMeasures = salvagedSong.tracks[0].measures.size();
+				REQUIRE(numMeasures < song->measureHeaders.size());
+				for (auto& track : salvagedSong.tracks) {
+					REQUIRE(track.measures.size() == numMeasures);
+				}
+
+				for (size_t i = 0; i < numMeasures; ++i) {
+					auto& beats = salvagedSong.tracks[0].measures[i].voices[0].beats;
+					REQUIRE(beats.size() == song->tracks[0].measures[i].voices[0].beats.size());
+				}
+			}
+		}
+
+		WHEN("The file is cut off in its second track")
+		{
+			auto salvaged = reader.salvageSong(file.data(), phaseEnds[3] + (phaseEnds[4] - phaseEnds[3]) * 3 / 4);
+
+			THEN("The headers and the tracks before it are kept")
+			{
+				REQUIRE(salvaged.error->phase == ParsePhase::Tracks);
+				REQUIRE(salvaged.error->offset > phaseEnds[3]);
+
+				auto& salvagedSong = *salvaged.song;
+				REQUIRE(salvagedSong.measureHeaders == song->measureHeaders);
+				REQUIRE(salvagedSong.tracks.size() == 1);
+				REQUIRE(salvagedSong.tracks[0].name == "Steel Guitar");
+				REQUIRE(salvagedSong.tracks[0].measures.empty());
+			}
+		}
+
+		WHEN("The time signature of the first measure is missing or invalid")
+		{
+			auto headerFlags = firstMeasureHeaderOffset(file);
+			REQUIRE((file.data()[headerFlags] & std::byte{ 0x03 }) == std::byte{ 0x03 });
+
+			std::vector<std::byte> missing(file.data(), file.data() + file.size());
+			missing[headerFlags] &= ~std::byte{ 0x03 };
+			std::vector<std::byte> invalid(file.data(), file.data() + file.size());
+			invalid[headerFlags + 2] = std::byte{ 0 };
+
+			THEN("No measure header is kept")
+			{
+				for (auto* data : { &missing, &invalid }) {
+					auto salvaged = reader.salvageSong(data->data(), data->size());
+					REQUIRE(salvaged.error->code == ParseErrorCode::InvalidData);
+					REQUIRE(salvaged.error->phase == ParsePhase::MeasureHeaders);
+					REQUIRE(salvaged.song->title == "title");
+					REQUIRE(salvaged.song->measureHeaders.empty());
+				}
+			}
+		}
+
+		WHEN("Not even the version can be read")
+		{
+			auto salvaged = reader.salvageSong(file.data(), 10);
+
+			THEN("There is no song")
+			{
+				REQUIRE(salvaged.song == nullptr);
+				REQUIRE(salvaged.error->phase == ParsePhase::Version);
+			}
+		}
+	}
+}
+
+SCENARIO("Can read a song from bytes as they arrive")
+{
+	GIVEN("A .gp5 file and a push reader recording what it reports")
+	{
+		MappedFile file("./resources/test.gp5");
+
+		Gp5Reader reader;
+		auto song = reader.readSong(file.data(), file.size());
+
+		std::vector<PushEvent> events;
+		Gp5PushReader pushReader([&](const PushEvent& event) { events.push_back(event); });
+
+		WHEN("The file is fed a few bytes at a time")
+		{
+			size_t maxBuffered = 0;
+			for (size_t i = 0; i < file.size(); i += 7) {
+				pushReader.feed(file.data() + i, std::min<size_t>(7, file.size() - i));
+				maxBuffered = std::max(maxBuffered, pushReader.bufferedSize());
+			}
+
+			pushReader.finish();
+
+			THEN("The song matches one read whole")
+			{
+				REQUIRE(pushReader.isFinished());
+				REQUIRE(pushReader.position() == file.size());
+				REQUIRE(pushReader.version() == reader.version());
+
+				auto pushedSong = pushReader.takeSong();
+				REQUIRE(pushedSong->title == song->title);
+				REQUIRE(pushedSong->comments == song->comments);
+				REQUIRE(pushedSong->measureHeaders == song->measureHeaders);
+				REQUIRE(pushedSong->tracks.size() == song->tracks.size());
+				for (size_t i = 0; i < song->tracks.size(); ++i) {
+					REQUIRE(pushedSong->tracks[i].name == song->tracks[i].name);
+					REQUIRE(pushedSong->tracks[i].measures.size() == song->tracks[i].measures.size());
+					REQUIRE(NoteColumns::fromTrack(pushedSong->tracks[i]).value == NoteColumns::fromTrack(song->tracks[i]).value);
+				}
+			}
+
+			THEN("Each part is reported in file order")
+			{
+				auto numTracks = song->tracks.size();
+				auto numMeasures = song->measureHeaders.size() * numTracks;
+				REQUIRE(events.size() == 3 + numTracks + numMeasures);
+				REQUIRE(events[0].type == PushEventType::SongInfo);
+				REQUIRE(events[1].type == PushEventType::MeasureHeaders);
+				REQUIRE(events[2].type == PushEventType::Track);
+				REQUIRE(events[2 + numTracks].type == PushEventType::Measure);
+				REQUIRE(events[3 + numTracks].track == 1 % numTracks);
+				REQUIRE(events.back().type == PushEventType::Finished);
+			}
+
+			THEN("Only the part in progress is buffered")
+			{
+				REQUIRE(maxBuffered < file.size() / 2);
+				REQUIRE(pushReader.bufferedSize() == 0);
+			}
+		}
+
+		WHEN("Only the version and part of the song info have arrived")
+		{
+			pushReader.feed(file.data(), 40);
+
+			THEN("There is no song yet")
+			{
+				REQUIRE(pushReader.phase() == ParsePhase::SongInfo);
+				REQUIRE(pushReader.position() == 31);
+				REQUIRE(pushReader.song() == nullptr);
+				REQUIRE(events.empty());
+			}
+
+			THEN("The song cannot be taken before it is finished")
+			{
+				pushReader.feed(file.data() + 40, file.size() - 50);
+				REQUIRE(pushReader.song() != nullptr);
+				REQUIRE(pushReader.takeSong() == nullptr);
+
+				pushReader.feed(file.data() + file.size() - 10, 10);
+				pushReader.finish();
+				REQUIRE(pushReader.takeSong() != nullptr);
+				REQUIRE(pushReader.song() == nullptr);
+			}
+		}
+
+		WHEN("The bytes stop before the end of the song")
+		{
+			pushReader.feed(file.data(), file.size() - 10);
+
+			THEN("The song is read up to there and finishing fails")
+			{
+				REQUIRE_FALSE(pushReader.isFinished());
+				REQUIRE(pushReader.phase() == ParsePhase::Measures);
+				REQUIRE(pushReader.song()->measureHeaders == song->measureHeaders);
+
+				try {
+					pushReader.finish();
+					FAIL("finish did not throw");
+				} catch (const GpReaderError& e) {
+					REQUIRE(e.error().code == ParseErrorCode::UnexpectedEnd);
+					REQUIRE(e.error().phase == ParsePhase::Measures);
+					REQUIRE(e.error().offset > pushReader.position());
+				}
+			}
+		}
+
+		WHEN("The counts or the direction signs are corrupt")
+		{
+			// The high bytes of the first sign and of the track count
+			std::vector<std::byte> badSign(file.data(), file.data() + file.size());
+			badSign[directionSignsOffset(file) + 1] = std::byte{ 0x7f };
+			std::vector<std::byte> badCount(file.data(), file.data() + file.size());
+			badCount[trackCountOffset(file) + 3] = std::byte{ 0x7f };
+
+			THEN("Feeding them fails with an error rather than a crash")
+			{
+				try {
+					pushReader.feed(badSign.data(), badSign.size());
+					FAIL("feed did not throw");
+				} catch (const GpReaderError& e) {
+					REQUIRE(e.error().code == ParseErrorCode::InvalidData);
+					REQUIRE(e.error().phase == ParsePhase::MeasureHeaders);
+				}
+
+				Gp5PushReader countReader(nullptr);
+				REQUIRE_THROWS_AS((countReader.feed(badCount.data(), badCount.size()), countReader.finish()), GpReaderError);
+			}
+		}
+
+		WHEN("The bytes are not those of a Guitar Pro 5 file")
+		{
+			auto gp4 = createOldVersionFile(4);
+			std::vector<std::byte> garbage(64, std::byte{ 0x10 });
+
+			THEN("Feeding them fails")
+			{
+				REQUIRE_THROWS_AS(pushReader.feed(gp4.data(), gp4.size()), GpReaderError);
+
+				Gp5PushReader garbageReader(nullptr);
+				REQUIRE_THROWS_AS(garbageReader.feed(garbage.data(), garbage.size()), GpReaderError);
+				REQUIRE(events.empty());
+			}
+		}
+	}
+}
+
+SCENARIO("Can pick a reader from the format of a file")
+{
+	GIVEN("Files and headers of each format")
+	{
+		MappedFile gp5File("./resources/test.gp5");
+		MappedFile gpxFile("./resources/test.gpx");
+
+		Gp5Reader gp5Reader;
+		CacheWriter writer;
+		auto cache = writer.write(*gp5Reader.readSongFromFile("./resources/test.gp5"));
+
+		auto header = [](std::string text) {
+			std::vector<std::byte> bytes(31);
+			bytes[0] = std::byte(text.size());
+			std::memcpy(bytes.data() + 1, text.data(), text.size());
+			return bytes;
+		};
+
+		auto gp3 = header("FICHIER GUITAR PRO v3.00");
+		auto gp4 = header("FICHIER GUITAR PRO v4.06");
+		const std::byte zip[] = { std::byte('P'), std::byte('K'), std::byte(3), std::byte(4), std::byte(0) };
+		const std::byte text[] = { std::byte('<'), std::byte('x'), std::byte('>') };
+
+		WHEN("The formats are detected")
+		{
+			THEN("Each format is told from its first bytes")
+			{
+				REQUIRE(detectFormat(gp5File.data(), gp5File.size()) == FileFormat::Gp5);
+				REQUIRE(detectFormat(gpxFile.data(), gpxFile.size()) == FileFormat::Gpx);
+				REQUIRE(detectFormat(cache.data(), cache.size()) == FileFormat::Cache);
+				REQUIRE(detectFormat(gp3.data(), gp3.size()) == FileFormat::Gp3);
+				REQUIRE(detectFormat(gp4.data(), gp4.size()) == FileFormat::Gp4);
+				REQUIRE(detectFormat(zip, sizeof(zip)) == FileFormat::Gp7);
+				REQUIRE(detectFormat(text, sizeof(text)) == FileFormat::Unknown);
+				REQUIRE(detectFormat(text, 0) == FileFormat::Unknown);
+			}
+		}
+
+		WHEN("The files are read through the registry")
+		{
+			ReaderRegistry registry;
+			std::ifstream gpxStream("./resources/test.gpx", std::ios::binary);
+
+			auto gp5Song = registry.readSongFromFile("./resources/test.gp5");
+			auto gp5Format = registry.format();
+			auto gpxSong = registry.readSong(gpxStream);
+			auto gpxFormat = registry.format();
+			auto cachedSong = registry.readSong(cache.data(), cache.size());
+
+			THEN("Each file is read by the reader of its format")
+			{
+				REQUIRE(gp5Format == FileFormat::Gp5);
+				REQUIRE(gp5Song->title == "title");
+				REQUIRE(gpxFormat == FileFormat::Gpx);
+				REQUIRE(gpxSong->title == "title");
+				REQUIRE(registry.format() == FileFormat::Cache);
+				REQUIRE(cachedSong->title == "title");
+				REQUIRE(cachedSong->tracks.size() == gp5Song->tracks.size());
+			}
+
+			THEN("Formats without a reader or with no known header are rejected")
+			{
+				REQUIRE(registry.canRead(FileFormat::Gp4));
+				REQUIRE_FALSE(registry.canRead(FileFormat::Gp7));
+				REQUIRE_THROWS_AS(registry.readSong(zip, sizeof(zip)), GpReaderError);
+				REQUIRE_THROWS_AS(registry.readSong(text, sizeof(text)), GpReaderError);
+			}
+		}
+	}
+}
+
+SCENARIO("Can cache a parsed song")
+{
+	GIVEN("A song read from a .gp5 file")
+	{
+		Gp5Reader gp5Reader;
+		auto song = gp5Reader.readSongFromFile("./resources/test.gp5");
+
+		WHEN("The song is cached and loaded back")
+		{
+			CacheWriter writer;
+			auto data = writer.write(*song);
+
+			CacheReader reader;
+			auto cachedSong = reader.readSong(data.data(), data.size());
+
+			THEN("The loaded song matches the original")
+			{
+				REQUIRE(cachedSong->title == song->title);
+				REQUIRE(cachedSong->comments == song->comments);
+				REQUIRE(cachedSong->lyrics == song->lyrics);
+				REQUIRE(cachedSong->pageSetup == song->pageSetup);
+				REQUIRE(cachedSong->masterEffect == song->masterEffect);
+				REQUIRE(cachedSong->measureHeaders == song->measureHeaders);
+				REQUIRE(cachedSong->tracks.size() == song->tracks.size());
+
+				for (size_t i = 0; i < song->tracks.size(); ++i) {
+					auto& track = cachedSong->tracks[i];
+					REQUIRE(track.name == song->tracks[i].name);
+					REQUIRE(track.channel == song->tracks[i].channel);
+					REQUIRE(&track.measures.at(0).track == &track);
+					REQUIRE(&track.measures[0].header == &cachedSong->measureHeaders[0]);
+					REQUIRE(&track.measures[0].voices[1].measure == &track.measures[0]);
+
+					auto columns = NoteColumns::fromTrack(track);
+					auto expectedColumns = NoteColumns::fromTrack(song->tracks[i]);
+					REQUIRE(columns.start == expectedColumns.start);
+					REQUIRE(columns.value == expectedColumns.value);
+					REQUIRE(columns.flags == expectedColumns.flags);
+				}
+			}
+
+			THEN("The version of the cache is checked")
+			{
+				REQUIRE(reader.version().full() == "LIBGP SONG CACHE v1.00");
+				REQUIRE_THROWS_AS(reader.readSongFromFile("./resources/test.gp5"), GpReaderError);
+			}
+		}
+
+		WHEN("The cache is written to a file and mapped lazily")
+		{
+			CacheWriter().writeToFile(*song, "./test.cache");
+
+			CacheReader reader;
+			auto lazySong = reader.readLazySongFromFile("./test.cache");
+
+			THEN("Tracks are loaded from the mapping on demand")
+			{
+				REQUIRE(lazySong->song().title == "title");
+				REQUIRE_FALSE(lazySong->isLoaded(1));
+				REQUIRE(lazySong->track(1).measures.size() == 1);
+				REQUIRE(lazySong->track(0).measures[0].voices[0].beats[2].notes[0].value == 2);
+
+				lazySong.reset();
+				std::remove("./test.cache");
+			}
+		}
+	}
+}
+
+SCENARIO("Can write a Guitar Pro 5 file")
+{
+	GIVEN("A song read from a .gp5 file")
+	{
+		Gp5Reader gp5Reader;
+		auto song = gp5Reader.readSongFromFile("./resources/test.gp5");
+
+		WHEN("The song is written and read back")
+		{
+			Gp5Writer writer;
+			auto data = writer.write(*song);
+
+			Gp5Reader reader;
+			auto writtenSong = reader.readSong(data.data(), data.size());
+
+			THEN("The song read back matches the original")
+			{
+				REQUIRE(reader.version().full() == "FICHIER GUITAR PRO v5.10");
+				REQUIRE(writtenSong->title == song->title);
+				REQUIRE(writtenSong->comments == song->comments);
+				REQUIRE(writtenSong->lyrics == song->lyrics);
+				REQUIRE(writtenSong->pageSetup == song->pageSetup);
+				REQUIRE(writtenSong->tempo == song->tempo);
+				REQUIRE(writtenSong->measureHeaders == song->measureHeaders);
+				REQUIRE(writtenSong->tracks.size() == song->tracks.size());
+
+				for (size_t i = 0; i < song->tracks.size(); ++i) {
+					auto& track = writtenSong->tracks[i];
+					REQUIRE(track.name == song->tracks[i].name);
+					REQUIRE(track.channel == song->tracks[i].channel);
+					REQUIRE(track.strings.size() == song->tracks[i].strings.size());
+
+					auto columns = NoteColumns::fromTrack(track);
+					auto expectedColumns = NoteColumns::fromTrack(song->tracks[i]);
+					REQUIRE(columns.start == expectedColumns.start);
+					REQUIRE(columns.value == expectedColumns.value);
+					REQUIRE(columns.flags == expectedColumns.flags);
+				}
+			}
+
+			THEN("Writing the song read back gives the same bytes")
+			{
+				REQUIRE(writer.write(*writtenSong) == data);
+			}
+		}
+
+		WHEN("Two tracks change the tempo within the first measure, the later change on the first track")
+		{
+			auto& lateBeat = song->tracks[0].measures[0].voices[0].beats.back();
+			auto& earlyBeat = song->tracks[1].measures[0].voices[0].beats.front();
+			REQUIRE(earlyBeat.start < lateBeat.start);
+
+			lateBeat.effect.mixTableChange.emplace().tempo = 150;
+			earlyBeat.effect.mixTableChange.emplace().tempo = 70;
+
+			auto data = Gp5Writer().write(*song);
+			auto writtenSong = Gp5Reader().readSong(data.data(), data.size());
+
+			THEN("The measure takes the tempo of the change played last")
+			{
+				REQUIRE(writtenSong->measureHeaders[0].tempo == 150);
+			}
+		}
+
+		WHEN("The song is written as version 5.00")
+		{
+			Gp5Writer writer(GpVersion::parse("FICHIER GUITAR PRO v5.00"));
+			auto data = writer.write(*song);
+
+			Gp5Reader reader;
+			auto writtenSong = reader.readSong(data.data(), data.size());
+
+			THEN("The song is read back in that version")
+			{
+				REQUIRE(reader.version().minor() == 0);
+				REQUIRE(writtenSong->measureHeaders == song->measureHeaders);
+				REQUIRE(writtenSong->tracks.at(0).measures[0].voices[0].beats[2].notes[0].value == 2);
+				REQUIRE(writer.write(*writtenSong) == data);
+			}
+		}
+
+		WHEN("The song is written to a file")
+		{
+			Gp5Writer().writeToFile(*song, "./test_written.gp5");
+			auto writtenSong = Gp5Reader().readSongFromFile("./test_written.gp5");
+			std::remove("./test_written.gp5");
+
+			THEN("The file can be read")
+			{
+				REQUIRE(writtenSong->title == "title");
+				REQUIRE(writtenSong->tracks.size() == song->tracks.size());
+			}
+		}
+	}
+
+	GIVEN("A version before 5")
+	{
+		THEN("No writer is made for it")
+		{
+			REQUIRE_THROWS_AS(Gp5Writer(GpVersion::parse("FICHIER GUITAR PRO v4.06")), GpWriterError);
+		}
+	}
+}
+
+SCENARIO("Can export a song as a MIDI file")
+{
+	GIVEN("A song read from a .gp5 file")
+	{
+		Gp5Reader gp5Reader;
+		auto song = gp5Reader.readSongFromFile("./resources/test.gp5");
+
+		WHEN("The song is exported")
+		{
+			auto data = MidiWriter().write(*song);
+
+			auto readBigEndian = [&](size_t position, size_t numBytes) {
+				uint32_t value = 0;
+				for (size_t i = 0; i < numBytes; ++i) {
+					value = (value << 8) | std::to_integer<uint32_t>(data.at(position + i));
+				}
+
+				return value;
+			};
+
+			auto readVariableLength = [&](size_t& position) {
+				uint32_t value = 0;
+				uint32_t byte;
+				do {
+					byte = std::to_integer<uint32_t>(data.at(position++));
+					value = (value << 7) | (byte & 0x7F);
+				} while (byte & 0x80);
+
+				return value;
+			};
+
+			THEN("The header announces a tempo track and a track per song track")
+			{
+				REQUIRE(std::memcmp(data.data(), "MThd", 4) == 0);
+				REQUIRE(readBigEndian(4, 4) == 6);
+				REQUIRE(readBigEndian(8, 2) == 1);
+				REQUIRE(readBigEndian(10, 2) == song->tracks.size() + 1);
+				REQUIRE(readBigEndian(12, 2) == static_cast<uint32_t>(Duration::QuarterTime));
+			}
+
+			THEN("The track chunks cover the rest of the file")
+			{
+				size_t position = 14;
+				size_t numChunks = 0;
+				while (position < data.size()) {
+					REQUIRE(std::memcmp(data.data() + position, "MTrk", 4) == 0);
+					position += 8 + readBigEndian(position + 4, 4);
+					++numChunks;
+				}
+
+				REQUIRE(position == data.size());
+				REQUIRE(numChunks == song->tracks.size() + 1);
+			}
+
+			THEN("The first note of a track sounds the fret on the tuning of its string")
+			{
+				auto& track = song->tracks.at(0);
+				const Note* expectedNote = nullptr;
+				for (auto& beat : track.measures.at(0).voices[0].beats) {
+					if (!beat.notes.empty()) {
+						expectedNote = &beat.notes[0];
+						break;
+					}
+				}
+
+				REQUIRE(expectedNote != nullptr);
+				auto expectedKey = track.strings.at(expectedNote->string - 1).value + expectedNote->value + track.offset;
+
+				// Skip the tempo track and walk the events of the first track
+				size_t position = 14;
+				position += 8 + readBigEndian(position + 4, 4);
+				position += 8;
+
+				uint32_t status = 0;
+				uint32_t key = 0;
+				uint32_t velocity = 0;
+				while (velocity == 0) {
+					readVariableLength(position);
+					auto byte = std::to_integer<uint32_t>(data.at(position));
+					if (byte == 0xFF) {
+						position += 2;
+						position += readVariableLength(position);
+						continue;
+					}
+
+					if (byte & 0x80) {
+						status = byte;
+						++position;
+					}
+
+					auto numDataBytes = (status & 0xF0) == 0xC0 ? 1 : 2;
+					key = std::to_integer<uint32_t>(data.at(position));
+					velocity = (status & 0xF0) == 0x90 ? std::to_integer<uint32_t>(data.at(position + 1)) : 0;
+					position += numDataBytes;
+				}
+
+				REQUIRE((status & 0x0F) == (track.channel->channel & 0x0F));
+				REQUIRE(key == expectedKey);
+				REQUIRE(velocity == expectedNote->velocity);
+			}
+		}
+	}
+
+	GIVEN("A song whose tempo changes halfway through a measure")
+	{
+		auto song = createMeasureHeaders(3);
+		auto& track = song->tracks.emplace_back();
+		track.measures.reserve(song->measureHeaders.size());
+		for (auto& header : song->measureHeaders) {
+			track.measures.emplace_back(track, header);
+		}
+
+		auto& header = song->measureHeaders[1];
+		auto& beat = track.measures[1].voices[0].beats.emplace_back();
+		beat.start = header.start + header.calcLength() / 2;
+		beat.effect.mixTableChange.emplace();
+		beat.effect.mixTableChange->tempo = 240;
+		song->measureHeaders[2].tempo = 240;
+
+		WHEN("The song is exported")
+		{
+			auto data = MidiWriter().write(*song);
+
+			// The tempo track holds only meta events: a delta, 0xFF, the type,
+			// the length and the data
+			std::vector<std::pair<uint32_t, uint32_t>> tempos;
+			size_t position = 14 + 8;
+			uint32_t tick = 0;
+			while (true) {
+				uint32_t delta = 0;
+				uint32_t byte;
+				do {
+					byte = std::to_integer<uint32_t>(data.at(position++));
+					delta = (delta << 7) | (byte & 0x7F);
+				} while (byte & 0x80);
+
+				tick += delta;
+				auto type = std::to_integer<uint8_t>(data.at(position + 1));
+				auto length = std::to_integer<size_t>(data.at(position + 2));
+				position += 3;
+
+				if (type == 0x51) {
+					uint32_t tempo = 0;
+					for (size_t i = 0; i < 3; ++i) {
+						tempo = (tempo << 8) | std::to_integer<uint32_t>(data.at(position + i));
+					}
+
+					tempos.emplace_back(tick, tempo);
+				}
+
+				position += length;
+				if (type == 0x2F) {
+					break;
+				}
+			}
+
+			THEN("The tempo is set where the mix table changes it, not at the next measure")
+			{
+				auto measureLength = header.calcLength();
+				REQUIRE(tempos.size() == 2);
+				REQUIRE(tempos[0] == std::make_pair<uint32_t, uint32_t>(0, 500000));
+				REQUIRE(tempos[1] == std::make_pair<uint32_t, uint32_t>(measureLength + measureLength / 2, 250000));
+			}
+		}
+	}
+}
+
+SCENARIO("Can unroll the repeats and jumps of a song")
+{
+	auto playedMeasures = [](const Song& song) {
+		std::vector<uint32_t> measures;
+		for (auto& entry : song.timeline().entries) {
+			measures.push_back(entry.measure);
+		}
+
+		return measures;
+	};
+
+	GIVEN("A repeat")
+	{
+		auto song = createMeasureHeaders(3);
+		song->measureHeaders[0].isRepeatOpen = true;
+		song->measureHeaders[1].repeatClose = 1;
+		song->measureHeaders[2].tempo = 90;
+
+		THEN("The repeated measures are played twice, one after another")
+		{
+			REQUIRE(playedMeasures(*song) == std::vector<uint32_t>{ 0, 1, 0, 1, 2 });
+
+			auto& timeline = song->timeline();
+			auto measureLength = song->measureHeaders[0].calcLength();
+			for (size_t i = 0; i < timeline.size(); ++i) {
+				REQUIRE(timeline.entries[i].start == Duration::QuarterTime + i * measureLength);
+			}
+
+			REQUIRE(timeline.entries[4].tempo == 90);
+			REQUIRE(timeline.end == Duration::QuarterTime + 5 * measureLength);
+		}
+
+		THEN("The timeline is built once and kept on the song")
+		{
+			auto& timeline = song->timeline();
+			REQUIRE(&song->timeline() == &timeline);
+
+			song->measureHeaders[1].repeatClose = 2;
+			song->resetTimeline();
+			REQUIRE(song->timeline().size() == 7);
+		}
+	}
+
+	GIVEN("A repeat with two endings")
+	{
+		auto song = createMeasureHeaders(4);
+		song->measureHeaders[0].isRepeatOpen = true;
+		song->measureHeaders[1].repeatAlternative = 0x01;
+		song->measureHeaders[1].repeatClose = 1;
+		song->measureHeaders[2].repeatAlternative = 0x02;
+
+		THEN("Each pass takes its own ending")
+		{
+			REQUIRE(playedMeasures(*song) == std::vector<uint32_t>{ 0, 1, 0, 2, 3 });
+		}
+	}
+
+	GIVEN("A Da Capo al Fine")
+	{
+		auto song = createMeasureHeaders(3);
+		song->measureHeaders[1].direction = "Fine";
+		song->measureHeaders[2].fromDirection = "Da Capo al Fine";
+
+		THEN("The song is played again from the start up to the Fine")
+		{
+			REQUIRE(playedMeasures(*song) == std::vector<uint32_t>{ 0, 1, 2, 0, 1 });
+		}
+	}
+
+	GIVEN("A Da Segno al Coda")
+	{
+		auto song = createMeasureHeaders(5);
+		song->measureHeaders[1].direction = "Segno";
+		song->measureHeaders[2].fromDirection = "Da Coda";
+		song->measureHeaders[3].fromDirection = "Da Segno al Coda";
+		song->measureHeaders[4].direction = "Coda";
+
+		THEN("The jump goes back to the Segno and on from the Da Coda to the Coda")
+		{
+			REQUIRE(playedMeasures(*song) == std::vector<uint32_t>{ 0, 1, 2, 3, 1, 2, 4 });
+		}
+	}
+
+	GIVEN("A repeat before a Da Capo")
+	{
+		auto song = createMeasureHeaders(4);
+		song->measureHeaders[0].isRepeatOpen = true;
+		song->measureHeaders[1].repeatAlternative = 0x01;
+		song->measureHeaders[1].repeatClose = 1;
+		song->measureHeaders[2].repeatAlternative = 0x02;
+		song->measureHeaders[3].fromDirection = "Da Capo";
+
+		THEN("The repeat is played once and takes its last ending after the jump")
+		{
+			REQUIRE(playedMeasures(*song) == std::vector<uint32_t>{ 0, 1, 0, 2, 3, 0, 2, 3 });
+		}
+	}
+}
+
+SCENARIO("Can convert between ticks and seconds")
+{
+	GIVEN("A song that slows down for its last measure")
+	{
+		auto song = createMeasureHeaders(3);
+		song->measureHeaders[2].tempo = 60;
+		auto map = TempoMap::fromSong(*song);
+		auto measureLength = song->measureHeaders[0].calcLength();
+
+		THEN("A second passes for every two beats, then for every beat")
+		{
+			REQUIRE(map.size() == 2);
+			REQUIRE(map.toSeconds(Duration::QuarterTime) == Approx(0.0));
+			REQUIRE(map.toSeconds(Duration::QuarterTime + measureLength) == Approx(2.0));
+			REQUIRE(map.toSeconds(Duration::QuarterTime + 3 * measureLength) == Approx(8.0));
+			REQUIRE(map.toTick(6.0) == Approx(Duration::QuarterTime + 2.5 * measureLength));
+			REQUIRE(map.toTick(map.toSeconds(5000)) == Approx(5000));
+		}
+
+		THEN("Arrays of values convert as each value on its own")
+		{
+			std::vector<uint32_t> ticks = { 960, 2000, 4800, 8000, 9600, 12000, 3000, 960 };
+			std::vector<double> seconds(ticks.size());
+			map.toSeconds(ticks.data(), ticks.size(), seconds.data());
+
+			std::vector<double> convertedTicks(ticks.size());
+			map.toTicks(seconds.data(), seconds.size(), convertedTicks.data());
+
+			for (size_t i = 0; i < ticks.size(); ++i) {
+				REQUIRE(seconds[i] == Approx(map.toSeconds(ticks[i])));
+				REQUIRE(convertedTicks[i] == Approx(ticks[i]));
+			}
+		}
+	}
+
+	GIVEN("A tempo change halfway through a measure")
+	{
+		auto song = createMeasureHeaders(3);
+		auto& track = song->tracks.emplace_back();
+		track.measures.reserve(song->measureHeaders.size());
+		for (auto& header : song->measureHeaders) {
+			track.measures.emplace_back(track, header);
+		}
+
+		auto& header = song->measureHeaders[1];
+		auto& beat = track.measures[1].voices[0].beats.emplace_back();
+		beat.start = header.start + header.calcLength() / 2;
+		beat.effect.mixTableChange.emplace();
+		beat.effect.mixTableChange->tempo = 240;
+		song->measureHeaders[1].tempo = 240;
+		song->measureHeaders[2].tempo = 240;
+
+		auto map = TempoMap::fromSong(*song);
+
+		THEN("The change takes effect at its beat")
+		{
+			REQUIRE(map.size() == 2);
+			REQUIRE(map.toSeconds(beat.start) == Approx(3.0));
+			REQUIRE(map.toSeconds(song->measureHeaders[2].start) == Approx(3.5));
+		}
+	}
+
+	GIVEN("A repeat")
+	{
+		auto song = createMeasureHeaders(2);
+		song->measureHeaders[0].isRepeatOpen = true;
+		song->measureHeaders[0].repeatClose = 1;
+		auto map = TempoMap::fromSong(*song);
+
+		THEN("Ticks run on along the timeline")
+		{
+			REQUIRE(map.toSeconds(song->timeline().end) == Approx(6.0));
+		}
+	}
+}
+
+SCENARIO("Can find the notes sounding within a range of ticks")
+{
+	auto findNotesByWalking = [](const Song& song, uint32_t start, uint32_t end) {
+		std::vector<const Note*> notes;
+		for (auto& track : song.tracks) {
+			for (auto& measure : track.measures) {
+				for (auto& voice : measure.voices) {
+					for (auto& beat : voice.beats) {
+						if (beat.start < end && start < beat.start + beat.duration.calcTime()) {
+							for (auto& note : beat.notes) {
+								notes.push_back(&note);
+							}
+						}
+					}
+				}
+			}
+		}
+
+		std::sort(notes.begin(), notes.end());
+		return notes;
+	};
+
+	auto findNotes = [](const NoteIndex& index, uint32_t start, uint32_t end) {
+		std::vector<const Note*> notes;
+		for (auto& interval : index.findNotes(start, end)) {
+			notes.push_back(interval.note);
+		}
+
+		std::sort(notes.begin(), notes.end());
+		return notes;
+	};
+
+	GIVEN("A long track of quarter notes over whole notes")
+	{
+		auto song = createMeasureHeaders(300);
+		auto& track = song->tracks.emplace_back();
+		track.measures.reserve(song->measureHeaders.size());
+		for (auto& header : song->measureHeaders) {
+			auto& measure = track.measures.emplace_back(track, header);
+			for (uint32_t i = 0; i < 4; ++i) {
+				auto& beat = measure.voices[0].beats.emplace_back();
+				beat.start = header.start + i * Duration::QuarterTime;
+				beat.notes.emplace_back().value = static_cast<uint8_t>(i);
+			}
+
+			auto& wholeBeat = measure.voices[1].beats.emplace_back();
+			wholeBeat.start = header.start;
+			wholeBeat.duration.value = Duration::Whole;
+			wholeBeat.notes.emplace_back();
+		}
+
+		auto index = NoteIndex::fromSong(*song);
+
+		THEN("Every range finds the notes a walk over the measures finds")
+		{
+			REQUIRE(index.size() == 300 * 5);
+
+			uint32_t ranges[][2] = {
+				{ 0, 960 },
+				{ 960, 961 },
+				{ 1000, 5000 },
+				{ 4799, 4800 },
+				{ 4800, 4801 },
+				{ 100000, 130000 },
+				{ 500000, 500500 },
+				{ 1100000, 1200000 },
+				{ 1152960, 2000000 },
+				{ 0, 2000000 }
+			};
+
+			for (auto& range : ranges) {
+				REQUIRE(findNotes(index, range[0], range[1]) == findNotesByWalking(*song, range[0], range[1]));
+			}
+
+			for (uint32_t start = 0; start < 1200000; start += 7919) {
+				auto end = start + 1 + start % 50000;
+				REQUIRE(findNotes(index, start, end) == findNotesByWalking(*song, start, end));
+			}
+		}
+
+		THEN("Notes are found in order of their start")
+		{
+			auto notes = index.findNotes(20000, 40000);
+			REQUIRE(notes.size() == 29);
+			for (size_t i = 1; i < notes.size(); ++i) {
+				REQUIRE(notes[i - 1].start <= notes[i].start);
+			}
+		}
+	}
+
+	GIVEN("A song read from a .gp5 file")
+	{
+		Gp5Reader gp5Reader;
+		auto song = gp5Reader.readSongFromFile("./resources/test.gp5");
+
+		WHEN("Its tracks are indexed one at a time")
+		{
+			NoteIndex index;
+			index.addTrack(1, song->tracks.at(1));
+
+			THEN("Only the notes of the tracks indexed so far are found")
+			{
+				REQUIRE(index.hasTrack(1));
+				REQUIRE_FALSE(index.hasTrack(0));
+
+				index.addTrack(0, song->tracks[0]);
+				REQUIRE(index.hasTrack(0));
+				REQUIRE(findNotes(index, 0, 100000) == findNotesByWalking(*song, 0, 100000));
+			}
+		}
+	}
+}
+
+std::unique_ptr<Song> createExpectedSong()
+{
+	auto song = std::make_unique<Song>();
+
+	song->title = "title";
+	song->subtitle = "subtitle";
+	song->artist = "artist";
+	song->album = "album";
+	song->lyricsWriter = "lyrics";
+	song->musicWriter = "music";
+	song->copyright = "copyright";
+	song->tabAuthor = "tab";
+	song->instructions = "instructions";
+
+	song->lyrics.trackNumber = 1;
+	song->lyrics.lines = {
+		LyricLine(1, "these are the lyrics "),
+		LyricLine(1, ""),
+		LyricLine(1, ""),
+		LyricLine(1, ""),
+		LyricLine(1, "")
+	};
+
+	song->tempo.name = "";
+	song->tempo.value = 120;
+	song->tempo.isHidden = false;
+
+	song->keySignature = KeySignature::CMajor;
+	song->octave = 0;
+
+	MeasureHeader header;
+	header.number = 1;
+	header.start = Duration::QuarterTime;
+	header.tempo = song->tempo.value;
+	header.timeSignature.numerator = 4;
+	header.timeSignature.denominator.value = 4;
+	header.keySignature = KeySignature::GMajor;
+	song->measureHeaders.push_back(header);
+
+	return song;
+}
+
+// Writes a two-measure, single-track song the way Guitar Pro 3 or 4 saves it
+std::vector<std::byte> createOldVersionFile(uint8_t major)
+{
+	StreamWriter writer;
+
+	auto writeIntByteSizedString = [&](std::string_view text) {
+		writer.writeUnsignedInt(static_cast<uint32_t>(text.size() + 1));
+		writer.writeUnsignedByte(static_cast<uint8_t>(text.size()));
+		writer.writeString(text);
+	};
+
+	auto writeByteSizedString = [&](std::string_view text, size_t size) {
+		writer.writeUnsignedByte(static_cast<uint8_t>(text.size()));
+		writer.writeString(text);
+		writer.writePadding(size - text.size());
+	};
+
+	writeByteSizedString(major == 3 ? "FICHIER GUITAR PRO v3.00" : "FICHIER GUITAR PRO v4.06", 30);
+
+	for (auto field : { "title", "", "artist", "", "words", "", "", "" }) {
+		writeIntByteSizedString(field);
+	}
+
+	writer.writeUnsignedInt(1);
+	writeIntByteSizedString("notice");
+
+	// Triplet feel
+	writer.writeBoolean(true);
+
+	if (major == 4) {
+		writer.writeUnsignedInt(1);
+		for (auto i = 0; i < 5; ++i) {
+			writer.writeUnsignedInt(1);
+			writer.writeIntSizedString(i == 0 ? "la" : "");
+		}
+	}
+
+	writer.writeSignedInt(120);
+	writer.writeSignedInt(static_cast<int32_t>(KeySignature::GMajor));
+
+	if (major == 4) {
+		writer.writeUnsignedByte(0);
+	}
+
+	for (auto i = 0; i < 64; ++i) {
+		writer.writeSignedInt(i == 0 ? 25 : 0);
+		for (auto value : { 13, 8, 0, 0, 0, 0 }) {
+			writer.writeSignedByte(static_cast<int8_t>(value));
+		}
+
+		writer.writePadding(2);
+	}
+
+	// Two measures and one track
+	writer.writeUnsignedInt(2);
+	writer.writeUnsignedInt(1);
+
+	// 4/4 with a repeat opened, then the repeat closed twice with two endings
+	writer.writeUnsignedByte(0x07);
+	writer.writeSignedByte(4);
+	writer.writeSignedByte(4);
+	writer.writeUnsignedByte(0x18);
+	writer.writeSignedByte(2);
+	writer.writeUnsignedByte(2);
+
+	writer.writeUnsignedByte(0);
+	writeByteSizedString("Guitar", 40);
+	writer.writeUnsignedInt(6);
+	for (auto tuning : { 64, 59, 55, 50, 45, 40, 0 }) {
+		writer.writeSignedInt(tuning);
+	}
+
+	writer.writeUnsignedInt(1);
+	writer.writeUnsignedInt(1);
+	writer.writeUnsignedInt(2);
+	writer.writeUnsignedInt(24);
+	writer.writeUnsignedInt(0);
+	writer.writePadding(4);
+
+	// A quarter note on the first string
+	writer.writeUnsignedInt(2);
+	writer.writeUnsignedByte(0x00);
+	writer.writeSignedByte(0);
+	writer.writeUnsignedByte(0x40);
+	writer.writeUnsignedByte(0x20);
+	writer.writeUnsignedByte(1);
+	writer.writeSignedByte(3);
+
+	// An eighth note on the sixth string with a tempo change, sliding and
+	// played as a natural harmonic, which GP3 sets on the beat
+	writer.writeUnsignedByte(major == 3 ? 0x18 : 0x10);
+	writer.writeSignedByte(1);
+
+	if (major == 3) {
+		writer.writeUnsignedByte(0x04);
+	}
+
+	writer.writeSignedByte(-1);
+	for (auto i = 0; i < 6; ++i) {
+		writer.writeSignedByte(-1);
+	}
+
+	writer.writeSignedInt(90);
+	writer.writeUnsignedByte(0);
+
+	if (major == 4) {
+		writer.writeUnsignedByte(0);
+	}
+
+	writer.writeUnsignedByte(0x02);
+	writer.writeUnsignedByte(0x28);
+	writer.writeUnsignedByte(1);
+	writer.writeSignedByte(5);
+
+	if (major == 3) {
+		writer.writeUnsignedByte(0x04);
+	} else {
+		writer.writeUnsignedByte(0x00);
+		writer.writeUnsignedByte(0x18);
+		writer.writeSignedByte(static_cast<int8_t>(SlideType::ShiftSlideTo));
+		writer.writeSignedByte(static_cast<int8_t>(HarmonicType::Natural));
+	}
+
+	// A whole rest
+	writer.writeUnsignedInt(1);
+	writer.writeUnsignedByte(0x40);
+	writer.writeUnsignedByte(static_cast<uint8_t>(BeatStatus::Rest));
+	writer.writeSignedByte(-2);
+	writer.writeUnsignedByte(0);
+
+	return writer.release();
+}
+
+// Lays out a version 5.00 file field by field, as Guitar Pro 5.0 saves it,
+// rather than through the writer
+std::vector<std::byte> createVersion500File()
+{
+	StreamWriter writer;
+
+	writer.writeByteSizedString("FICHIER GUITAR PRO v5.00", 30);
+
+	for (auto field : { "title", "", "artist", "", "words", "music", "", "", "" }) {
+		writer.writeIntByteSizedString(field);
+	}
+
+	writer.writeUnsignedInt(1);
+	writer.writeIntByteSizedString("notice");
+
+	// Lyrics for the first track
+	writer.writeUnsignedInt(1);
+	for (auto i = 0; i < 5; ++i) {
+		writer.writeUnsignedInt(1);
+		writer.writeIntSizedString(i == 0 ? "la" : "");
+	}
+
+	// The page setup follows the lyrics directly, with no master effect
+	for (auto value : { 210, 297, 10, 10, 15, 10, 100 }) {
+		writer.writeUnsignedInt(value);
+	}
+
+	writer.writeUnsignedShort(0x01ff);
+	for (auto field : { "%TITLE%", "%SUBTITLE%", "%ARTIST%", "%ALBUM%", "Words by %WORDS%",
+		"Music by %MUSIC%", "Words & Music by %WORDSMUSIC%", "Copyright %COPYRIGHT%",
+		"All Rights Reserved", "Page %N%" }) {
+		writer.writeIntByteSizedString(field);
+	}
+
+	// The tempo, without the flag that hides it
+	writer.writeIntByteSizedString("Moderate");
+	writer.writeUnsignedInt(120);
+	writer.writeSignedByte(static_cast<int8_t>(KeySignature::GMajor));
+	writer.writeUnsignedInt(0);
+
+	for (auto i = 0; i < 64; ++i) {
+		writer.writeSignedInt(i == 0 ? 25 : 0);
+		for (auto value : { 13, 8, 0, 0, 0, 0 }) {
+			writer.writeSignedByte(static_cast<int8_t>(value));
+		}
+
+		writer.writePadding(2);
+	}
+
+	// No direction signs, then the reverb
+	for (auto i = 0; i < 19; ++i) {
+		writer.writeSignedShort(-1);
+	}
+
+	writer.writeUnsignedInt(0);
+
+	// Two measures and one track
+	writer.writeUnsignedInt(2);
+	writer.writeUnsignedInt(1);
+
+	// 4/4 with its beams and the padding byte of a header with no ending
+	writer.writeUnsignedByte(0x03);
+	writer.writeSignedByte(4);
+	writer.writeSignedByte(4);
+	for (auto beam : { 2, 2, 2, 2 }) {
+		writer.writeUnsignedByte(static_cast<uint8_t>(beam));
+	}
+
+	writer.writePadding(1);
+	writer.writeUnsignedByte(static_cast<uint8_t>(TripletFeel::None));
+
+	// Headers after the first start with a padding byte
+	writer.writePadding(1);
+	writer.writeUnsignedByte(0x00);
+	writer.writePadding(1);
+	writer.writeUnsignedByte(static_cast<uint8_t>(TripletFeel::None));
+
+	// Every track starts with a padding byte in 5.00
+	writer.writePadding(1);
+	writer.writeUnsignedByte(0x08);
+	writer.writeByteSizedString("Guitar", 40);
+	writer.writeUnsignedInt(6);
+	for (auto tuning : { 64, 59, 55, 50, 45, 40, 0 }) {
+		writer.writeSignedInt(tuning);
+	}
+
+	writer.writeUnsignedInt(1);
+	writer.writeUnsignedInt(1);
+	writer.writeUnsignedInt(2);
+	writer.writeUnsignedInt(24);
+	writer.writeUnsignedInt(0);
+	writer.writePadding(4);
+
+	// The settings, the accentuation and the bank, then the RSE settings with
+	// a short effect number and none of the equalizer and effect names of 5.10
+	writer.writeUnsignedShort(0x0003);
+	writer.writeUnsignedByte(0);
+	writer.writeUnsignedByte(0);
+	writer.writeUnsignedByte(0);
+	writer.writePadding(24);
+	writer.writeSignedInt(-1);
+	writer.writeUnsignedInt(1);
+	writer.writeSignedInt(-1);
+	writer.writeSignedShort(-1);
+	writer.writePadding(1);
+
+	// Two bytes of padding after the tracks
+	writer.writePadding(2);
+
+	// A quarter note on the first string, and an empty second voice
+	writer.writeUnsignedInt(1);
+	writer.writeUnsignedByte(0x00);
+	writer.writeSignedByte(0);
+	writer.writeUnsignedByte(0x40);
+	writer.writeUnsignedByte(0x20);
+	writer.writeUnsignedByte(static_cast<uint8_t>(NoteType::Normal));
+	writer.writeSignedByte(3);
+	writer.writeUnsignedByte(0);
+	writer.writeUnsignedShort(0);
+	writer.writeUnsignedInt(0);
+	writer.writeUnsignedByte(static_cast<uint8_t>(LineBreak::None));
+
+	// A whole rest
+	writer.writeUnsignedInt(1);
+	writer.writeUnsignedByte(0x40);
+	writer.writeUnsignedByte(static_cast<uint8_t>(BeatStatus::Rest));
+	writer.writeSignedByte(-2);
+	writer.writeUnsignedByte(0);
+	writer.writeUnsignedShort(0);
+	writer.writeUnsignedInt(0);
+	writer.writeUnsignedByte(static_cast<uint8_t>(LineBreak::None));
+
+	return writer.release();
+}
+
+// Lays out a song of 4/4 measures with no repeats, and no tracks
+std::unique_ptr<Song> createMeasureHeaders(size_t numMeasures)
+{
+	auto song = std::make_unique<Song>();
+	song->tempo.value = 120;
+
+	for (size_t i = 0; i < numMeasures; ++i) {
+		MeasureHeader header;
+		header.number = static_cast<uint32_t>(i + 1);
+		header.start = Duration::QuarterTime + static_cast<uint32_t>(i) * header.calcLength();
+		header.tempo = song->tempo.value;
+		song->measureHeaders.push_back(header);
+	}
+
+	return song;
+}
+
+// The direction signs open the measure headers phase of a Guitar Pro 5 file,
+// so they start where the phases before it end
+size_t directionSignsOffset(const MappedFile& file)
+{
+	RecordingObserver observer;
+	Gp5Reader reader;
+	reader.setParseObserver(&observer);
+	reader.readSong(file.data(), file.size());
+
+	size_t offset = 0;
+	for (auto& phase : observer.phases) {
+		if (phase.phase == ParsePhase::MeasureHeaders) {
+			break;
+		}
+
+		offset += phase.bytes;
+	}
+
+	return offset;
+}
+
+// The 19 signs are shorts, and the reverb and the measure count ints
+size_t trackCountOffset(const MappedFile& file)
+{
+	return directionSignsOffset(file) + 19 * 2 + 4 + 4;
+}
+
+size_t firstMeasureHeaderOffset(const MappedFile& file)
+{
+	return trackCountOffset(file) + 4;
+}